@@ -49,6 +49,7 @@
 #include "actor.h"
 #include "b_bot.h"
 #include "p_effect.h"
+#include "p_subsectorgrid.h"
 #include "d_player.h"
 #include "p_destructible.h"
 #include "r_data/r_sections.h"
@@ -97,6 +98,7 @@ struct wbstartstruct_t;
 class DSectorMarker;
 struct FTranslator;
 struct EventManager;
+class LevelAABBTree;
 
 typedef TMap<int, int> FDialogueIDMap;				// maps dialogue IDs to dialogue array index (for ACS)
 typedef TMap<FName, int> FDialogueMap;				// maps actor class names to dialogue array index
@@ -263,6 +265,8 @@ public:
 
 	void DeleteAllAttachedLights();
 	void RecreateAllAttachedLights();
+	void LinkDynamicLights();
+	LevelAABBTree *GetAABBTree();
 
 
 private:
@@ -459,6 +463,9 @@ public:
 	FSectionContainer sections;
 	FCanvasTextureInfo canvasTextureInfo;
 	EventManager *localEventManager = nullptr;
+	LevelAABBTree *aabbTree = nullptr;	// created on first use by GetAABBTree
+	FSubsectorGrid renderSubsectorGrid;	// start nodes for PointInRenderSubsector
+	FSubsectorGrid gameSubsectorGrid;	// the same for PointInSubsector, if the game nodes are separate
 
 	// [ZZ] Destructible geometry information
 	TMap<int, FHealthGroup> healthGroups;
@@ -625,10 +632,9 @@ public:
 	DSeqNode *SequenceListHead;
 
 	// [RH] particle globals
-	uint32_t			ActiveParticles;
-	uint32_t			InactiveParticles;
-	TArray<particle_t>	Particles;
-	TArray<uint16_t>	ParticlesInSubsec;
+	FParticleData		ParticleData;
+	TArray<particle_t>	Particles;			// copy of ParticleData for the renderers, made by P_FindParticleSubsectors
+	TArray<uint32_t>	ParticlesInSubsec;
 	FThinkerCollection Thinkers;
 
 	TArray<DVector2>	Scrolls;		// NULL if no DScrollers in this level
@@ -64,9 +64,17 @@
 #include "a_dynlight.h"
 #include "actorinlines.h"
 #include "memarena.h"
+#include "stats.h"
+#include "ctpl.h"
+#include <atomic>
+#include <thread>
+
+CVAR(Int, r_lightlink_threads, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// 0 picks one per core, up to 4
 
 static FMemArena DynLightArena(sizeof(FDynamicLight) * 200);
 static TArray<FDynamicLight*> FreeList;
+static FMemArena LightNodeArena(sizeof(FLightNode) * 1000);
+static FLightNode *FreeLightNodes;
 static FRandom randLight;
 
 extern TArray<FLightDefaults *> StateLights;
@@ -402,8 +410,8 @@ void FDynamicLight::UpdateLocation()
 
 		if (X() != oldx || Y() != oldy || radius != oldradius)
 		{
-			//Update the light lists
-			LinkLight();
+			// The light lists get updated for all lights at once after they have been ticked.
+			m_linkPending = true;
 		}
 	}
 }
@@ -419,7 +427,7 @@ void FDynamicLight::UpdateLocation()
 //
 //=============================================================================
 
-FLightNode * AddLightNode(FLightNode ** thread, void * linkto, FDynamicLight * light, FLightNode *& nextnode)
+static FLightNode * AddLightNode(FLightNode ** thread, void * linkto, FDynamicLight * light, FLightNode *& nextnode)
 {
 	FLightNode * node;
 
@@ -437,7 +445,12 @@ FLightNode * AddLightNode(FLightNode ** thread, void * linkto, FDynamicLight * l
 	// Couldn't find an existing node for this sector. Add one at the head
 	// of the list.
 	
-	node = new FLightNode;
+	if (FreeLightNodes)
+	{
+		node = FreeLightNodes;
+		FreeLightNodes = node->nextTarget;
+	}
+	else node = (FLightNode*)LightNodeArena.Alloc(sizeof(FLightNode));
 	
 	node->targ = linkto;
 	node->lightsource = light; 
@@ -480,7 +493,8 @@ static FLightNode * DeleteLightNode(FLightNode * node)
 		
 		// Return this node to the freelist
 		tn=node->nextTarget;
-		delete node;
+		node->nextTarget = FreeLightNodes;
+		FreeLightNodes = node;
 		return(tn);
 	}
 	return(nullptr);
@@ -518,23 +532,83 @@ double FDynamicLight::DistToSeg(const DVector3 &pos, vertex_t *start, vertex_t *
 
 //==========================================================================
 //
-// Collect all touched sidedefs and subsectors
-// to sidedefs and sector parts.
+// Per thread work data for collecting the sections and sides a light
+// touches. Visited sections and lines get marked in the worker's own
+// arrays instead of their validcount so that lights can be collected
+// on several threads at once.
 //
 //==========================================================================
+
 struct LightLinkEntry
 {
 	FSection *sect;
 	DVector3 pos;
 };
-static TArray<LightLinkEntry> collected_ss;
 
-void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section, float radius)
+struct FLightLinkWorker
+{
+	TArray<LightLinkEntry> queue;
+	TArray<FSection *> sections;
+	TArray<side_t *> sides;
+	TArray<unsigned> sectionMarks;
+	TArray<unsigned> lineMarks;
+	unsigned mark = 0;
+
+	void Prepare(FLevelLocals *Level)
+	{
+		sections.Clear();
+		sides.Clear();
+		GrowMarks(sectionMarks, Level->sections.allSections.Size());
+		GrowMarks(lineMarks, Level->lines.Size());
+	}
+
+	void NextLight()
+	{
+		if (++mark == 0)
+		{
+			memset(sectionMarks.Data(), 0, sectionMarks.Size() * sizeof(unsigned));
+			memset(lineMarks.Data(), 0, lineMarks.Size() * sizeof(unsigned));
+			mark = 1;
+		}
+	}
+
+	bool MarkSection(FLevelLocals *Level, FSection *sect)
+	{
+		unsigned &m = sectionMarks[Level->sections.SectionIndex(sect)];
+		if (m == mark) return false;
+		m = mark;
+		return true;
+	}
+
+	bool IsLineMarked(line_t *line) const { return lineMarks[line->Index()] == mark; }
+	void MarkLine(line_t *line) { lineMarks[line->Index()] = mark; }
+
+private:
+	static void GrowMarks(TArray<unsigned> &marks, unsigned size)
+	{
+		unsigned oldsize = marks.Size();
+		if (size > oldsize)
+		{
+			marks.Resize(size);
+			memset(&marks[oldsize], 0, (size - oldsize) * sizeof(unsigned));
+		}
+	}
+};
+
+//==========================================================================
+//
+// Collect all touched sidedefs and subsectors
+// to sidedefs and sector parts.
+//
+//==========================================================================
+
+void FDynamicLight::CollectWithinRadius(FLightLinkWorker &worker, const DVector3 &opos, FSection *section, float radius)
 {
 	if (!section) return;
+	auto &collected_ss = worker.queue;
 	collected_ss.Clear();
 	collected_ss.Push({ section, opos });
-	section->validcount = dl_validcount;
+	worker.MarkSection(Level, section);
 
 	bool hitonesidedback = false;
 	for (unsigned i = 0; i < collected_ss.Size(); i++)
@@ -542,19 +616,19 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 		auto pos = collected_ss[i].pos;
 		section = collected_ss[i].sect;
 
-		touching_sector = AddLightNode(&section->lighthead, section, this, touching_sector);
+		worker.sections.Push(section);
 
 
 		auto processSide = [&](side_t *sidedef, const vertex_t *v1, const vertex_t *v2)
 		{
 			auto linedef = sidedef->linedef;
-			if (linedef && linedef->validcount != ::validcount)
+			if (linedef && !worker.IsLineMarked(linedef))
 			{
 				// light is in front of the seg
 				if ((pos.Y - v1->fY()) * (v2->fX() - v1->fX()) + (v1->fX() - pos.X) * (v2->fY() - v1->fY()) <= 0)
 				{
-					linedef->validcount = ::validcount;
-					touching_sides = AddLightNode(&sidedef->lighthead, sidedef, this, touching_sides);
+					worker.MarkLine(linedef);
+					worker.sides.Push(sidedef);
 				}
 				else if (linedef->sidedef[0] == sidedef && linedef->sidedef[1] == nullptr)
 				{
@@ -567,15 +641,11 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 				if (port && port->mType == PORTT_LINKED)
 				{
 					line_t *other = port->mDestination;
-					if (other->validcount != ::validcount)
+					subsector_t *othersub = Level->PointInRenderSubsector(other->v1->fPos() + other->Delta() / 2);
+					FSection *othersect = othersub->section;
+					if (worker.MarkSection(Level, othersect))
 					{
-						subsector_t *othersub = Level->PointInRenderSubsector(other->v1->fPos() + other->Delta() / 2);
-						FSection *othersect = othersub->section;
-						if (othersect->validcount != ::validcount)
-						{
-							othersect->validcount = ::validcount;
-							collected_ss.Push({ othersect, PosRelative(other->frontsector->PortalGroup) });
-						}
+						collected_ss.Push({ othersect, PosRelative(other->frontsector->PortalGroup) });
 					}
 				}
 			}
@@ -597,9 +667,8 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 				if (partner)
 				{
 					FSection *sect = partner->section;
-					if (sect != nullptr && sect->validcount != dl_validcount)
+					if (sect != nullptr && worker.MarkSection(Level, sect))
 					{
-						sect->validcount = dl_validcount;
 						collected_ss.Push({ sect, pos });
 					}
 				}
@@ -622,9 +691,8 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 				DVector2 refpos = other->v1->fPos() + other->Delta() / 2 + sec->GetPortalDisplacement(sector_t::ceiling);
 				subsector_t *othersub = Level->PointInRenderSubsector(refpos);
 				FSection *othersect = othersub->section;
-				if (othersect->validcount != dl_validcount)
+				if (worker.MarkSection(Level, othersect))
 				{
-					othersect->validcount = dl_validcount;
 					collected_ss.Push({ othersect, PosRelative(othersub->sector->PortalGroup) });
 				}
 			}
@@ -637,9 +705,8 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 				DVector2 refpos = other->v1->fPos() + other->Delta() / 2 + sec->GetPortalDisplacement(sector_t::floor);
 				subsector_t *othersub = Level->PointInRenderSubsector(refpos);
 				FSection *othersect = othersub->section;
-				if (othersect->validcount != dl_validcount)
+				if (worker.MarkSection(Level, othersect))
 				{
-					othersect->validcount = dl_validcount;
 					collected_ss.Push({ othersect, PosRelative(othersub->sector->PortalGroup) });
 				}
 			}
@@ -648,17 +715,35 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 	shadowmapped = hitonesidedback && !DontShadowmap();
 }
 
+//==========================================================================
+//
+// Finds everything the light touches. This only reads the level and
+// writes to the worker and the light itself.
+//
+//==========================================================================
+
+void FDynamicLight::CollectLinks(FLightLinkWorker &worker)
+{
+	worker.NextLight();
+	if (radius>0)
+	{
+		// passing in radius*radius allows us to do a distance check without any calls to sqrt
+		FSection *sect = Level->PointInRenderSubsector(Pos)->section;
+		CollectWithinRadius(worker, Pos, sect, float(radius*radius));
+	}
+}
+
 //==========================================================================
 //
 // Link the light into the world
 //
 //==========================================================================
 
-void FDynamicLight::LinkLight()
+void FDynamicLight::ApplyLinks(FSection *const *sections, unsigned numsections, side_t *const *sides, unsigned numsides)
 {
 	// mark the old light nodes
 	FLightNode * node;
-	
+
 	node = touching_sides;
 	while (node)
     {
@@ -672,20 +757,18 @@ void FDynamicLight::LinkLight()
 		node = node->nextTarget;
 	}
 
-	if (radius>0)
+	for (unsigned i = 0; i < numsections; i++)
 	{
-		// passing in radius*radius allows us to do a distance check without any calls to sqrt
-		FSection *sect = Level->PointInRenderSubsector(Pos)->section;
-
-		dl_validcount++;
-		::validcount++;
-		CollectWithinRadius(Pos, sect, float(radius*radius));
-
+		touching_sector = AddLightNode(&sections[i]->lighthead, sections[i], this, touching_sector);
 	}
-		
+	for (unsigned i = 0; i < numsides; i++)
+	{
+		touching_sides = AddLightNode(&sides[i]->lighthead, sides[i], this, touching_sides);
+	}
+
 	// Now delete any nodes that won't be used. These are the ones where
 	// m_thing is still nullptr.
-	
+
 	node = touching_sides;
 	while (node)
 	{
@@ -709,6 +792,130 @@ void FDynamicLight::LinkLight()
 	}
 }
 
+//==========================================================================
+//
+// Relinks all lights that moved or changed size during this tic.
+//
+// The lights do not depend on each other, so collecting what they touch
+// is spread over several threads when there are enough of them. The node
+// lists are shared between lights though, so linking them is done here
+// afterwards, in the order of the light list. That keeps the lists the
+// same no matter which thread collected which light.
+//
+//==========================================================================
+
+struct LightLinkResult
+{
+	FDynamicLight *light;
+	int worker;
+	unsigned firstSection, numSections;
+	unsigned firstSide, numSides;
+};
+
+enum
+{
+	MaxLinkWorkers = 8,
+	MinLightsPerWorker = 32,
+};
+
+static FLightLinkWorker LinkWorkers[MaxLinkWorkers];
+static TArray<LightLinkResult> LinkResults;
+static ctpl::thread_pool *LinkPool;
+static int LightsRelinked, LightsUnchanged, LinkWorkersUsed;
+static cycle_t LinkCycles;
+
+static int LinkWorkerCount(int numlights)
+{
+	int threads = r_lightlink_threads;
+	if (threads <= 0) threads = clamp<int>(std::thread::hardware_concurrency(), 1, 4);
+	return clamp<int>(numlights / MinLightsPerWorker, 1, MIN<int>(threads, MaxLinkWorkers));
+}
+
+static void CollectLightLinks(int index, std::atomic<unsigned> &nextlight)
+{
+	auto &worker = LinkWorkers[index];
+	unsigned count = LinkResults.Size();
+	for (unsigned i = nextlight.fetch_add(1); i < count; i = nextlight.fetch_add(1))
+	{
+		auto &result = LinkResults[i];
+		result.worker = index;
+		result.firstSection = worker.sections.Size();
+		result.firstSide = worker.sides.Size();
+		result.light->CollectLinks(worker);
+		result.numSections = worker.sections.Size() - result.firstSection;
+		result.numSides = worker.sides.Size() - result.firstSide;
+	}
+}
+
+void FLevelLocals::LinkDynamicLights()
+{
+	LinkCycles.Reset();
+	LinkCycles.Clock();
+
+	LinkResults.Clear();
+	LightsUnchanged = 0;
+	for (auto light = lights; light; light = light->next)
+	{
+		if (light->m_linkPending)
+		{
+			light->m_linkPending = false;
+			LinkResults.Push({ light });
+		}
+		else if (light->IsActive())
+		{
+			LightsUnchanged++;
+		}
+	}
+	LightsRelinked = LinkResults.Size();
+
+	int numworkers = LinkWorkerCount(LightsRelinked);
+	LinkWorkersUsed = LightsRelinked > 0 ? numworkers : 0;
+	if (LightsRelinked > 0)
+	{
+		for (int i = 0; i < numworkers; i++)
+		{
+			LinkWorkers[i].Prepare(this);
+		}
+
+		std::atomic<unsigned> nextlight(0);
+		if (numworkers > 1)
+		{
+			if (LinkPool == nullptr) LinkPool = new ctpl::thread_pool(numworkers - 1);
+			else if (LinkPool->size() < numworkers - 1) LinkPool->resize(numworkers - 1);
+
+			std::future<void> futures[MaxLinkWorkers];
+			for (int i = 1; i < numworkers; i++)
+			{
+				futures[i] = LinkPool->push([i, &nextlight](int) { CollectLightLinks(i, nextlight); });
+			}
+			CollectLightLinks(0, nextlight);
+			for (int i = 1; i < numworkers; i++)
+			{
+				futures[i].wait();
+			}
+		}
+		else
+		{
+			CollectLightLinks(0, nextlight);
+		}
+
+		for (auto &result : LinkResults)
+		{
+			auto &worker = LinkWorkers[result.worker];
+			result.light->ApplyLinks(worker.sections.Data() + result.firstSection, result.numSections, worker.sides.Data() + result.firstSide, result.numSides);
+		}
+	}
+
+	LinkCycles.Unclock();
+}
+
+ADD_STAT(lightlinks)
+{
+	FString out;
+	out.Format("Dynamic lights: %d relinked, %d unchanged, %d threads, %04.2f ms", LightsRelinked, LightsUnchanged, LinkWorkersUsed, LinkCycles.TimeMS());
+	return out;
+}
+
 
 //==========================================================================
 //
@@ -9,6 +9,7 @@ struct seg_t;
 
 class FSerializer;
 struct FSectionLine;
+struct FLightLinkWorker;
 
 enum ELightType
 {
@@ -160,6 +161,32 @@ struct FLightNode
 	};
 };
 
+//==========================================================================
+//
+// Everything that goes into the hardware renderer's shader data for a light.
+// It gets compared once per scene to find the lights that changed.
+//
+//==========================================================================
+
+struct FLightDataState
+{
+	DVector3 Pos;
+	float radius;
+	int color;
+	int flags;
+	int shadowmapIndex;
+	int portalGroup;
+	double spotInner, spotOuter, pitch, yaw;
+	bool active;
+
+	bool operator==(const FLightDataState &other) const
+	{
+		return Pos == other.Pos && radius == other.radius && color == other.color && flags == other.flags &&
+			shadowmapIndex == other.shadowmapIndex && portalGroup == other.portalGroup && spotInner == other.spotInner &&
+			spotOuter == other.spotOuter && pitch == other.pitch && yaw == other.yaw && active == other.active;
+	}
+};
+
 struct FDynamicLight
 {
 	friend class FLightDefaults;
@@ -205,13 +232,16 @@ struct FDynamicLight
 
 	void Tick();
 	void UpdateLocation();
-	void LinkLight();
 	void UnlinkLight();
 	void ReleaseLight();
 
+	// Linking is done in two halves, so that the first one can run for many lights at once.
+	void CollectLinks(FLightLinkWorker &worker);
+	void ApplyLinks(FSection *const *sections, unsigned numsections, side_t *const *sides, unsigned numsides);
+
 private:
 	double DistToSeg(const DVector3 &pos, vertex_t *start, vertex_t *end);
-	void CollectWithinRadius(const DVector3 &pos, FSection *section, float radius);
+	void CollectWithinRadius(FLightLinkWorker &worker, const DVector3 &pos, FSection *section, float radius);
 
 public:
 	FCycler m_cycler;
@@ -238,7 +268,10 @@ public:
 	int m_tickCount;
 	int m_lastUpdate;
 	int mShadowmapIndex;
+	unsigned mDataVersion;		// changes whenever mDataState does. 0 until the renderer has seen the light.
+	FLightDataState mDataState;
 	bool m_active;
+	bool m_linkPending;		// moved or changed size this tic, gets relinked by FLevelLocals::LinkDynamicLights
 	bool visibletoplayer;
 	bool shadowmapped;
 	uint8_t lighttype;
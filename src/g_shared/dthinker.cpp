@@ -130,6 +130,7 @@ void FThinkerCollection::RunThinkers(FLevelLocals *Level)
 			light->Tick();
 			light = next;
 		}
+		Level->LinkDynamicLights();
 	}
 	else
 	{
@@ -160,6 +161,7 @@ void FThinkerCollection::RunThinkers(FLevelLocals *Level)
 			light->Tick();
 			light = next;
 		}
+		Level->LinkDynamicLights();
 		prof.timer.Unclock();
 
 
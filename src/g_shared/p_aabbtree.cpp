@@ -22,12 +22,9 @@
 
 #include "r_state.h"
 #include "g_levellocals.h"
-#include "hw_aabbtree.h"
+#include "p_aabbtree.h"
 
-namespace hwrenderer
-{
-
-LevelAABBTree::LevelAABBTree(FLevelLocals *lev)
+LevelAABBTree::LevelAABBTree(FLevelLocals *lev, bool alllines) : alllines(alllines)
 {
 	Level = lev;
 	// Calculate the center of all lines
@@ -85,9 +82,11 @@ bool LevelAABBTree::GenerateTree(const FVector2 *centroids, bool dynamicsubtree)
 	auto &maplines = Level->lines;
 	for (unsigned int i = 0; i < maplines.Size(); i++)
 	{
-		if (!maplines[i].backsector)
+		if (alllines || !maplines[i].backsector)
 		{
-			bool isPolyLine = maplines[i].sidedef[0] && (maplines[i].sidedef[0]->Flags & WALLF_POLYOBJ);
+			// A two-sided polyobject line may belong to it through its back side.
+			bool isPolyLine = (maplines[i].sidedef[0] && (maplines[i].sidedef[0]->Flags & WALLF_POLYOBJ)) ||
+				(maplines[i].sidedef[1] && (maplines[i].sidedef[1]->Flags & WALLF_POLYOBJ));
 			if (isPolyLine && dynamicsubtree)
 			{
 				line_elements.Push(mapLines.Size());
@@ -115,6 +114,7 @@ bool LevelAABBTree::GenerateTree(const FVector2 *centroids, bool dynamicsubtree)
 
 bool LevelAABBTree::Update()
 {
+	dirty = false;
 	bool modified = false;
 	for (unsigned int i = dynamicStartLine; i < mapLines.Size(); i++)
 	{
@@ -235,6 +235,56 @@ double LevelAABBTree::RayTest(const DVector3 &ray_start, const DVector3 &ray_end
 	return hit_fraction;
 }
 
+void LevelAABBTree::FindLines(const DVector2 &start, const DVector2 &end, TArray<line_t *> &lines)
+{
+	if (nodes.Size() == 0)
+		return;
+
+	if (dirty)
+		Update();
+
+	// The nodes are stored with float precision, so they get some room to make sure no line is missed.
+	const double margin = 1.0;
+	DVector2 halfdelta = (end - start) * 0.5;
+	DVector2 center = start + halfdelta;
+
+	searchStack.Clear();
+	searchStack.Push(nodes.Size() - 1); // root node is the last node in the list
+	int node_index;
+	while (searchStack.Pop(node_index))
+	{
+		const AABBTreeNode &node = nodes[node_index];
+		if (!OverlapSegmentAABB(center, halfdelta, node, margin))
+			continue;
+
+		if (node.line_index != -1)
+		{
+			lines.Push(&Level->lines[mapLines[node.line_index]]);
+		}
+		else
+		{
+			searchStack.Push(node.right_node);
+			searchStack.Push(node.left_node);
+		}
+	}
+}
+
+bool LevelAABBTree::OverlapSegmentAABB(const DVector2 &center, const DVector2 &halfdelta, const AABBTreeNode &node, double margin)
+{
+	// Separating axis test with the two box axes and the segment's normal
+	double hx = (node.aabb_right - node.aabb_left) * 0.5 + margin;
+	double hy = (node.aabb_bottom - node.aabb_top) * 0.5 + margin;
+	double cx = center.X - (node.aabb_right + node.aabb_left) * 0.5;
+	double cy = center.Y - (node.aabb_bottom + node.aabb_top) * 0.5;
+	double wx = fabs(halfdelta.X);
+	double wy = fabs(halfdelta.Y);
+
+	if (fabs(cx) > wx + hx || fabs(cy) > wy + hy)
+		return false;
+
+	return fabs(cx * halfdelta.Y - cy * halfdelta.X) <= hx * wy + hy * wx;
+}
+
 bool LevelAABBTree::OverlapRayAABB(const DVector2 &ray_start2d, const DVector2 &ray_end2d, const AABBTreeNode &node)
 {
 	// To do: simplify test to use a 2D test
@@ -406,5 +456,16 @@ int LevelAABBTree::GenerateTreeNode(int *lines, int num_lines, const FVector2 *c
 	return (int)nodes.Size() - 1;
 }
 
+//==========================================================================
+//
+// The tree the play simulation uses for sight checks. It contains all
+// lines and gets built the first time it is needed.
+//
+//==========================================================================
 
+LevelAABBTree *FLevelLocals::GetAABBTree()
+{
+	if (aabbTree == nullptr)
+		aabbTree = new LevelAABBTree(this, true);
+	return aabbTree;
 }
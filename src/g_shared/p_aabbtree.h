@@ -5,9 +5,7 @@
 #include "vectors.h"
 
 struct FLevelLocals;
-
-namespace hwrenderer
-{
+struct line_t;
 
 // Node in a binary AABB tree
 struct AABBTreeNode
@@ -38,17 +36,26 @@ struct AABBTreeLine
 };
 
 // Axis aligned bounding box tree used for ray testing treelines.
+// The shadowmaps use one with the one-sided lines, the play simulation one with all lines (see FLevelLocals::GetAABBTree).
+// Polyobject lines are kept in a subtree of their own, which Update refits after they moved.
 class LevelAABBTree
 {
 public:
 	// Constructs a tree for the current level
-	LevelAABBTree(FLevelLocals *lev);
+	LevelAABBTree(FLevelLocals *lev, bool alllines = false);
 
 	// Shoot a ray from ray_start to ray_end and return the closest hit as a fractional value between 0 and 1. Returns 1 if no line was hit.
 	double RayTest(const DVector3 &ray_start, const DVector3 &ray_end);
 
+	// Adds every line whose bounding box may touch the segment from start to end. The result can contain lines
+	// that are not crossed, but never misses one that is, so callers must still do their own intersection tests.
+	void FindLines(const DVector2 &start, const DVector2 &end, TArray<line_t *> &lines);
+
 	bool Update();
 
+	// Polyobjects moved, so the dynamic subtree must be refit before the next search.
+	void MarkDirty() { dirty = true; }
+
 	const void *Nodes() const { return nodes.Data(); }
 	const void *Lines() const { return treelines.Data(); }
 	size_t NodesSize() const { return nodes.Size() * sizeof(AABBTreeNode); }
@@ -67,6 +74,9 @@ private:
 	// Test if a ray overlaps an AABB node or not
 	bool OverlapRayAABB(const DVector2 &ray_start2d, const DVector2 &ray_end2d, const AABBTreeNode &node);
 
+	// Same for a segment, with the node grown by margin on each side
+	static bool OverlapSegmentAABB(const DVector2 &center, const DVector2 &halfdelta, const AABBTreeNode &node, double margin);
+
 	// Intersection test between a ray and a line segment
 	double IntersectRayLine(const DVector2 &ray_start, const DVector2 &ray_end, int line_index, const DVector2 &raydelta, double rayd, double raydist2);
 
@@ -83,9 +93,10 @@ private:
 
 	int dynamicStartNode = 0;
 	int dynamicStartLine = 0;
+	bool alllines;
+	bool dirty = false;
 
 	TArray<int> mapLines;
+	TArray<int> searchStack;
 	FLevelLocals *Level;
 };
-
-} // namespace
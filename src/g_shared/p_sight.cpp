@@ -36,10 +36,15 @@
 
 #include "g_levellocals.h"
 #include "actorinlines.h"
+#include "p_aabbtree.h"
 
 static FRandom pr_botchecksight ("BotCheckSight");
 static FRandom pr_checksight ("CheckSight");
 
+// Sight checks at least this long collect their lines from the level's AABB tree instead of the blockmap. 0 disables it.
+// For testing only. Sight checks affect the playsim, so this is neither archived nor synchronized and must stay off in demos and netgames.
+CVAR(Float, sight_treedistance, 0.f, 0)
+
 /*
 ==============================================================================
 
@@ -89,6 +94,7 @@ struct SightTask
 
 static TArray<intercept_t> intercepts (128);
 static TArray<SightTask> portals(32);
+static TArray<line_t *> treelines(128);
 
 class SightCheck
 {
@@ -113,8 +119,10 @@ class SightCheck
 	bool PTR_SightTraverse (intercept_t *in);
 	bool P_SightCheckLine (line_t *ld);
 	int P_SightBlockLinesIterator (int x, int y);
-	bool P_SightTraverseIntercepts ();
+	bool P_SightTraverseIntercepts (bool sortbyindex = false);
 	bool LineBlocksSight(line_t *ld);
+	bool UseAABBTree ();
+	bool P_SightTreeTraverse ();
 
 public:
 	SightCheck(FLevelLocals *l)
@@ -532,7 +540,7 @@ int SightCheck::P_SightBlockLinesIterator (int x, int y)
 ====================
 */
 
-bool SightCheck::P_SightTraverseIntercepts ()
+bool SightCheck::P_SightTraverseIntercepts (bool sortbyindex)
 {
 	unsigned count;
 	double dist;
@@ -559,6 +567,11 @@ bool SightCheck::P_SightTraverseIntercepts ()
 //
 // go through in order
 // proper order is needed to handle 3D floors and portals.
+//
+// The AABB tree collects the lines in a different order than the blockmap,
+// so for its lines those that are crossed at the same spot go by line number
+// to get the same result for the same lines. The blockmap path keeps the
+// order it always had.
 //
 	in = NULL;
 
@@ -568,7 +581,7 @@ bool SightCheck::P_SightTraverseIntercepts ()
 		for (scanpos = 0; scanpos < intercepts.Size (); scanpos++)
 		{
 			scan = &intercepts[scanpos];
-			if (scan->frac < dist)
+			if (scan->frac < dist || (sortbyindex && dist < INT_MAX && scan->frac == dist && scan->d.line->Index() < in->d.line->Index()))
 			{
 				dist = scan->frac;
 				in = scan;
@@ -607,6 +620,75 @@ bool SightCheck::P_SightTraverseIntercepts ()
 
 
 
+/*
+==================
+=
+= UseAABBTree
+=
+= The tree only replaces the blockmap where it finds exactly the same lines.
+= With portals the blockmap walk can stop collecting lines part way, and
+= it gives up outside the blockmap and after 1000 blocks.
+=
+==================
+*/
+
+bool SightCheck::UseAABBTree ()
+{
+	double mindist = sight_treedistance;
+	if (mindist <= 0 || Startfrac != 0)
+		return false;
+
+	if (Trace.dx * Trace.dx + Trace.dy * Trace.dy < mindist * mindist)
+		return false;
+
+	auto &portalmap = Level->PortalBlockmap;
+	if (portalmap.containsLines || portalmap.hasLinkedSectorPortals || portalmap.hasLinkedPolyPortals)
+		return false;
+
+	// Same block coordinates as P_SightPathTraverse
+	auto &bmap = Level->blockmap;
+	int x1 = xs_FloorToInt((sightstart.X - bmap.bmaporgx) / FBlockmap::MAPBLOCKUNITS);
+	int y1 = xs_FloorToInt((sightstart.Y - bmap.bmaporgy) / FBlockmap::MAPBLOCKUNITS);
+	int x2 = xs_FloorToInt((sightend.X - bmap.bmaporgx) / FBlockmap::MAPBLOCKUNITS);
+	int y2 = xs_FloorToInt((sightend.Y - bmap.bmaporgy) / FBlockmap::MAPBLOCKUNITS);
+	if (!bmap.isValidBlock(x1, y1) || !bmap.isValidBlock(x2, y2))
+		return false;
+
+	return abs(x2 - x1) + abs(y2 - y1) < 999;
+}
+
+/*
+==================
+=
+= P_SightTreeTraverse
+=
+= Same as P_SightPathTraverse without portals, with the lines coming from
+= the level's AABB tree. For long traces this visits far fewer lines than
+= walking all the blocks along the way.
+=
+==================
+*/
+
+bool SightCheck::P_SightTreeTraverse ()
+{
+	treelines.Clear();
+	Level->GetAABBTree()->FindLines(sightstart.XY(), sightend, treelines);
+
+	for (auto ld : treelines)
+	{
+		if (!P_SightCheckLine(ld))
+		{
+			sightcounts[1]++;
+			return false;	// early out
+		}
+	}
+
+	sightcounts[2]++;
+	bool traverseres = P_SightTraverseIntercepts(true);
+	if (seeingthing->Sector->PortalGroup != portalgroup) return false;
+	return traverseres;
+}
+
 /*
 ==================
 =
@@ -667,6 +749,11 @@ bool SightCheck::P_SightPathTraverse ()
 		portals.Push({ 0, topslope, bottomslope, sector_t::floor, lastsector->GetOppositePortalGroup(sector_t::floor) });
 	}
 
+	if (UseAABBTree())
+	{
+		return P_SightTreeTraverse();
+	}
+
 	x1 -= Level->blockmap.bmaporgx;
 	y1 -= Level->blockmap.bmaporgy;
 	xt1 = x1 / FBlockmap::MAPBLOCKUNITS;
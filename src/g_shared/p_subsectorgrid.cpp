@@ -0,0 +1,280 @@
+/*
+** p_subsectorgrid.cpp
+** Uniform grid for finding the subsector a point is in
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 agent
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** benchpointlookup [count]
+**
+** Looks up the render subsectors of count random points in the current
+** level, first by walking the BSP from the root and then through the
+** grid, and prints the lookups per second of both. The game nodes are
+** checked the same way through PointInSector. Both ways must find the
+** same subsectors.
+**
+*/
+
+#include <chrono>
+#include "c_dispatch.h"
+#include "doomstat.h"
+#include "g_game.h"
+#include "g_levellocals.h"
+#include "r_utility.h"
+#include "p_subsectorgrid.h"
+
+enum
+{
+	CellShift = FRACBITS + 7,	// 128 map units
+	MaxCells = 1 << 18,
+};
+
+//==========================================================================
+//
+// Which side of the node's partition line a corner of a block of cells is
+// on, computed exactly like R_PointOnSide. The side test is linear in x
+// and y, so if all four corners are on the same side, every point of the
+// block is. Returns -1 if the corner is too far from the partition line
+// for R_PointOnSide's 32 bit math, which wraps around there.
+//
+//==========================================================================
+
+static int CornerSide(const node_t *node, int64_t x, int64_t y)
+{
+	int64_t a = y - node->y;
+	int64_t c = node->x - x;
+	if (a < INT32_MIN || a > INT32_MAX || c < INT32_MIN || c > INT32_MAX) return -1;
+	return ((a * node->dx + c * node->dy) >> 32) > 0;
+}
+
+static int BoxSide(const node_t *node, int64_t left, int64_t bottom, int64_t right, int64_t top)
+{
+	int side = CornerSide(node, left, bottom);
+	if (side < 0 || CornerSide(node, right, bottom) != side || CornerSide(node, left, top) != side || CornerSide(node, right, top) != side)
+	{
+		return -1;
+	}
+	return side;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FSubsectorGrid::Clear()
+{
+	cells.Reset();
+	width = height = 0;
+}
+
+void FSubsectorGrid::Build(FLevelLocals *Level, node_t *headnode)
+{
+	Clear();
+	if (headnode == nullptr || Level->vertexes.Size() == 0) return;
+
+	int64_t minx = INT64_MAX, miny = INT64_MAX, maxx = INT64_MIN, maxy = INT64_MIN;
+	for (auto &v : Level->vertexes)
+	{
+		int64_t x = FLOAT2FIXED(v.fX());
+		int64_t y = FLOAT2FIXED(v.fY());
+		minx = MIN(minx, x);
+		miny = MIN(miny, y);
+		maxx = MAX(maxx, x);
+		maxy = MAX(maxy, y);
+	}
+
+	// Big levels get bigger cells to keep the grid's size in check.
+	shift = CellShift;
+	while ((((maxx - minx) >> shift) + 1) * (((maxy - miny) >> shift) + 1) > MaxCells) shift++;
+
+	originX = minx;
+	originY = miny;
+	width = unsigned(((maxx - minx) >> shift) + 1);
+	height = unsigned(((maxy - miny) >> shift) + 1);
+	cells.Resize(width * height);
+	Fill(headnode, 0, 0, width, height);
+}
+
+//==========================================================================
+//
+// Walks down the tree as far as the whole block of cells stays on one
+// side of the partition lines, then splits the block in two and goes on
+// with each half.
+//
+//==========================================================================
+
+void FSubsectorGrid::Fill(void *node, unsigned x0, unsigned y0, unsigned x1, unsigned y1)
+{
+	int64_t left = originX + (int64_t(x0) << shift);
+	int64_t bottom = originY + (int64_t(y0) << shift);
+	int64_t right = originX + (int64_t(x1) << shift) - 1;
+	int64_t top = originY + (int64_t(y1) << shift) - 1;
+
+	while (!((size_t)node & 1))
+	{
+		auto bspnode = (node_t *)node;
+		int side = BoxSide(bspnode, left, bottom, right, top);
+		if (side < 0) break;
+		node = bspnode->children[side];
+	}
+
+	if (((size_t)node & 1) || (x1 - x0 == 1 && y1 - y0 == 1))
+	{
+		for (unsigned y = y0; y < y1; y++)
+		{
+			for (unsigned x = x0; x < x1; x++)
+			{
+				cells[y * width + x] = node;
+			}
+		}
+	}
+	else if (x1 - x0 >= y1 - y0)
+	{
+		unsigned mid = (x0 + x1) / 2;
+		Fill(node, x0, y0, mid, y1);
+		Fill(node, mid, y0, x1, y1);
+	}
+	else
+	{
+		unsigned mid = (y0 + y1) / 2;
+		Fill(node, x0, y0, x1, mid);
+		Fill(node, x0, mid, x1, y1);
+	}
+}
+
+unsigned FSubsectorGrid::CountLeafCells() const
+{
+	unsigned count = 0;
+	for (auto cell : cells)
+	{
+		if ((size_t)cell & 1) count++;
+	}
+	return count;
+}
+
+//==========================================================================
+//
+// The benchmark's reference: the plain walk from the root.
+//
+//==========================================================================
+
+static subsector_t *WalkBSP(node_t *node, fixed_t x, fixed_t y, int *steps = nullptr)
+{
+	void *child = node;
+	while (!((size_t)child & 1))
+	{
+		node = (node_t *)child;
+		child = node->children[R_PointOnSide(x, y, node)];
+		if (steps) (*steps)++;
+	}
+	return (subsector_t *)((uint8_t *)child - 1);
+}
+
+CCMD(benchpointlookup)
+{
+	if (gamestate != GS_LEVEL || primaryLevel->HeadNode() == nullptr)
+	{
+		Printf("benchpointlookup needs a level to be loaded.\n");
+		return;
+	}
+
+	auto Level = primaryLevel;
+	int count = argv.argc() > 1 ? clamp(atoi(argv[1]), 1000, 10000000) : 1000000;
+
+	double minx = DBL_MAX, miny = DBL_MAX, maxx = -DBL_MAX, maxy = -DBL_MAX;
+	for (auto &v : Level->vertexes)
+	{
+		minx = MIN(minx, v.fX());
+		miny = MIN(miny, v.fY());
+		maxx = MAX(maxx, v.fX());
+		maxy = MAX(maxy, v.fY());
+	}
+
+	TArray<DVector2> points(count, true);
+	uint32_t seed = 0x12345678;
+	for (auto &p : points)
+	{
+		seed = seed * 1664525 + 1013904223;
+		p.X = minx + (maxx - minx) * (seed >> 8) / double(1 << 24);
+		seed = seed * 1664525 + 1013904223;
+		p.Y = miny + (maxy - miny) * (seed >> 8) / double(1 << 24);
+	}
+
+	TArray<subsector_t *> reference(count, true);
+	TArray<subsector_t *> result(count, true);
+
+	auto time = [&](auto &&lookup)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < count; i++) lookup(i);
+		auto end = std::chrono::steady_clock::now();
+		return count / std::chrono::duration<double>(end - start).count() / 1e6;
+	};
+
+	node_t *head = Level->HeadNode();
+	double walk = time([&](int i) { reference[i] = WalkBSP(head, FloatToFixed(points[i].X), FloatToFixed(points[i].Y)); });
+	double grid = time([&](int i) { result[i] = Level->PointInRenderSubsector(points[i]); });
+
+	int mismatches = 0;
+	int walksteps = 0, gridsteps = 0;
+	auto &rgrid = Level->renderSubsectorGrid;
+	for (int i = 0; i < count; i++)
+	{
+		if (reference[i] != result[i]) mismatches++;
+
+		fixed_t x = FloatToFixed(points[i].X), y = FloatToFixed(points[i].Y);
+		WalkBSP(head, x, y, &walksteps);
+		void *start = rgrid.GetStart(x, y);
+		if (start == nullptr) WalkBSP(head, x, y, &gridsteps);
+		else if (!((size_t)start & 1)) WalkBSP((node_t *)start, x, y, &gridsteps);
+	}
+
+	Printf("%d points, grid %ux%u with %g unit cells, %u of them in a single subsector\n", count, rgrid.Width(), rgrid.Height(),
+		rgrid.CellSize(), rgrid.CountLeafCells());
+	Printf("render nodes: walk %6.2f M/s (%.2f nodes), grid %6.2f M/s (%.2f nodes), %.2fx%s\n", walk, walksteps / double(count),
+		grid, gridsteps / double(count), grid / walk, mismatches ? FStringf("  (%d points differ)", mismatches).GetChars() : "");
+
+	node_t *gamehead = Level->HeadGamenode();
+	if (gamehead != head)
+	{
+		TArray<sector_t *> refsectors(count, true);
+		TArray<sector_t *> sectors(count, true);
+		walk = time([&](int i) { refsectors[i] = WalkBSP(gamehead, FloatToFixed(points[i].X), FloatToFixed(points[i].Y))->sector; });
+		grid = time([&](int i) { sectors[i] = Level->PointInSector(points[i]); });
+
+		mismatches = 0;
+		for (int i = 0; i < count; i++)
+		{
+			if (refsectors[i] != sectors[i]) mismatches++;
+		}
+		Printf("game nodes:   walk %6.2f M/s, grid %6.2f M/s, %.2fx%s\n", walk, grid, grid / walk,
+			mismatches ? FStringf("  (%d points differ)", mismatches).GetChars() : "");
+	}
+}
@@ -0,0 +1,46 @@
+
+#pragma once
+
+#include <stdint.h>
+#include "tarray.h"
+#include "basictypes.h"
+
+struct FLevelLocals;
+struct node_t;
+
+// Uniform grid over a level that remembers, for each cell, the deepest BSP
+// node whose subtree contains the whole cell. Most cells lie entirely in one
+// subsector, so a point lookup starts right at the leaf or a few nodes above.
+// The walk from there is the same as from the root, so the result is too.
+class FSubsectorGrid
+{
+public:
+	void Build(FLevelLocals *Level, node_t *headnode);
+	void Clear();
+
+	// Where to start walking the BSP for the given point, or nullptr if the point is outside the grid.
+	// Like the node children the pointer has bit 0 set if it already is the subsector.
+	void *GetStart(fixed_t x, fixed_t y) const
+	{
+		int64_t dx = int64_t(x) - originX;
+		int64_t dy = int64_t(y) - originY;
+		if (dx < 0 || dy < 0) return nullptr;
+		uint64_t cx = uint64_t(dx) >> shift;
+		uint64_t cy = uint64_t(dy) >> shift;
+		if (cx >= width || cy >= height) return nullptr;
+		return cells[unsigned(cy) * width + unsigned(cx)];
+	}
+
+	unsigned Width() const { return width; }
+	unsigned Height() const { return height; }
+	double CellSize() const { return double(int64_t(1) << shift) / 65536.; }
+	unsigned CountLeafCells() const;
+
+private:
+	void Fill(void *node, unsigned x0, unsigned y0, unsigned x1, unsigned y1);
+
+	TArray<void *> cells;
+	int64_t originX = 0, originY = 0;
+	unsigned width = 0, height = 0;
+	int shift = 0;
+};
@@ -37,6 +37,7 @@
 #include "p_maputl.h"
 #include "r_utility.h"
 #include "g_levellocals.h"
+#include "p_aabbtree.h"
 #include "actorinlines.h"
 #include "v_text.h"
 
@@ -1174,6 +1175,8 @@ void FPolyObj::LinkPolyobj ()
 		vt = Sidedefs[i]->linedef->v2;
 		Bounds.AddToBox(vt->fPos());
 	}
+	if (Level->aabbTree) Level->aabbTree->MarkDirty();
+
 	bbox[BOXRIGHT] = Level->blockmap.GetBlockX(Bounds.Right());
 	bbox[BOXLEFT] = Level->blockmap.GetBlockX(Bounds.Left());
 	bbox[BOXTOP] = Level->blockmap.GetBlockY(Bounds.Top());
@@ -40,11 +40,16 @@
 #include "v_text.h"
 #include "w_wad.h"
 #include "w_zip.h"
+#include "m_misc.h"
+#include "c_cvars.h"
+#include "version.h"
 
 #include "ancientzip.h"
 
 #define BUFREADCOMMENT (0x400)
 
+CVAR(Bool, fs_cachezipdirectories, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
 //==========================================================================
 //
 // Decompression subroutine
@@ -159,6 +164,177 @@ static uint32_t Zip_FindCentralDir(FileReader &fin)
 	return uPosFound;
 }
 
+//==========================================================================
+//
+// Directory cache
+//
+// Stores the parsed lump table of an archive, keyed by the archive's path,
+// size and modification time, so that unchanged archives can be mounted
+// without rescanning the central directory.
+//
+// The table holds namespaces and flags as the engine assigned them, so a
+// cache is only used by the exact build that wrote it.
+//
+//==========================================================================
+
+static const char ZipCacheMagic[4] = { 'Z', 'D', 'C', '2' };
+
+static FString GetDirectoryCacheVersion()
+{
+	return FStringf("%s %s", GetVersionString(), GetGitHash());
+}
+
+static FString CreateDirectoryCacheName(const char *filename, bool create)
+{
+	FString path = M_GetCachePath(create);
+	path << "/archives";
+	if (create) CreatePath(path);
+
+	uint64_t key = FWadCollection::FullNameKey(filename, strlen(filename));
+	path.AppendFormat("/%08x%08x.zdc", uint32_t(key >> 32), uint32_t(key));
+	return path;
+}
+
+static void WriteCacheInt(TArray<uint8_t> &f, uint32_t v)
+{
+	int p = f.Reserve(4);
+	f[p] = (uint8_t)v;
+	f[p+1] = (uint8_t)(v >> 8);
+	f[p+2] = (uint8_t)(v >> 16);
+	f[p+3] = (uint8_t)(v >> 24);
+}
+
+static void WriteCacheString(TArray<uint8_t> &f, const char *str, size_t len)
+{
+	WriteCacheInt(f, (uint32_t)len);
+	if (len > 0)
+	{
+		int p = f.Reserve(len);
+		memcpy(&f[p], str, len);
+	}
+}
+
+void FZipFile::WriteDirectoryCache(const char *cachename, size_t filesize, time_t filetime)
+{
+	TArray<uint8_t> cache;
+
+	int p = cache.Reserve(4);
+	memcpy(&cache[p], ZipCacheMagic, 4);
+	FString version = GetDirectoryCacheVersion();
+	WriteCacheString(cache, version.GetChars(), version.Len());
+	WriteCacheInt(cache, uint32_t(uint64_t(filesize) >> 32));
+	WriteCacheInt(cache, uint32_t(filesize));
+	WriteCacheInt(cache, uint32_t(uint64_t(filetime) >> 32));
+	WriteCacheInt(cache, uint32_t(filetime));
+	WriteCacheString(cache, FileName.GetChars(), FileName.Len());
+	WriteCacheInt(cache, NumLumps);
+
+	for (uint32_t i = 0; i < NumLumps; i++)
+	{
+		FZipLump *lump = &Lumps[i];
+		WriteCacheString(cache, lump->FullName.GetChars(), lump->FullName.Len());
+		p = cache.Reserve(8);
+		memcpy(&cache[p], lump->Name, 8);
+		WriteCacheInt(cache, lump->Namespace);
+		WriteCacheInt(cache, lump->Flags | (lump->Method << 8) | (lump->GPFlags << 16));
+		WriteCacheInt(cache, lump->CRC32);
+		WriteCacheInt(cache, lump->LumpSize);
+		WriteCacheInt(cache, lump->CompressedSize);
+		WriteCacheInt(cache, lump->Position);
+	}
+
+	FileWriter *fw = FileWriter::Open(cachename);
+	if (fw != nullptr)
+	{
+		if (fw->Write(cache.Data(), cache.Size()) != cache.Size())
+		{
+			Printf("Error saving directory cache %s\n", cachename);
+		}
+		delete fw;
+	}
+}
+
+bool FZipFile::ReadDirectoryCache(const char *cachename, size_t filesize, time_t filetime)
+{
+	FileReader fr;
+
+	if (!fr.OpenFile(cachename)) return false;
+
+	// Read the whole thing at once.
+	auto cache = fr.Read();
+	const uint8_t *ptr = cache.Data();
+	const uint8_t *end = ptr + cache.Size();
+
+	auto readint = [&](uint32_t &v) -> bool
+	{
+		if (end - ptr < 4) return false;
+		v = ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | (uint32_t(ptr[3]) << 24);
+		ptr += 4;
+		return true;
+	};
+	auto readstring = [&](const char *&str, uint32_t &len) -> bool
+	{
+		if (!readint(len) || uint32_t(end - ptr) < len) return false;
+		str = (const char *)ptr;
+		ptr += len;
+		return true;
+	};
+
+	uint32_t versionlen, sizehi, sizelo, timehi, timelo, pathlen, numlumps;
+	const char *version, *path;
+
+	if (cache.Size() < 4 || memcmp(ptr, ZipCacheMagic, 4)) return false;
+	ptr += 4;
+	FString myversion = GetDirectoryCacheVersion();
+	if (!readstring(version, versionlen) || myversion.Len() != versionlen || memcmp(version, myversion.GetChars(), versionlen)) return false;
+	if (!readint(sizehi) || !readint(sizelo) || !readint(timehi) || !readint(timelo)) return false;
+	if (((uint64_t(sizehi) << 32) | sizelo) != uint64_t(filesize)) return false;
+	if (((uint64_t(timehi) << 32) | timelo) != uint64_t(filetime)) return false;
+	if (!readstring(path, pathlen) || FileName.Len() != pathlen || memcmp(path, FileName.GetChars(), pathlen)) return false;
+	if (!readint(numlumps)) return false;
+
+	// Every entry takes at least 36 bytes: the name's length, the short name and six ints.
+	// Anything claiming more lumps than that is corrupt, so don't try to allocate them.
+	if (numlumps > size_t(end - ptr) / 36) return false;
+
+	Lumps = new FZipLump[numlumps];
+	for (uint32_t i = 0; i < numlumps; i++)
+	{
+		FZipLump *lump = &Lumps[i];
+		const char *name, *shortname = nullptr;
+		uint32_t namelen, ns, flags, crc, size, csize, pos;
+
+		bool ok = readstring(name, namelen) && end - ptr >= 8;
+		if (ok)
+		{
+			shortname = (const char *)ptr;
+			ptr += 8;
+			ok = readint(ns) && readint(flags) && readint(crc) && readint(size) && readint(csize) && readint(pos);
+		}
+		if (!ok)
+		{
+			// Truncated cache file.
+			delete[] Lumps;
+			Lumps = NULL;
+			return false;
+		}
+		lump->FullName = FString(name, namelen);
+		memcpy(lump->Name, shortname, 8);
+		lump->Name[8] = 0;
+		lump->Namespace = int(ns);
+		lump->Flags = uint8_t(flags);
+		lump->Method = uint8_t(flags >> 8);
+		lump->GPFlags = uint16_t(flags >> 16);
+		lump->CRC32 = crc;
+		lump->LumpSize = int(size);
+		lump->CompressedSize = int(csize);
+		lump->Position = int(pos);
+		lump->Owner = this;
+	}
+	NumLumps = numlumps;
+	return true;
+}
+
 //==========================================================================
 //
 // Zip file
@@ -173,12 +349,30 @@ FZipFile::FZipFile(const char * filename, FileReader &file)
 
 bool FZipFile::Open(bool quiet)
 {
+	FString cachename;
+	size_t filesize;
+	time_t filetime;
+
+	Lumps = NULL;
+
+	// Only files on disk can be cached. Embedded archives and archives
+	// opened from lumps are always read from their central directory.
+	if (fs_cachezipdirectories && GetFileInfo(FileName, &filesize, &filetime) && filesize == (size_t)Reader.GetLength())
+	{
+		cachename = CreateDirectoryCacheName(FileName, false);
+		if (ReadDirectoryCache(cachename, filesize, filetime))
+		{
+			if (!quiet && !batchrun) Printf(TEXTCOLOR_NORMAL ", %d lumps (cached)\n", NumLumps);
+			PostProcessArchive(&Lumps[0], sizeof(FZipLump));
+			return true;
+		}
+		cachename = CreateDirectoryCacheName(FileName, true);
+	}
+
 	uint32_t centraldir = Zip_FindCentralDir(Reader);
 	FZipEndOfCentralDirectory info;
 	int skipped = 0;
 
-	Lumps = NULL;
-
 	if (centraldir == 0)
 	{
 		if (!quiet) Printf(TEXTCOLOR_RED "\n%s: ZIP file corrupt!\n", FileName.GetChars());
@@ -362,6 +556,9 @@ bool FZipFile::Open(bool quiet)
 	free(directory);
 
 	if (!quiet && !batchrun) Printf(TEXTCOLOR_NORMAL ", %d lumps\n", NumLumps);
+
+	// The cache must be written before the archive gets filtered because the filters depend on the game being played.
+	if (cachename.IsNotEmpty()) WriteDirectoryCache(cachename, filesize, filetime);
 	
 	PostProcessArchive(&Lumps[0], sizeof(FZipLump));
 	return true;
@@ -42,6 +42,9 @@ class FZipFile : public FResourceFile
 {
 	FZipLump *Lumps;
 
+	bool ReadDirectoryCache(const char *cachename, size_t filesize, time_t filetime);
+	void WriteDirectoryCache(const char *cachename, size_t filesize, time_t filetime);
+
 public:
 	FZipFile(const char * filename, FileReader &file);
 	virtual ~FZipFile();
@@ -35,6 +35,10 @@
 #include "bitmap.h"
 #include "r_data/r_translate.h"
 #include "r_data/colormaps.h"
+#include "c_cvars.h"
+#include "x86.h"
+
+EXTERN_CVAR(Bool, png_simd)
 
 
 //===========================================================================
@@ -456,6 +460,18 @@ void FBitmap::CopyPixelData(int originx, int originy, const uint8_t * patch, int
 			}
 		}
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__i386__) || defined(__amd64__)
+		// Plain unrotated copies are what every paletted image goes through
+		// when being converted to true color, so give them a faster path.
+		if ((inf == NULL || inf->op == OP_COPY) && step_x == 1 && png_simd && CPU.bSSE2)
+		{
+			for (int y = 0; y < srcheight; y++)
+			{
+				CopyPalettedRow_SSE2((uint32_t*)(buffer + y * Pitch), patch + y * step_y, srcwidth, (const uint32_t*)palette);
+			}
+			return;
+		}
+#endif
 		copypalettedfuncs[inf==NULL? OP_COPY : inf->op](buffer, patch, srcwidth, srcheight, Pitch, 
 														step_x, step_y, rotate, palette, inf);
 	}
@@ -174,6 +174,10 @@ void JPEG_OutputMessage (j_common_ptr cinfo)
 	Printf (TEXTCOLOR_ORANGE "JPEG failure: %s\n", buffer);
 }
 
+static void JPEG_QuietOutputMessage (j_common_ptr cinfo)
+{
+}
+
 //==========================================================================
 //
 // A JPEG texture
@@ -187,6 +191,8 @@ public:
 
 	int CopyPixels(FBitmap *bmp, int conversion) override;
 	TArray<uint8_t> CreatePalettedPixels(int conversion) override;
+	bool CanDecodeAsync() const override { return true; }
+	bool DecodePixels(FileReader &lump, FBitmap *bmp, int &trans, bool quiet) override;
 };
 
 //==========================================================================
@@ -384,15 +390,32 @@ TArray<uint8_t> FJPEGTexture::CreatePalettedPixels(int conversion)
 
 int FJPEGTexture::CopyPixels(FBitmap *bmp, int conversion)
 {
-	PalEntry pe[256];
-
+	int trans = 0;
 	auto lump = Wads.OpenLumpReader (SourceLump);
+	DecodePixels(lump, bmp, trans, false);
+	return trans;
+}
+
+//===========================================================================
+//
+// FJPEGTexture::DecodePixels
+//
+// With 'quiet' set no messages get printed so that this can be run on
+// a worker thread. Returns false if the image could not be decoded.
+//
+//===========================================================================
+
+bool FJPEGTexture::DecodePixels(FileReader &lump, FBitmap *bmp, int &trans, bool quiet)
+{
+	PalEntry pe[256];
+	bool ok = true;
 
 	jpeg_decompress_struct cinfo;
 	jpeg_error_mgr jerr;
 
+	trans = 0;
 	cinfo.err = jpeg_std_error(&jerr);
-	cinfo.err->output_message = JPEG_OutputMessage;
+	cinfo.err->output_message = quiet ? JPEG_QuietOutputMessage : JPEG_OutputMessage;
 	cinfo.err->error_exit = JPEG_ErrorExit;
 	jpeg_create_decompress(&cinfo);
 
@@ -406,7 +429,8 @@ int FJPEGTexture::CopyPixels(FBitmap *bmp, int conversion)
 			(cinfo.out_color_space == JCS_YCbCr && cinfo.num_components == 3) ||
 			(cinfo.out_color_space == JCS_GRAYSCALE && cinfo.num_components == 1)))
 		{
-			Printf(TEXTCOLOR_ORANGE "Unsupported color format in %s\n", Wads.GetLumpFullPath(SourceLump).GetChars());
+			if (!quiet) Printf(TEXTCOLOR_ORANGE "Unsupported color format in %s\n", Wads.GetLumpFullPath(SourceLump).GetChars());
+			ok = false;
 		}
 		else
 		{
@@ -454,9 +478,10 @@ int FJPEGTexture::CopyPixels(FBitmap *bmp, int conversion)
 	}
 	catch (int)
 	{
-		Printf(TEXTCOLOR_ORANGE "JPEG error in %s\n", Wads.GetLumpFullPath(SourceLump).GetChars());
+		if (!quiet) Printf(TEXTCOLOR_ORANGE "JPEG error in %s\n", Wads.GetLumpFullPath(SourceLump).GetChars());
+		ok = false;
 	}
 	jpeg_destroy_decompress(&cinfo);
-	return 0;
+	return ok;
 }
 
@@ -41,6 +41,13 @@
 #include "bitmap.h"
 #include "imagehelpers.h"
 #include "image.h"
+#include "c_dispatch.h"
+#include "i_system.h"
+#include "cmdlib.h"
+#include "stats.h"
+#include "v_text.h"
+
+EXTERN_CVAR(Bool, png_simd)
 
 //==========================================================================
 //
@@ -55,6 +62,8 @@ public:
 
 	int CopyPixels(FBitmap *bmp, int conversion) override;
 	TArray<uint8_t> CreatePalettedPixels(int conversion) override;
+	bool CanDecodeAsync() const override { return true; }
+	bool DecodePixels(FileReader &lump, FBitmap *bmp, int &trans, bool quiet) override;
 
 protected:
 	void ReadAlphaRemap(FileReader *lump, uint8_t *alpharemap);
@@ -445,26 +454,40 @@ TArray<uint8_t> FPNGTexture::CreatePalettedPixels(int conversion)
 //===========================================================================
 
 int FPNGTexture::CopyPixels(FBitmap *bmp, int conversion)
+{
+	int transpal = false;
+	auto lfr = Wads.OpenLumpReader(SourceLump);
+	DecodePixels(lfr, bmp, transpal, false);
+	return transpal;
+}
+
+//===========================================================================
+//
+// FPNGTexture::DecodePixels
+//
+// Only reads from the passed lump so that this can be run on
+// a worker thread. Returns false if the data is truncated or broken,
+// but still fills in whatever could be decoded.
+//
+//===========================================================================
+
+bool FPNGTexture::DecodePixels(FileReader &lfr, FBitmap *bmp, int &transpal, bool quiet)
 {
 	// Parse pre-IDAT chunks. I skip the CRCs. Is that bad?
 	PalEntry pe[256];
 	uint32_t len, id;
-	static char bpp[] = {1, 0, 3, 1, 2, 0, 4};
+	static const char bpp[] = {1, 0, 3, 1, 2, 0, 4};
 	int pixwidth = Width * bpp[ColorType];
-	int transpal = false;
-
-	FileReader *lump;
-	FileReader lfr;
-
-	lfr = Wads.OpenLumpReader(SourceLump);
-	lump = &lfr;
+	FileReader *lump = &lfr;
 
+	transpal = false;
 	lump->Seek(33, FileReader::SeekSet);
 	for(int i = 0; i < 256; i++)	// default to a gray map
 		pe[i] = PalEntry(255,i,i,i);
 
-	lump->Read(&len, 4);
-	lump->Read(&id, 4);
+	bool ok = true;
+	id = MAKE_ID('I','E','N','D');
+	if (lump->Read(&len, 4) != 4 || lump->Read(&id, 4) != 4) ok = false;
 	while (id != MAKE_ID('I','D','A','T') && id != MAKE_ID('I','E','N','D'))
 	{
 		len = BigLong((unsigned int)len);
@@ -502,8 +525,9 @@ int FPNGTexture::CopyPixels(FBitmap *bmp, int conversion)
 		lump->Seek(4, FileReader::SeekCur);	// Skip CRC
 		lump->Read(&len, 4);
 		id = MAKE_ID('I','E','N','D');
-		lump->Read(&id, 4);
+		if (lump->Read(&id, 4) != 4) ok = false;
 	}
+	if (id != MAKE_ID('I','D','A','T')) ok = false;	// no image data
 
 	if (ColorType == 0 && HaveTrans && NonPaletteTrans[0] < 256)
 	{
@@ -514,9 +538,8 @@ int FPNGTexture::CopyPixels(FBitmap *bmp, int conversion)
 	uint8_t * Pixels = new uint8_t[pixwidth * Height];
 
 	lump->Seek (StartOfIDAT, FileReader::SeekSet);
-	lump->Read(&len, 4);
-	lump->Read(&id, 4);
-	M_ReadIDAT (*lump, Pixels, Width, Height, pixwidth, BitDepth, ColorType, Interlace, BigLong((unsigned int)len));
+	if (lump->Read(&len, 4) != 4 || lump->Read(&id, 4) != 4 || id != MAKE_ID('I','D','A','T')) ok = false;
+	if (!M_ReadIDAT (*lump, Pixels, Width, Height, pixwidth, BitDepth, ColorType, Interlace, BigLong((unsigned int)len))) ok = false;
 
 	switch (ColorType)
 	{
@@ -553,7 +576,7 @@ int FPNGTexture::CopyPixels(FBitmap *bmp, int conversion)
 
 	}
 	delete[] Pixels;
-	return transpal;
+	return ok;
 }
 
 
@@ -642,8 +665,9 @@ FBitmap FPNGFileTexture::GetBgraBitmap(PalEntry *remap, int *trans)
 	
 	bmp.Create(Width, Height);
 	lump->Seek(33, FileReader::SeekSet);
-	lump->Read(&len, 4);
-	lump->Read(&id, 4);
+	bool ok = true;
+	id = MAKE_ID('I','E','N','D');
+	if (lump->Read(&len, 4) != 4 || lump->Read(&id, 4) != 4) ok = false;
 	while (id != MAKE_ID('I','D','A','T') && id != MAKE_ID('I','E','N','D'))
 	{
 		len = BigLong((unsigned int)len);
@@ -662,8 +686,9 @@ FBitmap FPNGFileTexture::GetBgraBitmap(PalEntry *remap, int *trans)
 		lump->Seek(4, FileReader::SeekCur);	// Skip CRC
 		lump->Read(&len, 4);
 		id = MAKE_ID('I','E','N','D');
-		lump->Read(&id, 4);
+		if (lump->Read(&id, 4) != 4) ok = false;
 	}
+	if (id != MAKE_ID('I','D','A','T')) ok = false;	// no image data
 	auto StartOfIDAT = (uint32_t)lump->Tell() - 8;
 
 	TArray<uint8_t> Pixels(pixwidth * Height);
@@ -683,3 +708,96 @@ FBitmap FPNGFileTexture::GetBgraBitmap(PalEntry *remap, int *trans)
 	}
 	return bmp;
 }
+
+//==========================================================================
+//
+// Decodes every PNG in a directory with and without the SIMD paths
+// and reports the throughput of both.
+//
+//==========================================================================
+
+CCMD(benchpngdecode)
+{
+	if (argv.argc() < 2)
+	{
+		Printf("Usage: benchpngdecode <directory> [passes]\n");
+		return;
+	}
+
+	FString dir = argv[1];
+	FixPathSeperator(dir);
+	if (dir.Back() != '/') dir += '/';
+	int passes = argv.argc() > 2 ? MAX(1, (int)strtol(argv[2], nullptr, 10)) : 3;
+
+	TArray<FString> files;
+	findstate_t findstate;
+	void *handle = I_FindFirst(dir + "*.png", &findstate);
+	if (handle != (void *)-1)
+	{
+		do
+		{
+			if (!(I_FindAttr(&findstate) & FA_DIREC))
+			{
+				files.Push(dir + I_FindName(&findstate));
+			}
+		} while (I_FindNext(handle, &findstate) == 0);
+		I_FindClose(handle);
+	}
+
+	TArray<FileReader> readers;
+	TArray<FImageSource *> images;
+	for (auto &file : files)
+	{
+		FileReader fr;
+		if (!fr.OpenFile(file)) continue;
+		auto image = PNGImage_TryCreate(fr, -1);
+		if (image == nullptr) continue;
+		images.Push(image);
+		readers.Push(std::move(fr));
+	}
+	if (images.Size() == 0)
+	{
+		Printf("No usable PNGs found in %s\n", dir.GetChars());
+		return;
+	}
+
+	double pixels = 0;
+	for (auto image : images) pixels += (double)image->GetWidth() * image->GetHeight();
+	pixels *= passes;
+
+	bool savedsimd = png_simd;
+	double times[2];
+	unsigned mismatches = 0;
+	TArray<FBitmap> reference(images.Size(), true);
+
+	for (int simd = 0; simd < 2; simd++)
+	{
+		png_simd = !!simd;
+		cycle_t clock;
+		clock.Reset();
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (unsigned i = 0; i < images.Size(); i++)
+			{
+				FBitmap bmp;
+				int trans;
+				bmp.Create(images[i]->GetWidth(), images[i]->GetHeight());
+				clock.Clock();
+				images[i]->DecodePixels(readers[i], &bmp, trans, true);
+				clock.Unclock();
+				if (pass > 0) continue;
+				if (simd == 0) reference[i] = std::move(bmp);
+				else if (memcmp(reference[i].GetPixels(), bmp.GetPixels(), bmp.GetPitch() * bmp.GetHeight())) mismatches++;
+			}
+		}
+		times[simd] = clock.TimeMS();
+	}
+	png_simd = savedsimd;
+
+	for (auto image : images) delete image;
+
+	Printf("%u images, %d passes\n", images.Size(), passes);
+	Printf("scalar: %.2f ms, %.1f Mpixels/s\n", times[0], pixels / 1000. / MAX(times[0], 0.001));
+	Printf("SSE2:   %.2f ms, %.1f Mpixels/s\n", times[1], pixels / 1000. / MAX(times[1], 0.001));
+	if (mismatches > 0) Printf(TEXTCOLOR_RED "%u images decoded differently\n", mismatches);
+}
@@ -44,8 +44,18 @@
 #include "xbr/xbrz_old.h"
 #include "parallel_for.h"
 #include "hwrenderer/textures/hw_material.h"
+#include "c_dispatch.h"
+#include "m_misc.h"
+#include "cmdlib.h"
+#include "files.h"
+#include "w_wad.h"
+#include "image.h"
+#include "i_system.h"
+#include <zlib.h>
+#include <mutex>
 
 EXTERN_CVAR(Int, gl_texture_hqresizemult)
+EXTERN_CVAR(Bool, gl_texture_usehires)
 CUSTOM_CVAR(Int, gl_texture_hqresizemode, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOINITCALL)
 {
 	if (self < 0 || self > 6)
@@ -93,6 +103,144 @@ CUSTOM_CVAR(Int, gl_texture_hqresize_mt_height, 4, CVAR_ARCHIVE | CVAR_GLOBALCON
 	if (self > 1024) self = 1024;
 }
 
+CVAR(Bool, gl_texture_hqresize_cache, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+//===========================================================================
+//
+// Persistent cache for upscaled textures
+//
+// Entries are addressed by a hash of the source pixels together with the
+// scaler and the factor, so the same graphic shared by different mods or
+// translations only gets scaled once per machine. The cheap scalers (scaleNx
+// and normalNx) are not worth a trip to the disk and are never cached.
+//
+//===========================================================================
+
+static const char HQCacheMagic[4] = { 'H', 'Q', 'C', '1' };
+
+struct FHQCacheHeader
+{
+	char Magic[4];
+	uint32_t InWidth, InHeight;
+	uint32_t Type, Mult;
+	uint32_t CompressedSize;
+};
+
+static bool ShouldCacheUpscale(int type)
+{
+	return gl_texture_hqresize_cache && type >= 2 && type <= 5;
+}
+
+static uint64_t HashPixels(const unsigned char *buffer, size_t len)
+{
+	const uint64_t m = 0xc6a4a7935bd1e995ull;
+	uint64_t h = 0x9e3779b97f4a7c15ull ^ (len * m);
+	size_t i;
+
+	for (i = 0; i + 8 <= len; i += 8)
+	{
+		uint64_t k;
+		memcpy(&k, buffer + i, 8);
+		k *= m;
+		k ^= k >> 47;
+		k *= m;
+		h ^= k;
+		h *= m;
+	}
+	for (; i < len; i++)
+	{
+		h ^= uint64_t(buffer[i]) << ((i & 7) * 8);
+	}
+	h ^= h >> 47;
+	h *= m;
+	h ^= h >> 47;
+	return h;
+}
+
+static FString GetUpscaleCacheDir()
+{
+	FString path = M_GetCachePath(false);
+	path << "/hqresize";
+	return path;
+}
+
+// Only the first write has to make sure that the directory exists.
+static void CreateUpscaleCacheDir()
+{
+	static std::once_flag created;
+	std::call_once(created, []() { M_GetCachePath(true); CreatePath(GetUpscaleCacheDir()); });
+}
+
+static FString GetUpscaleCacheName(const unsigned char *buffer, int inWidth, int inHeight, int type, int mult)
+{
+	uint64_t hash = HashPixels(buffer, size_t(inWidth) * inHeight * 4);
+	FString path = GetUpscaleCacheDir();
+	path.AppendFormat("/%08x%08x-%dx%d-%d-%d.hqc", uint32_t(hash >> 32), uint32_t(hash), inWidth, inHeight, type, mult);
+	return path;
+}
+
+static unsigned char *ReadUpscaleCache(const char *cachename, int inWidth, int inHeight, int type, int mult)
+{
+	FileReader fr;
+	FHQCacheHeader header;
+
+	if (!fr.OpenFile(cachename)) return nullptr;
+	if (fr.Read(&header, sizeof(header)) != sizeof(header)) return nullptr;
+	if (memcmp(header.Magic, HQCacheMagic, 4) || header.InWidth != (uint32_t)inWidth || header.InHeight != (uint32_t)inHeight ||
+		header.Type != (uint32_t)type || header.Mult != (uint32_t)mult)
+	{
+		return nullptr;
+	}
+
+	auto compressed = fr.Read(header.CompressedSize);
+	if (compressed.Size() != header.CompressedSize) return nullptr;
+
+	uLongf outlen = uLongf(inWidth) * mult * inHeight * mult * 4;
+	unsigned char *buffer = new unsigned char[outlen];
+	uLongf destlen = outlen;
+	if (uncompress(buffer, &destlen, compressed.Data(), header.CompressedSize) != Z_OK || destlen != outlen)
+	{
+		delete[] buffer;
+		return nullptr;
+	}
+	return buffer;
+}
+
+static void WriteUpscaleCache(const char *cachename, const unsigned char *buffer, int inWidth, int inHeight, int type, int mult)
+{
+	uLong srclen = uLong(inWidth) * mult * inHeight * mult * 4;
+	uLongf destlen = compressBound(srclen);
+	TArray<uint8_t> compressed(destlen, true);
+
+	if (compress2(compressed.Data(), &destlen, buffer, srclen, Z_BEST_SPEED) != Z_OK) return;
+
+	FHQCacheHeader header;
+	memcpy(header.Magic, HQCacheMagic, 4);
+	header.InWidth = inWidth;
+	header.InHeight = inHeight;
+	header.Type = type;
+	header.Mult = mult;
+	header.CompressedSize = (uint32_t)destlen;
+
+	CreateUpscaleCacheDir();
+
+	// Write to a temporary name first so that an interrupted write never leaves a truncated entry behind.
+	FString tempname = FStringf("%s.tmp", cachename);
+	FileWriter *fw = FileWriter::Open(tempname);
+	if (fw == nullptr) return;
+	bool ok = fw->Write(&header, sizeof(header)) == sizeof(header) && fw->Write(compressed.Data(), destlen) == destlen;
+	delete fw;
+	if (ok)
+	{
+		remove(cachename);
+		ok = rename(tempname, cachename) == 0;
+	}
+	if (!ok)
+	{
+		remove(tempname);
+	}
+}
+
 
 static void scale2x ( uint32_t* inputBuffer, uint32_t* outputBuffer, int inWidth, int inHeight )
 {
@@ -402,7 +550,23 @@ void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasA
 
 	if (!checkonly)
 	{
-		if (type == 1)
+		FString cachename;
+		unsigned char *cached = nullptr;
+
+		if (ShouldCacheUpscale(type))
+		{
+			cachename = GetUpscaleCacheName(texbuffer.mBuffer, inWidth, inHeight, type, mult);
+			cached = ReadUpscaleCache(cachename, inWidth, inHeight, type, mult);
+		}
+
+		if (cached != nullptr)
+		{
+			delete[] texbuffer.mBuffer;
+			texbuffer.mBuffer = cached;
+			texbuffer.mWidth = inWidth * mult;
+			texbuffer.mHeight = inHeight * mult;
+		}
+		else if (type == 1)
 		{
 			if (mult == 2)
 				texbuffer.mBuffer = scaleNxHelper(&scale2x, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
@@ -442,6 +606,11 @@ void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasA
 			texbuffer.mBuffer = normalNxHelper(&normalNx, mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
 		else
 			return;
+
+		if (cached == nullptr && cachename.IsNotEmpty())
+		{
+			WriteUpscaleCache(cachename, texbuffer.mBuffer, inWidth, inHeight, type, mult);
+		}
 	}
 	else
 	{
@@ -455,3 +624,85 @@ void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasA
 	contentId.scalefactor = mult;
 	texbuffer.mContentId = contentId.id;
 }
+
+//===========================================================================
+//
+// Upscales all textures of one resource file (or all loaded PWADs) so that
+// their cache entries exist before the first visit.
+//
+//===========================================================================
+
+CCMD(hqresize_buildcache)
+{
+	if (!ShouldCacheUpscale(gl_texture_hqresizemode))
+	{
+		Printf("The upscale cache is only used for the hqNx and xBRZ modes with gl_texture_hqresize_cache enabled.\n");
+		return;
+	}
+
+	int filenum = -1;
+	if (argv.argc() > 1)
+	{
+		for (int i = 0; i < Wads.GetNumWads(); i++)
+		{
+			const char *name = Wads.GetWadName(i);
+			if (name != nullptr && stricmp(name, argv[1]) == 0)
+			{
+				filenum = i;
+				break;
+			}
+		}
+		if (filenum == -1)
+		{
+			Printf("%s is not loaded\n", argv[1]);
+			return;
+		}
+	}
+
+	int count = 0;
+	for (int i = 0; i < TexMan.NumTextures(); i++)
+	{
+		FTexture *tex = TexMan.ByIndex(i);
+		if (tex == nullptr || !tex->isValid() || tex->GetImage() == nullptr) continue;
+
+		int lump = tex->GetSourceLump();
+		if (lump < 0) continue;
+		int file = Wads.GetLumpFile(lump);
+		if (filenum >= 0 ? file != filenum : file <= Wads.GetIwadNum()) continue;
+
+		// Build the same version FMaterial::ValidateTexture and the renderer would ask for:
+		// sprites get a border unless they opted out of it, everything else may use a hires replacement,
+		// which never gets upscaled and thus has nothing to cache.
+		bool expand = tex->isSprite() && tex->allowExpand();
+		if (!expand && gl_texture_usehires && !tex->isScaled())
+		{
+			FContentIdBuilder id;
+			id.id = tex->CreateTexBuffer(0, CTF_CheckHires | CTF_CheckOnly).mContentId;
+			if (id.imageID != unsigned(tex->GetImage()->GetId() & 0xffffff)) continue;
+		}
+		tex->CreateTexBuffer(0, CTF_ProcessData | (expand ? CTF_Expand : 0));
+		count++;
+	}
+	Printf("Processed %d textures\n", count);
+}
+
+CCMD(hqresize_clearcache)
+{
+	FString dir = GetUpscaleCacheDir();
+	findstate_t findstate;
+	int count = 0;
+
+	void *handle = I_FindFirst(dir + "/*.hqc", &findstate);
+	if (handle != (void *)-1)
+	{
+		do
+		{
+			if (!(I_FindAttr(&findstate) & FA_DIREC))
+			{
+				if (remove(dir + "/" + I_FindName(&findstate)) == 0) count++;
+			}
+		} while (I_FindNext(handle, &findstate) == 0);
+		I_FindClose(handle);
+	}
+	Printf("Deleted %d cached textures\n", count);
+}
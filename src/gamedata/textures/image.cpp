@@ -34,11 +34,22 @@
 **
 */
 
+#include <algorithm>
+#include <vector>
+#include <future>
 #include "v_video.h"
 #include "bitmap.h"
 #include "image.h"
 #include "w_wad.h"
 #include "files.h"
+#include "c_cvars.h"
+#include "stats.h"
+#include "ctpl.h"
+
+CUSTOM_CVAR(Int, r_decodethreads, -1, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < -1) self = -1;
+}
 
 FMemArena FImageSource::ImageArena(32768);
 TArray<FImageSource *>FImageSource::ImageForLump;
@@ -64,6 +75,128 @@ struct PrecacheDataRgba
 TArray<PrecacheDataPaletted> precacheDataPaletted;
 TArray<PrecacheDataRgba> precacheDataRgba;
 
+//===========================================================================
+//
+// Asynchronous decoding
+//
+// While precaching, true color images that can decode themselves from
+// their lump data alone are decoded on a worker pool ahead of the
+// precaching loop. The lump data is read on the main thread because
+// the resource files are not thread safe. Only a small window of images
+// is in flight at any time to keep the memory footprint low, so the
+// images are submitted in the order they were registered, which is the
+// order the precaching loop requests them. Images the loop went past
+// without asking for them get dropped to make room for the next ones.
+//
+//===========================================================================
+
+struct AsyncDecodeResult
+{
+	FBitmap Pixels;
+	int TransInfo = 0;
+	bool Ok = false;
+};
+
+struct PendingDecode
+{
+	unsigned QueueIndex;
+	std::future<AsyncDecodeResult> Result;
+};
+
+static ctpl::thread_pool *decodePool;
+static TArray<FImageSource *> decodeQueue;
+static TMap<int, unsigned> decodeQueueIndex;	// image ID -> position in decodeQueue
+static unsigned decodeQueuePos;
+static std::vector<PendingDecode> decodesInFlight;
+static std::vector<std::future<AsyncDecodeResult>> decodesDropped;
+static bool asyncDecoding;
+static int decodeStats[4];	// queued, decoded, stalled, dropped; reset after being displayed.
+
+static int DecodeThreadCount()
+{
+	if (r_decodethreads >= 0) return r_decodethreads;
+	return std::max<int>(std::thread::hardware_concurrency() - 1, 0);
+}
+
+static void SubmitDecodes()
+{
+	const unsigned window = decodePool->size() * 2 + 2;
+
+	// Dropped decodes only need to be kept until their workers are done with them.
+	decodesDropped.erase(std::remove_if(decodesDropped.begin(), decodesDropped.end(), [](std::future<AsyncDecodeResult> &result)
+	{
+		return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}), decodesDropped.end());
+
+	while (decodesInFlight.size() < window && decodeQueuePos < decodeQueue.Size())
+	{
+		unsigned index = decodeQueuePos++;
+		FImageSource *img = decodeQueue[index];
+
+		// Skip everything that already got created synchronously.
+		auto info = precacheInfo.CheckKey(img->GetId());
+		if (info == nullptr || info->first == 0) continue;
+
+		auto data = std::make_shared<TArray<uint8_t>>(Wads.ReadLumpIntoArray(img->LumpNum()));
+		decodesInFlight.push_back({ index, decodePool->push([=](int) -> AsyncDecodeResult
+		{
+			AsyncDecodeResult res;
+			FileReader fr;
+			fr.OpenMemory(data->Data(), data->Size());
+			res.Pixels.Create(img->GetWidth(), img->GetHeight());
+			res.Ok = img->DecodePixels(fr, &res.Pixels, res.TransInfo, true);
+			return res;
+		}) });
+		decodeStats[0]++;
+	}
+}
+
+static bool GetAsyncDecodeResult(FImageSource *img, AsyncDecodeResult &result)
+{
+	auto pindex = decodeQueueIndex.CheckKey(img->GetId());
+	if (pindex == nullptr) return false;
+	unsigned index = *pindex;
+
+	// decodesInFlight is in queue order. Everything before the requested image got
+	// skipped by the precaching loop, e.g. hires replacements or images shared with
+	// a texture that was already done, so it is dropped instead of holding its slot.
+	unsigned done = 0;
+	bool found = false;
+	for (; done < decodesInFlight.size() && decodesInFlight[done].QueueIndex <= index; done++)
+	{
+		auto &pending = decodesInFlight[done];
+		if (pending.QueueIndex == index)
+		{
+			if (pending.Result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) decodeStats[2]++;
+			result = pending.Result.get();
+			found = true;
+		}
+		else
+		{
+			decodesDropped.push_back(std::move(pending.Result));
+			decodeStats[3]++;
+		}
+	}
+	decodesInFlight.erase(decodesInFlight.begin(), decodesInFlight.begin() + done);
+
+	// If the loop got ahead of the submissions, continue after the requested image.
+	if (decodeQueuePos <= index) decodeQueuePos = index + 1;
+	SubmitDecodes();
+
+	// If the worker failed, decode it again on the main thread so that errors get reported.
+	if (found && result.Ok) decodeStats[1]++;
+	return found && result.Ok;
+}
+
+ADD_STAT(imagedecode)
+{
+	FString out;
+	out.Format("Async image decoding: %d queued, %d decoded, %d stalled, %d dropped, %d in flight", 
+		decodeStats[0], decodeStats[1], decodeStats[2], decodeStats[3], (int)decodesInFlight.size());
+	decodeStats[0] = decodeStats[1] = decodeStats[2] = decodeStats[3] = 0;
+	return out;
+}
+
 //===========================================================================
 // 
 // the default just returns an empty texture.
@@ -247,12 +380,34 @@ FBitmap FImageSource::GetCachedBitmap(PalEntry *remap, int conversion, int *ptra
 		{
 			// The image wasn't cached. Now there's two possibilities:
 			auto info = precacheInfo.CheckKey(ImageID);
-			if (!info || info->first <= 1 || conversion != normal)
+			AsyncDecodeResult decoded;
+			if (info && conversion == normal && asyncDecoding && GetAsyncDecodeResult(this, decoded))
+			{
+				// A worker thread already decoded this image.
+				trans = decoded.TransInfo;
+				if (info->first <= 1)
+				{
+					ret = std::move(decoded.Pixels);
+				}
+				else
+				{
+					PrecacheDataRgba *pdr = &precacheDataRgba[precacheDataRgba.Reserve(1)];
+
+					pdr->ImageID = imageID;
+					pdr->RefCount = info->first - 1;
+					pdr->Pixels = std::move(decoded.Pixels);
+					pdr->TransInfo = trans;
+					ret.Copy(pdr->Pixels, false);
+				}
+				info->first = 0;
+			}
+			else if (!info || info->first <= 1 || conversion != normal)
 			{
 				// This is either the only copy needed or some access outside the caching block. In these cases create a new one and directly return it.
 				//Printf("returning fresh copy of %s\n", name.GetChars());
 				ret.Create(Width, Height);
 				trans = CopyPixels(&ret, conversion);
+				if (info && conversion == normal) info->first = 0;
 			}
 			else
 			{
@@ -283,6 +438,10 @@ void FImageSource::CollectForPrecache(PrecacheInfo &info, bool requiretruecolor)
 {
 	auto val = info.CheckKey(ImageID);
 	bool tc = requiretruecolor || V_IsTrueColor();
+	if (tc && CanDecodeAsync() && &info == &precacheInfo && (val == nullptr || val->first == 0))
+	{
+		decodeQueueIndex.Insert(ImageID, decodeQueue.Push(this));
+	}
 	if (val)
 	{
 		val->first += tc;
@@ -298,10 +457,34 @@ void FImageSource::CollectForPrecache(PrecacheInfo &info, bool requiretruecolor)
 void FImageSource::BeginPrecaching()
 {
 	precacheInfo.Clear();
+	decodeQueue.Clear();
+	decodeQueueIndex.Clear();
+	decodeQueuePos = 0;
+}
+
+// Must be called after all images have been registered.
+void FImageSource::StartAsyncDecoding()
+{
+	int threads = DecodeThreadCount();
+	if (threads == 0 || decodeQueue.Size() == 0) return;
+
+	if (decodePool == nullptr) decodePool = new ctpl::thread_pool(threads);
+	else if (decodePool->size() != threads) decodePool->resize(threads);
+	asyncDecoding = true;
+	SubmitDecodes();
 }
 
 void FImageSource::EndPrecaching()
 {
+	// Anything still in flight was never requested, but the workers still reference the images.
+	for (auto &pending : decodesInFlight) pending.Result.wait();
+	for (auto &result : decodesDropped) result.wait();
+	decodesInFlight.clear();
+	decodesDropped.clear();
+	decodeQueue.Reset();
+	decodeQueueIndex.Clear();
+	asyncDecoding = false;
+
 	precacheDataPaletted.Clear();
 	precacheDataRgba.Clear();
 }
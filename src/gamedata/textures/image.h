@@ -6,6 +6,7 @@
 #include "memarena.h"
 
 class FImageSource;
+class FileReader;
 using PrecacheInfo = TMap<int, std::pair<int, int>>;
 
 struct PalettedPixels
@@ -65,6 +66,11 @@ public:
 	int8_t bTranslucent = -1;					// Image has pixels with a non-0/1 value. (-1 means the user needs to do a real check)
 
 	int GetId() const { return ImageID; }
+
+	// Decodes a true color image from the lump data alone. Image types implementing this may not touch
+	// any global state while decoding, so that precaching can run it on a worker thread.
+	virtual bool CanDecodeAsync() const { return false; }
+	virtual bool DecodePixels(FileReader &lump, FBitmap *bmp, int &trans, bool quiet) { return false; }
 	
 	// 'noremap0' will only be looked at by FPatchTexture and forwarded by FMultipatchTexture.
 
@@ -132,6 +138,7 @@ public:
 
 	virtual void CollectForPrecache(PrecacheInfo &info, bool requiretruecolor = false);
 	static void BeginPrecaching();
+	static void StartAsyncDecoding();
 	static void EndPrecaching();
 	static void RegisterForPrecache(FImageSource *img);
 };
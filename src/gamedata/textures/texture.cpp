@@ -34,6 +34,7 @@
 **
 */
 
+#include <mutex>
 #include "doomtype.h"
 #include "files.h"
 #include "w_wad.h"
@@ -760,14 +761,21 @@ bool FTexture::GetTranslucency()
 {
 	if (bTranslucent == -1)
 	{
-		if (!bHasCanvas)
-		{
-			// This will calculate all we need, so just discard the result.
-			CreateTexBuffer(0);
-		}
-		else
+		// The hardware renderer's BSP workers may all ask for this at the same time.
+		static std::mutex TranslucencyMutex;
+		std::lock_guard<std::mutex> lock(TranslucencyMutex);
+
+		if (bTranslucent == -1)	// unless another thread got here first
 		{
-			bTranslucent = 0;
+			if (!bHasCanvas)
+			{
+				// This will calculate all we need, so just discard the result.
+				CreateTexBuffer(0);
+			}
+			else
+			{
+				bTranslucent = 0;
+			}
 		}
 	}
 	return !!bTranslucent;
@@ -334,6 +334,7 @@ public:
 	
 	const FString &GetName() const { return Name; }
 	bool allowNoDecals() const { return bNoDecals; }
+	bool allowExpand() const { return !bNoExpand; }
 	bool isScaled() const { return Scale.X != 1 || Scale.Y != 1; }
 	bool isMasked() const { return bMasked; }
 	int GetSkyOffset() const { return SkyOffset; }
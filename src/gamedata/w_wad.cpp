@@ -39,6 +39,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <algorithm>
 
 #include "doomtype.h"
 #include "m_argv.h"
@@ -52,6 +53,7 @@
 #include "md5.h"
 #include "doomstat.h"
 #include "vm.h"
+#include "stats.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -113,6 +115,10 @@ void FWadCollection::DeleteAll ()
 {
 	LumpInfo.Clear();
 	NumLumps = 0;
+	NameIndex.Clear();
+	FullNameIndex.Clear();
+	NoExtIndex.Clear();
+	SortedFullNames.Clear();
 
 	// we must count backward to ensure that embedded WADs are deleted before
 	// the ones that contain their data.
@@ -158,13 +164,6 @@ void FWadCollection::InitMultipleFiles (TArray<FString> &filenames, const TArray
 	FixMacHexen();
 
 	// [RH] Set up hash table
-	Hashes.Resize(6 * NumLumps);
-	FirstLumpIndex = &Hashes[0];
-	NextLumpIndex = &Hashes[NumLumps];
-	FirstLumpIndex_FullName = &Hashes[NumLumps*2];
-	NextLumpIndex_FullName = &Hashes[NumLumps*3];
-	FirstLumpIndex_NoExt = &Hashes[NumLumps*4];
-	NextLumpIndex_NoExt = &Hashes[NumLumps*5];
 	InitHashChains ();
 	LumpInfo.ShrinkToFit();
 	Files.ShrinkToFit();
@@ -396,7 +395,7 @@ int FWadCollection::CheckNumForName (const char *name, int space)
 		char uname[8];
 		uint64_t qname;
 	};
-	uint32_t i;
+	unsigned count;
 
 	if (name == NULL)
 	{
@@ -411,38 +410,30 @@ int FWadCollection::CheckNumForName (const char *name, int space)
 	}
 
 	uppercopy (uname, name);
-	i = FirstLumpIndex[LumpNameHash (uname) % NumLumps];
+	auto entry = NameIndex.Find(qname, count);
 
-	while (i != NULL_INDEX)
+	for (; count > 0; count--, entry++)
 	{
-		FResourceLump *lump = LumpInfo[i].lump;
-
-		if (lump->qwName == qname)
-		{
-			if (lump->Namespace == space) break;
-			// If the lump is from one of the special namespaces exclusive to Zips
-			// the check has to be done differently:
-			// If we find a lump with this name in the global namespace that does not come
-			// from a Zip return that. WADs don't know these namespaces and single lumps must
-			// work as well.
-			if (space > ns_specialzipdirectory && lump->Namespace == ns_global && 
-				!(lump->Flags & LUMPF_ZIPFILE)) break;
-		}
-		i = NextLumpIndex[i];
+		if (entry->Namespace == space) return entry->Lump;
+		// If the lump is from one of the special namespaces exclusive to Zips
+		// the check has to be done differently:
+		// If we find a lump with this name in the global namespace that does not come
+		// from a Zip return that. WADs don't know these namespaces and single lumps must
+		// work as well.
+		if (space > ns_specialzipdirectory && entry->Namespace == ns_global &&
+			!(entry->Flags & LUMPF_ZIPFILE)) return entry->Lump;
 	}
-
-	return i != NULL_INDEX ? i : -1;
+	return -1;
 }
 
 int FWadCollection::CheckNumForName (const char *name, int space, int wadnum, bool exact)
 {
-	FResourceLump *lump;
 	union
 	{
 		char uname[8];
 		uint64_t qname;
 	};
-	uint32_t i;
+	unsigned count;
 
 	if (wadnum < 0)
 	{
@@ -450,20 +441,20 @@ int FWadCollection::CheckNumForName (const char *name, int space, int wadnum, bo
 	}
 
 	uppercopy (uname, name);
-	i = FirstLumpIndex[LumpNameHash (uname) % NumLumps];
+	auto entry = NameIndex.Find(qname, count);
 
 	// If exact is true if will only find lumps in the same WAD, otherwise
 	// also those in earlier WADs.
 
-	while (i != NULL_INDEX &&
-		(lump = LumpInfo[i].lump, lump->qwName != qname ||
-		lump->Namespace != space ||
-		 (exact? (LumpInfo[i].wadnum != wadnum) : (LumpInfo[i].wadnum > wadnum)) ))
+	for (; count > 0; count--, entry++)
 	{
-		i = NextLumpIndex[i];
+		if (entry->Namespace == space && 
+			(exact ? (entry->WadNum == wadnum) : (entry->WadNum <= wadnum)))
+		{
+			return entry->Lump;
+		}
 	}
-
-	return i != NULL_INDEX ? i : -1;
+	return -1;
 }
 
 DEFINE_ACTION_FUNCTION(_Wads, CheckNumForName)
@@ -508,29 +499,27 @@ int FWadCollection::GetNumForName (const char *name, int space)
 
 int FWadCollection::CheckNumForFullName (const char *name, bool trynormal, int namespc, bool ignoreext)
 {
-	uint32_t i;
+	unsigned count;
 
 	if (name == NULL)
 	{
 		return -1;
 	}
-	uint32_t *fli = ignoreext ? FirstLumpIndex_NoExt : FirstLumpIndex_FullName;
-	uint32_t *nli = ignoreext ? NextLumpIndex_NoExt : NextLumpIndex_FullName;
+	auto &index = ignoreext ? NoExtIndex : FullNameIndex;
 	auto len = strlen(name);
 
-	for (i = fli[MakeKey(name) % NumLumps]; i != NULL_INDEX; i = nli[i])
+	for (auto entry = index.Find(FullNameKey(name, len), count); count > 0; count--, entry++)
 	{
-		if (strnicmp(name, LumpInfo[i].lump->FullName, len)) continue;
-		if (LumpInfo[i].lump->FullName[len] == 0) break;	// this is a full match
-		if (ignoreext && LumpInfo[i].lump->FullName[len] == '.') 
+		const char *fullname = LumpInfo[entry->Lump].lump->FullName.GetChars();
+		if (strnicmp(name, fullname, len)) continue;
+		if (fullname[len] == 0) return entry->Lump;	// this is a full match
+		if (ignoreext && fullname[len] == '.') 
 		{
 			// is this the last '.' in the last path element, indicating that the remaining part of the name is only an extension?
-			if (strpbrk(LumpInfo[i].lump->FullName.GetChars() + len + 1, "./") == nullptr) break;	
+			if (strpbrk(fullname + len + 1, "./") == nullptr) return entry->Lump;
 		}
 	}
 
-	if (i != NULL_INDEX) return i;
-
 	if (trynormal && strlen(name) <= 8 && !strpbrk(name, "./"))
 	{
 		return CheckNumForName(name, namespc);
@@ -547,22 +536,21 @@ DEFINE_ACTION_FUNCTION(_Wads, CheckNumForFullName)
 
 int FWadCollection::CheckNumForFullName (const char *name, int wadnum)
 {
-	uint32_t i;
+	unsigned count;
 
 	if (wadnum < 0)
 	{
 		return CheckNumForFullName (name);
 	}
 
-	i = FirstLumpIndex_FullName[MakeKey (name) % NumLumps];
-
-	while (i != NULL_INDEX && 
-		(stricmp(name, LumpInfo[i].lump->FullName) || LumpInfo[i].wadnum != wadnum))
+	for (auto entry = FullNameIndex.Find(FullNameKey(name, strlen(name)), count); count > 0; count--, entry++)
 	{
-		i = NextLumpIndex_FullName[i];
+		if (entry->WadNum == wadnum && !stricmp(name, LumpInfo[entry->Lump].lump->FullName))
+		{
+			return entry->Lump;
+		}
 	}
-
-	return i != NULL_INDEX ? i : -1;
+	return -1;
 }
 
 //==========================================================================
@@ -694,6 +682,83 @@ uint32_t FWadCollection::LumpNameHash (const char *s)
 	return hash ^ 0xffffffff;
 }
 
+//==========================================================================
+//
+// FullNameKey
+//
+// Case insensitive 64-bit FNV-1a hash over the first len characters
+// of a full path.
+//
+//==========================================================================
+
+uint64_t FWadCollection::FullNameKey (const char *s, size_t len)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	for (size_t i = 0; i < len && s[i]; i++)
+	{
+		hash ^= (uint8_t)tolower((uint8_t)s[i]);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+//==========================================================================
+//
+// FLumpIndexTable :: Build
+//
+// keys and entries are parallel arrays, sorted by ascending lump number.
+// The table is sized to be at most half full, so probe sequences stay
+// short and always end at an empty slot.
+//
+//==========================================================================
+
+void FLumpIndexTable::Clear()
+{
+	Slots.Reset();
+	Entries.Reset();
+	Mask = 0;
+}
+
+void FLumpIndexTable::Build(const TArray<uint64_t> &keys, const TArray<Entry> &entries)
+{
+	unsigned size = 16;
+	while (size < keys.Size() * 2) size <<= 1;
+
+	Slots.Resize(size);
+	memset(Slots.Data(), 0, size * sizeof(Slot));
+	Mask = size - 1;
+
+	// Count the lumps for each key.
+	TArray<uint32_t> slotnum(keys.Size(), true);
+	for (unsigned i = 0; i < keys.Size(); i++)
+	{
+		uint32_t s = Hash(keys[i]) & Mask;
+		while (Slots[s].Count != 0 && Slots[s].Key != keys[i])
+		{
+			s = (s + 1) & Mask;
+		}
+		Slots[s].Key = keys[i];
+		Slots[s].Count++;
+		slotnum[i] = s;
+	}
+
+	// Give each key a contiguous range and point First at its end.
+	uint32_t next = 0;
+	for (auto &slot : Slots)
+	{
+		next += slot.Count;
+		slot.First = next;
+	}
+
+	// Fill the ranges back to front so that the most recent lump comes first.
+	Entries.Resize(entries.Size());
+	for (unsigned i = 0; i < entries.Size(); i++)
+	{
+		Entries[--Slots[slotnum[i]].First] = entries[i];
+	}
+}
+
 //==========================================================================
 //
 // W_InitHashChains
@@ -705,43 +770,49 @@ uint32_t FWadCollection::LumpNameHash (const char *s)
 
 void FWadCollection::InitHashChains (void)
 {
-	char name[8];
-	unsigned int i, j;
-
-	// Mark all buckets as empty
-	memset (FirstLumpIndex, 255, NumLumps*sizeof(FirstLumpIndex[0]));
-	memset (NextLumpIndex, 255, NumLumps*sizeof(NextLumpIndex[0]));
-	memset (FirstLumpIndex_FullName, 255, NumLumps*sizeof(FirstLumpIndex_FullName[0]));
-	memset (NextLumpIndex_FullName, 255, NumLumps*sizeof(NextLumpIndex_FullName[0]));
-	memset(FirstLumpIndex_NoExt, 255, NumLumps * sizeof(FirstLumpIndex_NoExt[0]));
-	memset(NextLumpIndex_NoExt, 255, NumLumps * sizeof(NextLumpIndex_NoExt[0]));
+	TArray<uint64_t> namekeys(NumLumps), fullkeys(NumLumps), noextkeys(NumLumps);
+	TArray<FLumpIndexTable::Entry> names(NumLumps), fullnames(NumLumps), noextnames(NumLumps);
 
-	// Now set up the chains
-	for (i = 0; i < (unsigned)NumLumps; i++)
+	SortedFullNames.Clear();
+	for (uint32_t i = 0; i < NumLumps; i++)
 	{
-		uppercopy (name, LumpInfo[i].lump->Name);
-		j = LumpNameHash (name) % NumLumps;
-		NextLumpIndex[i] = FirstLumpIndex[j];
-		FirstLumpIndex[j] = i;
+		FResourceLump *lump = LumpInfo[i].lump;
+		FLumpIndexTable::Entry entry = { i, lump->Namespace, LumpInfo[i].wadnum, lump->Flags };
+
+		namekeys.Push(lump->qwName);
+		names.Push(entry);
 
 		// Do the same for the full paths
-		if (LumpInfo[i].lump->FullName.IsNotEmpty())
+		if (lump->FullName.IsNotEmpty())
 		{
-			j = MakeKey(LumpInfo[i].lump->FullName) % NumLumps;
-			NextLumpIndex_FullName[i] = FirstLumpIndex_FullName[j];
-			FirstLumpIndex_FullName[j] = i;
+			const char *fullname = lump->FullName.GetChars();
+			size_t len = lump->FullName.Len();
+
+			fullkeys.Push(FullNameKey(fullname, len));
+			fullnames.Push(entry);
 
-			FString nameNoExt = LumpInfo[i].lump->FullName;
-			auto dot = nameNoExt.LastIndexOf('.');
-			auto slash = nameNoExt.LastIndexOf('/');
-			if (dot > slash) nameNoExt.Truncate(dot);
+			auto dot = lump->FullName.LastIndexOf('.');
+			auto slash = lump->FullName.LastIndexOf('/');
+			if (dot > slash) len = dot;
 
-			j = MakeKey(nameNoExt) % NumLumps;
-			NextLumpIndex_NoExt[i] = FirstLumpIndex_NoExt[j];
-			FirstLumpIndex_NoExt[j] = i;
+			noextkeys.Push(FullNameKey(fullname, len));
+			noextnames.Push(entry);
 
+			SortedFullNames.Push(i);
 		}
 	}
+
+	NameIndex.Build(namekeys, names);
+	FullNameIndex.Build(fullkeys, fullnames);
+	NoExtIndex.Build(noextkeys, noextnames);
+
+	// The directory index is sorted by path so that all lumps inside a folder form one range.
+	std::sort(SortedFullNames.Data(), SortedFullNames.Data() + SortedFullNames.Size(), [=](uint32_t a, uint32_t b)
+	{
+		int res = strcmp(LumpInfo[a].lump->FullName.GetChars(), LumpInfo[b].lump->FullName.GetChars());
+		return res < 0 || (res == 0 && a < b);
+	});
+	SortedFullNames.ShrinkToFit();
 }
 
 //==========================================================================
@@ -1285,13 +1356,6 @@ FResourceLump *FWadCollection::GetLumpRecord(int lump) const
 //
 //==========================================================================
 
-static int folderentrycmp(const void *a, const void *b)
-{
-	auto A = (FolderEntry*)a;
-	auto B = (FolderEntry*)b;
-	return strcmp(A->name, B->name);
-}
-
 unsigned FWadCollection::GetLumpsInFolder(const char *inpath, TArray<FolderEntry> &result, bool atomic) const
 {
 	FString path = inpath;
@@ -1299,15 +1363,20 @@ unsigned FWadCollection::GetLumpsInFolder(const char *inpath, TArray<FolderEntry
 	path.ToLower();
 	if (path[path.Len() - 1] != '/') path += '/';
 	result.Clear();
-	for (unsigned i = 0; i < LumpInfo.Size(); i++)
+
+	// The directory index is sorted by name so everything in this folder is one contiguous range
+	// and the result comes out already sorted.
+	auto first = std::lower_bound(SortedFullNames.Data(), SortedFullNames.Data() + SortedFullNames.Size(), path, 
+		[=](uint32_t lump, const FString &p) { return strcmp(LumpInfo[lump].lump->FullName.GetChars(), p.GetChars()) < 0; });
+	auto last = SortedFullNames.Data() + SortedFullNames.Size();
+
+	for (; first < last && !strncmp(LumpInfo[*first].lump->FullName.GetChars(), path.GetChars(), path.Len()); first++)
 	{
-		if (LumpInfo[i].lump->FullName.IndexOf(path) == 0)
+		unsigned i = *first;
+		// Only if it hasn't been replaced.
+		if ((unsigned)Wads.CheckNumForFullName(LumpInfo[i].lump->FullName) == i)
 		{
-			// Only if it hasn't been replaced.
-			if ((unsigned)Wads.CheckNumForFullName(LumpInfo[i].lump->FullName) == i)
-			{
-				result.Push({ LumpInfo[i].lump->FullName.GetChars(), i });
-			}
+			result.Push({ LumpInfo[i].lump->FullName.GetChars(), i });
 		}
 	}
 	if (result.Size())
@@ -1327,7 +1396,6 @@ unsigned FWadCollection::GetLumpsInFolder(const char *inpath, TArray<FolderEntry
 				if (Wads.GetLumpFile(result[i].lumpnum) != maxfile) result.Delete(i);
 			}
 		}
-		qsort(result.Data(), result.Size(), sizeof(FolderEntry), folderentrycmp);
 	}
 	return result.Size();
 }
@@ -1572,6 +1640,126 @@ bool FWadCollection::IsEncryptedFile(int lump) const
 	return !!(LumpInfo[lump].lump->Flags & LUMPF_BLOODCRYPT);
 }
 
+//==========================================================================
+//
+// BenchmarkNameLookups
+//
+// Looks up every lump by its short and full name, once through the lump
+// index and once through Boom style hash chains like the ones the index
+// replaced, and reports the throughput of both. The results of both
+// methods are compared as well.
+//
+//==========================================================================
+
+void FWadCollection::BenchmarkNameLookups(int passes)
+{
+	if (NumLumps == 0) return;
+
+	// Build the reference chains.
+	TArray<uint32_t> first(NumLumps, true), next(NumLumps, true);
+	TArray<uint32_t> firstfull(NumLumps, true), nextfull(NumLumps, true);
+	memset(first.Data(), 255, NumLumps * sizeof(uint32_t));
+	memset(firstfull.Data(), 255, NumLumps * sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < NumLumps; i++)
+	{
+		char name[8];
+		uppercopy(name, LumpInfo[i].lump->Name);
+		uint32_t j = LumpNameHash(name) % NumLumps;
+		next[i] = first[j];
+		first[j] = i;
+
+		if (LumpInfo[i].lump->FullName.IsNotEmpty())
+		{
+			j = MakeKey(LumpInfo[i].lump->FullName) % NumLumps;
+			nextfull[i] = firstfull[j];
+			firstfull[j] = i;
+		}
+	}
+
+	auto chainlookup = [&](const char *name, int space) -> int
+	{
+		union
+		{
+			char uname[8];
+			uint64_t qname;
+		};
+		uppercopy(uname, name);
+		for (uint32_t i = first[LumpNameHash(uname) % NumLumps]; i != NULL_INDEX; i = next[i])
+		{
+			FResourceLump *lump = LumpInfo[i].lump;
+			if (lump->qwName == qname && lump->Namespace == space) return i;
+		}
+		return -1;
+	};
+
+	auto chainfulllookup = [&](const char *name) -> int
+	{
+		for (uint32_t i = firstfull[MakeKey(name) % NumLumps]; i != NULL_INDEX; i = nextfull[i])
+		{
+			if (!stricmp(name, LumpInfo[i].lump->FullName)) return i;
+		}
+		return -1;
+	};
+
+	cycle_t indexshort, chainshort, indexfull, chainfull;
+	indexshort.Reset();
+	chainshort.Reset();
+	indexfull.Reset();
+	chainfull.Reset();
+	unsigned numshort = 0, numfull = 0, mismatches = 0;
+
+	for (int pass = 0; pass < passes; pass++)
+	{
+		for (uint32_t i = 0; i < NumLumps; i++)
+		{
+			FResourceLump *lump = LumpInfo[i].lump;
+			if (lump->Name[0] == 0 || lump->Namespace == ns_hidden || lump->Namespace > ns_specialzipdirectory) continue;
+			char name[9];
+			memcpy(name, lump->Name, 8);
+			name[8] = 0;
+
+			indexshort.Clock();
+			int res1 = CheckNumForName(name, lump->Namespace);
+			indexshort.Unclock();
+			chainshort.Clock();
+			int res2 = chainlookup(name, lump->Namespace);
+			chainshort.Unclock();
+			if (res1 != res2) mismatches++;
+			numshort++;
+		}
+
+		for (uint32_t i = 0; i < NumLumps; i++)
+		{
+			const char *fullname = LumpInfo[i].lump->FullName.GetChars();
+			if (*fullname == 0) continue;
+
+			indexfull.Clock();
+			int res1 = CheckNumForFullName(fullname);
+			indexfull.Unclock();
+			chainfull.Clock();
+			int res2 = chainfulllookup(fullname);
+			chainfull.Unclock();
+			if (res1 != res2) mismatches++;
+			numfull++;
+		}
+	}
+
+	auto rate = [](unsigned count, cycle_t &clock) { return clock.Time() > 0 ? count / clock.Time() : 0.; };
+	Printf("%u lumps, %d passes\n", NumLumps, passes);
+	Printf("Short names: %u lookups, index %.3f ms (%.0f/s), chains %.3f ms (%.0f/s)\n", numshort,
+		indexshort.TimeMS(), rate(numshort, indexshort), chainshort.TimeMS(), rate(numshort, chainshort));
+	Printf("Full names:  %u lookups, index %.3f ms (%.0f/s), chains %.3f ms (%.0f/s)\n", numfull,
+		indexfull.TimeMS(), rate(numfull, indexfull), chainfull.TimeMS(), rate(numfull, chainfull));
+	if (mismatches > 0) Printf(TEXTCOLOR_RED "%u lookups returned different results!\n", mismatches);
+}
+
+CCMD(benchlumpindex)
+{
+	int passes = argv.argc() > 1 ? atoi(argv[1]) : 10;
+	Wads.BenchmarkNameLookups(std::max(passes, 1));
+}
+
 
 // FMemLump -----------------------------------------------------------------
 
@@ -107,6 +107,69 @@ struct FolderEntry
 	unsigned lumpnum;
 };
 
+//==========================================================================
+//
+// Open addressed lookup table for lump names.
+// Maps a precomputed 64-bit key to all lumps sharing that key. The lumps
+// for one key are stored contiguously with the most recent one first,
+// so the first match is always the one that overrides all others.
+//
+//==========================================================================
+
+class FLumpIndexTable
+{
+public:
+	struct Entry
+	{
+		uint32_t Lump;
+		int32_t Namespace;
+		int32_t WadNum;
+		uint32_t Flags;
+	};
+
+	void Clear();
+	void Build(const TArray<uint64_t> &keys, const TArray<Entry> &entries);
+
+	const Entry *Find(uint64_t key, unsigned &count) const
+	{
+		if (Slots.Size() > 0)
+		{
+			for (uint32_t i = Hash(key) & Mask; ; i = (i + 1) & Mask)
+			{
+				const Slot &slot = Slots[i];
+				if (slot.Count == 0) break;
+				if (slot.Key == key)
+				{
+					count = slot.Count;
+					return &Entries[slot.First];
+				}
+			}
+		}
+		count = 0;
+		return nullptr;
+	}
+
+private:
+	struct Slot
+	{
+		uint64_t Key;
+		uint32_t First;
+		uint32_t Count;		// 0 marks an empty slot.
+	};
+
+	static uint32_t Hash(uint64_t key)
+	{
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdull;
+		key ^= key >> 33;
+		return uint32_t(key);
+	}
+
+	TArray<Slot> Slots;
+	TArray<Entry> Entries;
+	uint32_t Mask = 0;
+};
+
 class FWadCollection
 {
 public:
@@ -166,6 +229,7 @@ public:
 	bool CheckLumpName (int lump, const char *name);	// [RH] True if lump's name == name
 
 	static uint32_t LumpNameHash (const char *name);		// [RH] Create hash key from an 8-char name
+	static uint64_t FullNameKey (const char *name, size_t len);	// Case insensitive 64-bit key for a full path
 
 	int LumpLength (int lump) const;
 	int GetLumpOffset (int lump);					// [RH] Returns offset of lump in the wadfile
@@ -188,6 +252,8 @@ public:
 
 	int AddExternalFile(const char *filename);
 
+	void BenchmarkNameLookups(int passes);
+
 protected:
 
 	struct LumpRecord;
@@ -195,15 +261,10 @@ protected:
 	TArray<FResourceFile *> Files;
 	TArray<LumpRecord> LumpInfo;
 
-	TArray<uint32_t> Hashes;	// one allocation for all hash lists.
-	uint32_t *FirstLumpIndex;	// [RH] Hashing stuff moved out of lumpinfo structure
-	uint32_t *NextLumpIndex;
-
-	uint32_t *FirstLumpIndex_FullName;	// The same information for fully qualified paths from .zips
-	uint32_t *NextLumpIndex_FullName;
-
-	uint32_t *FirstLumpIndex_NoExt;	// The same information for fully qualified paths from .zips
-	uint32_t *NextLumpIndex_NoExt;
+	FLumpIndexTable NameIndex;			// [RH] Hashing stuff moved out of lumpinfo structure
+	FLumpIndexTable FullNameIndex;		// The same information for fully qualified paths from .zips
+	FLumpIndexTable NoExtIndex;			// The same for fully qualified paths without extension
+	TArray<uint32_t> SortedFullNames;	// All lumps with a full path, sorted by name for directory queries
 
 	uint32_t NumLumps = 0;					// Not necessarily the same as LumpInfo.Size()
 	uint32_t NumWads;
@@ -20,6 +20,9 @@ public:
 void I_InitGraphics();
 void I_ShutdownGraphics();
 
+// True when started with -headless. The video backends then render to memory instead of a window.
+bool I_IsHeadless();
+
 extern IVideo *Video;
 
 
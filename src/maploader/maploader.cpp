@@ -3179,6 +3179,8 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 	
 	// set the head node for gameplay purposes. If the separate gamenodes array is not empty, use that, otherwise use the render nodes.
 	Level->headgamenode = Level->gamenodes.Size() > 0 ? &Level->gamenodes[Level->gamenodes.Size() - 1] : Level->nodes.Size() ? &Level->nodes[Level->nodes.Size() - 1] : nullptr;
+	Level->renderSubsectorGrid.Build(Level, Level->HeadNode());
+	if (Level->headgamenode != Level->HeadNode()) Level->gameSubsectorGrid.Build(Level, Level->headgamenode);
 
 	LoadBlockMap(map);
 
@@ -3241,7 +3243,7 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 
 	InitRenderInfo();				// create hardware independent renderer resources for the level. This must be done BEFORE the PolyObj Spawn!!!
 	Level->ClearDynamic3DFloorData();	// CreateVBO must be run on the plain 3D floor data.
-	screen->mVertexData->CreateVBO(Level->sectors);
+	if (screen->mVertexData != nullptr) screen->mVertexData->CreateVBO(Level->sectors);
 
 	for (auto &sec : Level->sectors)
 	{
@@ -49,6 +49,11 @@
 #include "vm.h"
 #include "actorinlines.h"
 #include "g_game.h"
+#include "stats.h"
+
+#ifndef NO_SSE
+#include <emmintrin.h>
+#endif
 
 CVAR (Int, cl_rockettrails, 1, CVAR_ARCHIVE);
 CVAR (Bool, r_rail_smartspiral, 0, CVAR_ARCHIVE);
@@ -99,17 +104,109 @@ static const struct ColorList {
 	{NULL, 0, 0, 0 }
 };
 
-inline particle_t *NewParticle (FLevelLocals *Level)
+//==========================================================================
+//
+// FParticleData
+//
+//==========================================================================
+
+void FParticleData::Resize(unsigned capacity)
 {
-	particle_t *result = nullptr;
-	if (Level->InactiveParticles != NO_PARTICLE)
+	Pos.Resize(capacity);
+	Vel.Resize(capacity);
+	Acc.Resize(capacity);
+	Size.Resize(capacity);
+	SizeStep.Resize(capacity);
+	Alpha.Resize(capacity);
+	FadeStep.Resize(capacity);
+	TTL.Resize(capacity);
+	Color.Resize(capacity);
+	Bright.Resize(capacity);
+	NoTimeFreeze.Resize(capacity);
+	Subsector.Resize(capacity);
+	State.Resize(capacity);
+	Capacity = capacity;
+	Clear();
+}
+
+void FParticleData::Clear()
+{
+	Count = 0;
+	HasPending = false;
+	Linked = false;
+}
+
+void FParticleData::Flush()
+{
+	if (HasPending)
 	{
-		result = &Level->Particles[Level->InactiveParticles];
-		Level->InactiveParticles = result->tnext;
-		result->tnext = Level->ActiveParticles;
-		Level->ActiveParticles = uint32_t(result - Level->Particles.Data());
+		HasPending = false;
+		Store(Count++, Pending);
+		Linked = false;
 	}
-	return result;
+}
+
+particle_t *FParticleData::New()
+{
+	Flush();
+	if (Count >= Capacity) return nullptr;
+	memset(&Pending, 0, sizeof(Pending));
+	HasPending = true;
+	return &Pending;
+}
+
+void FParticleData::Load(unsigned index, particle_t &p) const
+{
+	p.Pos = Pos[index];
+	p.Vel = Vel[index];
+	p.Acc = Acc[index];
+	p.size = Size[index];
+	p.sizestep = SizeStep[index];
+	p.subsector = Subsector[index];
+	p.ttl = TTL[index];
+	p.bright = Bright[index];
+	p.notimefreeze = !!NoTimeFreeze[index];
+	p.fadestep = FadeStep[index];
+	p.alpha = Alpha[index];
+	p.color = Color[index];
+}
+
+void FParticleData::Store(unsigned index, const particle_t &p)
+{
+	Pos[index] = p.Pos;
+	Vel[index] = p.Vel;
+	Acc[index] = p.Acc;
+	Size[index] = p.size;
+	SizeStep[index] = p.sizestep;
+	Subsector[index] = p.subsector;
+	TTL[index] = p.ttl;
+	Bright[index] = p.bright;
+	NoTimeFreeze[index] = p.notimefreeze;
+	FadeStep[index] = p.fadestep;
+	Alpha[index] = p.alpha;
+	Color[index] = p.color;
+}
+
+void FParticleData::Move(unsigned from, unsigned to)
+{
+	Pos[to] = Pos[from];
+	Vel[to] = Vel[from];
+	Acc[to] = Acc[from];
+	Size[to] = Size[from];
+	SizeStep[to] = SizeStep[from];
+	Subsector[to] = Subsector[from];
+	TTL[to] = TTL[from];
+	Bright[to] = Bright[from];
+	NoTimeFreeze[to] = NoTimeFreeze[from];
+	FadeStep[to] = FadeStep[from];
+	Alpha[to] = Alpha[from];
+	Color[to] = Color[from];
+}
+
+// The returned particle is only valid until the next one gets requested.
+inline particle_t *NewParticle (FLevelLocals *Level)
+{
+	return Level->ParticleData.New();
 }
 
 //
@@ -129,48 +226,61 @@ void P_InitParticles (FLevelLocals *Level)
 		num = r_maxparticles;
 
 	// This should be good, but eh...
-	int NumParticles = clamp<int>(num, 100, 65535);
+	int NumParticles = clamp<int>(num, MIN_PARTICLES, MAX_PARTICLES);
 
-	Level->Particles.Resize(NumParticles);
+	Level->ParticleData.Resize(NumParticles);
 	P_ClearParticles (Level);
 }
 
 void P_ClearParticles (FLevelLocals *Level)
 {
-	int i = 0;
-	memset (Level->Particles.Data(), 0, Level->Particles.Size() * sizeof(particle_t));
-	Level->ActiveParticles = NO_PARTICLE;
-	Level->InactiveParticles = 0;
-	for (auto &p : Level->Particles)
-		p.tnext = ++i;
-	Level->Particles.Last().tnext = NO_PARTICLE;
+	Level->ParticleData.Clear();
+	Level->Particles.Clear();
 }
 
 // Group particles by subsectors. Because particles are always
 // in motion, there is little benefit to caching this information
-// from one frame to the next.
+// from one frame to the next. It only needs to be redone after
+// a tic though, not for every frame.
 
 void P_FindParticleSubsectors (FLevelLocals *Level)
 {
-	if (Level->ParticlesInSubsec.Size() < Level->subsectors.Size())
+	auto &pd = Level->ParticleData;
+	pd.Flush();
+
+	if (Level->ParticlesInSubsec.Size() != Level->subsectors.Size())
 	{
-		Level->ParticlesInSubsec.Reserve (Level->subsectors.Size() - Level->ParticlesInSubsec.Size());
+		Level->ParticlesInSubsec.Resize(Level->subsectors.Size());
+		pd.Linked = false;
 	}
 
-	fillshort (&Level->ParticlesInSubsec[0], Level->subsectors.Size(), NO_PARTICLE);
-
 	if (!r_particles)
 	{
+		for (auto &ss : Level->ParticlesInSubsec) ss = NO_PARTICLE;
+		pd.Linked = false;
 		return;
 	}
-	for (uint16_t i = Level->ActiveParticles; i != NO_PARTICLE; i = Level->Particles[i].tnext)
+	if (pd.Linked)
+	{
+		return;
+	}
+
+	for (auto &ss : Level->ParticlesInSubsec) ss = NO_PARTICLE;
+	Level->Particles.Resize(pd.Count);
+
+	// Newest first, so that each subsector's list is in spawn order.
+	for (unsigned i = pd.Count; i-- > 0; )
 	{
 		 // Try to reuse the subsector from the last portal check, if still valid.
-		if (Level->Particles[i].subsector == nullptr) Level->Particles[i].subsector = Level->PointInRenderSubsector(Level->Particles[i].Pos);
-		int ssnum = Level->Particles[i].subsector->Index();
-		Level->Particles[i].snext = Level->ParticlesInSubsec[ssnum];
+		if (pd.Subsector[i] == nullptr) pd.Subsector[i] = Level->PointInRenderSubsector(pd.Pos[i]);
+
+		particle_t &particle = Level->Particles[i];
+		pd.Load(i, particle);
+		int ssnum = particle.subsector->Index();
+		particle.snext = Level->ParticlesInSubsec[ssnum];
 		Level->ParticlesInSubsec[ssnum] = i;
 	}
+	pd.Linked = true;
 }
 
 static TMap<int, int> ColorSaver;
@@ -210,65 +320,221 @@ void P_InitEffects ()
 	blood2 = ParticleColor(RPART(kind)/3, GPART(kind)/3, BPART(kind)/3);
 }
 
-void P_ThinkParticles (FLevelLocals *Level)
+//==========================================================================
+//
+// P_ThinkParticles
+//
+// The particles get updated in passes over their arrays: first their
+// fading, growing and aging, which decides which ones expire, then their
+// movement. Both of these are straight arithmetic that is done several
+// particles at a time. Then the expired particles get removed and the
+// rest look up the subsector they are in and whether they crossed a
+// sector portal.
+//
+//==========================================================================
+
+enum EParticleState
 {
-	int i;
-	particle_t *particle, *prev;
+	PST_EXPIRED,
+	PST_MOVED,
+	PST_MOVEDZ,		// did not move horizontally, so it is still in the same subsector
+	PST_FROZEN,
+};
+
+static int ParticlesExpired;
+static cycle_t ParticleCycles;
+
+static inline uint8_t ParticleState(const FParticleData &pd, unsigned i, bool expired)
+{
+	if (expired) return PST_EXPIRED;
+	return pd.Vel[i].X == 0 && pd.Vel[i].Y == 0 ? PST_MOVEDZ : PST_MOVED;
+}
 
-	i = Level->ActiveParticles;
-	prev = NULL;
-	while (i != NO_PARTICLE)
+static inline void AgeParticle(FParticleData &pd, unsigned i)
+{
+	float oldtrans = pd.Alpha[i];
+	pd.Alpha[i] -= pd.FadeStep[i];
+	pd.Size[i] += pd.SizeStep[i];
+	bool expired = pd.Alpha[i] <= 0 || oldtrans < pd.Alpha[i] || --pd.TTL[i] <= 0 || pd.Size[i] <= 0;
+	pd.State[i] = ParticleState(pd, i, expired);
+}
+
+static void AgeParticles(FParticleData &pd, unsigned start, unsigned end)
+{
+	unsigned i = start;
+#ifndef NO_SSE
+	float *alpha = pd.Alpha.Data();
+	const float *fadestep = pd.FadeStep.Data();
+	double *size = pd.Size.Data();
+	const double *sizestep = pd.SizeStep.Data();
+	int32_t *ttl = pd.TTL.Data();
+	const __m128 zerof = _mm_setzero_ps();
+	const __m128d zerod = _mm_setzero_pd();
+	const __m128i one = _mm_set1_epi32(1);
+	for (; i + 4 <= end; i += 4)
 	{
-		particle = &Level->Particles[i];
-		i = particle->tnext;
-		if (!particle->notimefreeze && Level->isFrozen())
+		__m128 oldtrans = _mm_loadu_ps(alpha + i);
+		__m128 trans = _mm_sub_ps(oldtrans, _mm_loadu_ps(fadestep + i));
+		_mm_storeu_ps(alpha + i, trans);
+		int expired = _mm_movemask_ps(_mm_or_ps(_mm_cmple_ps(trans, zerof), _mm_cmplt_ps(oldtrans, trans)));
+
+		__m128i ticks = _mm_sub_epi32(_mm_loadu_si128((__m128i*)(ttl + i)), one);
+		_mm_storeu_si128((__m128i*)(ttl + i), ticks);
+		expired |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(ticks, one)));
+
+		__m128d size01 = _mm_add_pd(_mm_loadu_pd(size + i), _mm_loadu_pd(sizestep + i));
+		__m128d size23 = _mm_add_pd(_mm_loadu_pd(size + i + 2), _mm_loadu_pd(sizestep + i + 2));
+		_mm_storeu_pd(size + i, size01);
+		_mm_storeu_pd(size + i + 2, size23);
+		expired |= _mm_movemask_pd(_mm_cmple_pd(size01, zerod)) | (_mm_movemask_pd(_mm_cmple_pd(size23, zerod)) << 2);
+
+		for (int j = 0; j < 4; j++)
 		{
-			prev = particle;
-			continue;
+			pd.State[i + j] = ParticleState(pd, i + j, !!(expired & (1 << j)));
 		}
-		
-		auto oldtrans = particle->alpha;
-		particle->alpha -= particle->fadestep;
-		particle->size += particle->sizestep;
-		if (particle->alpha <= 0 || oldtrans < particle->alpha || --particle->ttl <= 0 || (particle->size <= 0))
-		{ // The particle has expired, so free it
-			memset (particle, 0, sizeof(particle_t));
-			if (prev)
-				prev->tnext = i;
-			else
-				Level->ActiveParticles = i;
-			particle->tnext = Level->InactiveParticles;
-			Level->InactiveParticles = (int)(particle - Level->Particles.Data());
-			continue;
+	}
+#endif
+	for (; i < end; i++)
+	{
+		AgeParticle(pd, i);
+	}
+}
+
+// Adds one array of vectors to another, as if they were plain arrays of doubles.
+static void AddVectors(DVector3 *dest, const DVector3 *add, unsigned count)
+{
+	static_assert(sizeof(DVector3) == 3 * sizeof(double), "DVector3 must not have padding");
+	double *d = &dest->X;
+	const double *a = &add->X;
+	unsigned n = count * 3, i = 0;
+#ifndef NO_SSE
+	for (; i + 4 <= n; i += 4)
+	{
+		_mm_storeu_pd(d + i, _mm_add_pd(_mm_loadu_pd(d + i), _mm_loadu_pd(a + i)));
+		_mm_storeu_pd(d + i + 2, _mm_add_pd(_mm_loadu_pd(d + i + 2), _mm_loadu_pd(a + i + 2)));
+	}
+#endif
+	for (; i < n; i++)
+	{
+		d[i] += a[i];
+	}
+}
+
+static void MoveParticles(FLevelLocals *Level, FParticleData &pd, unsigned start, unsigned end)
+{
+	if (!Level->PortalBlockmap.containsLines)
+	{
+		AddVectors(&pd.Pos[start], &pd.Vel[start], end - start);
+	}
+	else
+	{
+		for (unsigned i = start; i < end; i++)
+		{
+			if (pd.State[i] == PST_EXPIRED) continue;
+
+			// Handle crossing a line portal
+			DVector3 &pos = pd.Pos[i];
+			const DVector3 &vel = pd.Vel[i];
+			DVector2 newxy = Level->GetPortalOffsetPosition(pos.X, pos.Y, vel.X, vel.Y);
+			pos.X = newxy.X;
+			pos.Y = newxy.Y;
+			pos.Z += vel.Z;
 		}
+	}
+	AddVectors(&pd.Vel[start], &pd.Acc[start], end - start);
+}
 
-		// Handle crossing a line portal
-		DVector2 newxy = Level->GetPortalOffsetPosition(particle->Pos.X, particle->Pos.Y, particle->Vel.X, particle->Vel.Y);
-		particle->Pos.X = newxy.X;
-		particle->Pos.Y = newxy.Y;
-		particle->Pos.Z += particle->Vel.Z;
-		particle->Vel += particle->Acc;
-		particle->subsector = Level->PointInRenderSubsector(particle->Pos);
-		sector_t *s = particle->subsector->sector;
-		// Handle crossing a sector portal.
-		if (!s->PortalBlocksMovement(sector_t::ceiling))
+static void RelinkParticle(FLevelLocals *Level, FParticleData &pd, unsigned i, bool moved)
+{
+	DVector3 &pos = pd.Pos[i];
+	if (moved || pd.Subsector[i] == nullptr)
+	{
+		pd.Subsector[i] = Level->PointInRenderSubsector(pos);
+	}
+	sector_t *s = pd.Subsector[i]->sector;
+	// Handle crossing a sector portal.
+	if (!s->PortalBlocksMovement(sector_t::ceiling))
+	{
+		if (pos.Z > s->GetPortalPlaneZ(sector_t::ceiling))
 		{
-			if (particle->Pos.Z > s->GetPortalPlaneZ(sector_t::ceiling))
-			{
-				particle->Pos += s->GetPortalDisplacement(sector_t::ceiling);
-				particle->subsector = NULL;
-			}
+			pos += s->GetPortalDisplacement(sector_t::ceiling);
+			pd.Subsector[i] = nullptr;
+		}
+	}
+	else if (!s->PortalBlocksMovement(sector_t::floor))
+	{
+		if (pos.Z < s->GetPortalPlaneZ(sector_t::floor))
+		{
+			pos += s->GetPortalDisplacement(sector_t::floor);
+			pd.Subsector[i] = nullptr;
 		}
-		else if (!s->PortalBlocksMovement(sector_t::floor))
+	}
+}
+
+void P_ThinkParticles (FLevelLocals *Level)
+{
+	auto &pd = Level->ParticleData;
+	pd.Flush();
+
+	unsigned count = pd.Count;
+	if (count == 0)
+	{
+		ParticlesExpired = 0;
+		ParticleCycles.Reset();
+		return;
+	}
+
+	ParticleCycles.Reset();
+	ParticleCycles.Clock();
+	pd.Linked = false;
+
+	if (!Level->isFrozen())
+	{
+		AgeParticles(pd, 0, count);
+		MoveParticles(Level, pd, 0, count);
+	}
+	else
+	{
+		// Only the runs of particles that ignore the time freeze get updated.
+		unsigned i = 0;
+		while (i < count)
 		{
-			if (particle->Pos.Z < s->GetPortalPlaneZ(sector_t::floor))
+			if (!pd.NoTimeFreeze[i])
 			{
-				particle->Pos += s->GetPortalDisplacement(sector_t::floor);
-				particle->subsector = NULL;
+				pd.State[i++] = PST_FROZEN;
+				continue;
 			}
+			unsigned end = i + 1;
+			while (end < count && pd.NoTimeFreeze[end]) end++;
+			AgeParticles(pd, i, end);
+			MoveParticles(Level, pd, i, end);
+			i = end;
 		}
-		prev = particle;
 	}
+
+	// Remove the expired particles, keeping the others in order.
+	unsigned live = 0;
+	for (unsigned i = 0; i < count; i++)
+	{
+		uint8_t state = pd.State[i];
+		if (state == PST_EXPIRED) continue;
+
+		if (live != i) pd.Move(i, live);
+		if (state != PST_FROZEN) RelinkParticle(Level, pd, live, state == PST_MOVED);
+		live++;
+	}
+	ParticlesExpired = count - live;
+	pd.Count = live;
+
+	ParticleCycles.Unclock();
+}
+
+ADD_STAT(particles)
+{
+	FString out;
+	auto &pd = primaryLevel->ParticleData;
+	out.Format("Particles: %u of %u, %d expired, %04.2f ms", pd.Count, pd.Capacity, ParticlesExpired, ParticleCycles.TimeMS());
+	return out;
 }
 
 enum PSFlag
@@ -34,6 +34,7 @@
 #pragma once
 
 #include "vectors.h"
+#include "tarray.h"
 
 #define FX_ROCKET			0x00000001
 #define FX_GRENADE			0x00000002
@@ -44,6 +45,7 @@ struct subsector_t;
 struct FLevelLocals;
 
 // [RH] Particle details
+// This is what the spawning functions fill in and what the renderers get to see.
 
 struct particle_t
 {
@@ -59,11 +61,50 @@ struct particle_t
 	float	fadestep;
 	float	alpha;
 	int		color;
-	uint16_t	tnext;
-	uint16_t	snext;
+	uint32_t	snext;
 };
 
-const uint16_t NO_PARTICLE = 0xffff;
+const uint32_t NO_PARTICLE = 0xffffffff;
+
+enum
+{
+	MIN_PARTICLES = 100,
+	MAX_PARTICLES = 1000000,
+};
+
+// The live particles, with one array per field so that P_ThinkParticles
+// can update them in a few tight loops. They are always packed at the
+// start of the arrays, in the order they were spawned.
+
+struct FParticleData
+{
+	TArray<DVector3> Pos, Vel, Acc;
+	TArray<double> Size, SizeStep;
+	TArray<float> Alpha, FadeStep;
+	TArray<int32_t> TTL;
+	TArray<int> Color;
+	TArray<uint8_t> Bright, NoTimeFreeze;
+	TArray<subsector_t *> Subsector;
+	TArray<uint8_t> State;		// scratch space for P_ThinkParticles
+	unsigned Count = 0;
+	unsigned Capacity = 0;
+
+	// The particle last handed out for spawning. It is added to the
+	// arrays once the next one is requested or the particles are used.
+	particle_t Pending;
+	bool HasPending = false;
+
+	// Level::Particles and ParticlesInSubsec are up to date.
+	bool Linked = false;
+
+	void Resize(unsigned capacity);
+	void Clear();
+	void Flush();
+	particle_t *New();
+	void Load(unsigned index, particle_t &p) const;
+	void Store(unsigned index, const particle_t &p);
+	void Move(unsigned from, unsigned to);
+};
 
 void P_InitParticles(FLevelLocals *);
 void P_ClearParticles (FLevelLocals *Level);
@@ -1952,11 +1952,16 @@ subsector_t *FLevelLocals::PointInSubsector(double x, double y)
 
 	fixed_t xx = FloatToFixed(x);
 	fixed_t yy = FloatToFixed(y);
-	do
+
+	// The grid knows how far down the tree most points go the same way.
+	void *start = (node == HeadNode() ? renderSubsectorGrid : gameSubsectorGrid).GetStart(xx, yy);
+	if (start != nullptr) node = (node_t *)start;
+
+	while (!((size_t)node & 1))
 	{
 		side = R_PointOnSide(xx, yy, node);
 		node = (node_t *)node->children[side];
-	} while (!((size_t)node & 1));
+	}
 
 	return (subsector_t *)((uint8_t *)node - 1);
 }
@@ -2006,13 +2011,15 @@ subsector_t *FLevelLocals::PointInRenderSubsector (fixed_t x, fixed_t y)
 		return &subsectors[0];
 	
 	node = HeadNode();
+
+	void *start = renderSubsectorGrid.GetStart(x, y);
+	if (start != nullptr) node = (node_t *)start;
 	
-	do
+	while (!((size_t)node & 1))
 	{
 		side = R_PointOnSide (x, y, node);
 		node = (node_t *)node->children[side];
 	}
-	while (!((size_t)node & 1));
 	
 	return (subsector_t *)((uint8_t *)node - 1);
 }
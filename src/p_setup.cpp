@@ -61,6 +61,7 @@
 #include "r_utility.h"
 #include "p_spec.h"
 #include "g_levellocals.h"
+#include "p_aabbtree.h"
 #include "c_dispatch.h"
 #include "a_dynlight.h"
 #include "events.h"
@@ -318,6 +319,10 @@ void FLevelLocals::ClearLevelData()
 	Zones.Clear();
 	blockmap.Clear();
 	Polyobjects.Clear();
+	if (aabbTree) delete aabbTree;
+	aabbTree = nullptr;
+	renderSubsectorGrid.Clear();
+	gameSubsectorGrid.Clear();
 
 	for (auto &pb : PolyBlockMap)
 	{
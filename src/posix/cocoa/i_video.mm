@@ -45,6 +45,7 @@
 #include "m_png.h"
 #include "r_renderer.h"
 #include "swrenderer/r_swrenderer.h"
+#include "swrenderer/r_memoryframebuffer.h"
 #include "st_console.h"
 #include "v_text.h"
 #include "version.h"
@@ -555,7 +556,15 @@ void I_ShutdownGraphics()
 
 void I_InitGraphics()
 {
-	Video = new CocoaVideo;
+	if (I_IsHeadless())
+	{
+		Printf("Rendering to memory (headless)\n");
+		Video = new MemoryVideo;
+	}
+	else
+	{
+		Video = new CocoaVideo;
+	}
 	atterm(I_ShutdownGraphics);
 }
 
@@ -420,6 +420,9 @@ void ProcessSDLWindowEvent(const SDL_WindowEvent &event)
 // each platform has its own specific version of this function.
 void I_SetWindowTitle(const char* caption)
 {
+	if (I_IsHeadless())
+		return;
+
 	auto window = static_cast<SystemGLFrameBuffer *>(screen)->GetSDLWindow();
 	if (caption)
 		SDL_SetWindowTitle(window, caption);
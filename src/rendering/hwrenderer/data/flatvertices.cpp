@@ -35,6 +35,17 @@
 #include "cmdlib.h"
 #include "hwrenderer/data/buffers.h"
 #include "hwrenderer/scene/hw_renderstate.h"
+#include "stats.h"
+
+// Plane vertex updates of the current and the last frame
+struct FPlaneUpdateStats
+{
+	int planes;
+	int vertices;
+	int uploads;
+	int uploadedvertices;
+};
+static FPlaneUpdateStats planeUpdates, lastPlaneUpdates;
 
 //==========================================================================
 //
@@ -294,15 +305,72 @@ void FFlatVertexBuffer::UpdatePlaneVertices(sector_t *sec, int plane)
 {
 	int startvt = sec->vboindex[plane];
 	int countvt = sec->vbocount[plane];
+	if (countvt <= 0) return;
+
 	secplane_t &splane = sec->GetSecPlane(plane);
+	float diff = (plane == sector_t::floor && sec->transdoor) ? -1.f : 0.f;
 	FFlatVertex *vt = &vbo_shadowdata[startvt];
-	FFlatVertex *mapvt = GetBuffer(startvt);
-	for(int i=0; i<countvt; i++, vt++, mapvt++)
+	if (!splane.isSlope())
+	{
+		// All vertices of a level plane share the same height, so there is nothing to compute per vertex.
+		float z = (float)splane.ZatPoint(0., 0.) + diff;
+		for (int i = 0; i < countvt; i++)
+		{
+			vt[i].z = z;
+		}
+	}
+	else
 	{
-		vt->z = (float)splane.ZatPoint(vt->x, vt->y);
-		if (plane == sector_t::floor && sec->transdoor) vt->z -= 1;
-		mapvt->z = vt->z;
+		for (int i = 0; i < countvt; i++)
+		{
+			vt[i].z = (float)splane.ZatPoint(vt[i].x, vt[i].y) + diff;
+		}
 	}
+
+	// The buffer gets all changes of a scene at once in FlushPlaneUpdates.
+	mDirtyRanges.Push({ (unsigned)startvt, (unsigned)countvt });
+	planeUpdates.planes++;
+	planeUpdates.vertices += countvt;
+}
+
+//==========================================================================
+//
+// Copies the plane vertices that changed into the buffer, merging
+// adjacent and overlapping ranges into a single copy each.
+// The vertex buffer must be mapped.
+//
+//==========================================================================
+
+void FFlatVertexBuffer::FlushPlaneUpdates()
+{
+	if (mDirtyRanges.Size() == 0) return;
+
+	std::sort(mDirtyRanges.begin(), mDirtyRanges.end(), [](const FDirtyRange &a, const FDirtyRange &b)
+	{
+		return a.start < b.start;
+	});
+
+	auto upload = [&](unsigned start, unsigned end)
+	{
+		memcpy(GetBuffer(start), &vbo_shadowdata[start], (end - start) * sizeof(FFlatVertex));
+		planeUpdates.uploads++;
+		planeUpdates.uploadedvertices += end - start;
+	};
+
+	unsigned start = mDirtyRanges[0].start;
+	unsigned end = start + mDirtyRanges[0].count;
+	for (unsigned i = 1; i < mDirtyRanges.Size(); i++)
+	{
+		auto &range = mDirtyRanges[i];
+		if (range.start > end)
+		{
+			upload(start, end);
+			start = range.start;
+		}
+		end = MAX(end, range.start + range.count);
+	}
+	upload(start, end);
+	mDirtyRanges.Clear();
 }
 
 //==========================================================================
@@ -353,6 +421,19 @@ void FFlatVertexBuffer::CheckUpdate(sector_t *sector)
 		CheckPlanes(sector->e->XFloor.ffloors[i]->model);
 }
 
+//==========================================================================
+//
+// Starts a new frame
+//
+//==========================================================================
+
+void FFlatVertexBuffer::Reset()
+{
+	mCurIndex = mIndex;
+	lastPlaneUpdates = planeUpdates;
+	planeUpdates = {};
+}
+
 //==========================================================================
 //
 //
@@ -399,3 +480,11 @@ void FFlatVertexBuffer::CreateVBO(TArray<sector_t> &sectors)
 	Copy(0, mIndex);
 	mIndexBuffer->SetData(ibo_data.Size() * sizeof(uint32_t), &ibo_data[0]);
 }
+
+ADD_STAT(flatupdates)
+{
+	FString out;
+	out.Format("Moving planes: %d planes, %d vertices updated, %d vertices in %d uploads",
+		lastPlaneUpdates.planes, lastPlaneUpdates.vertices, lastPlaneUpdates.uploadedvertices, lastPlaneUpdates.uploads);
+	return out;
+}
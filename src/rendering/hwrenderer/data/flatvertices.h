@@ -59,6 +59,13 @@ class FFlatVertexBuffer
 	std::atomic<unsigned int> mCurIndex;
 	unsigned int mNumReserved;
 
+	// Plane vertices that changed in vbo_shadowdata but were not copied to the buffer yet.
+	struct FDirtyRange
+	{
+		unsigned int start, count;
+	};
+	TArray<FDirtyRange> mDirtyRanges;
+
 
 	static const unsigned int BUFFER_SIZE = 2000000;
 	static const unsigned int BUFFER_SIZE_TO_USE = 1999500;
@@ -100,10 +107,7 @@ public:
 
 	std::pair<FFlatVertex *, unsigned int> AllocVertices(unsigned int count);
 
-	void Reset()
-	{
-		mCurIndex = mIndex;
-	}
+	void Reset();
 
 	void Map()
 	{
@@ -127,6 +131,7 @@ protected:
 	void CheckPlanes(sector_t *sector);
 public:
 	void CheckUpdate(sector_t *sector);
+	void FlushPlaneUpdates();
 
 };
 
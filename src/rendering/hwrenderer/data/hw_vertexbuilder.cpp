@@ -22,6 +22,9 @@
 
 
 
+#include <atomic>
+#include <thread>
+#include <vector>
 #include "g_levellocals.h"
 #include "hw_vertexbuilder.h"
 #include "earcut.hpp"
@@ -137,12 +140,43 @@ static void CreateVerticesForSector(sector_t *sec, VertexContainer &gen)
 }
 
 
+//==========================================================================
+//
+// Every sector only writes to its own container and its own sections,
+// so large levels get their sectors triangulated on several threads.
+//
+//==========================================================================
+
 TArray<VertexContainer> BuildVertices(TArray<sector_t> &sectors)
 {
+	enum
+	{
+		MaxThreads = 8,
+		MinSectorsPerThread = 256,
+	};
+
 	TArray<VertexContainer> verticesPerSector(sectors.Size(), true);
-	for (unsigned i=0; i< sectors.Size(); i++)
+	std::atomic<unsigned> nextsector(0);
+	auto work = [&]()
+	{
+		for (unsigned i = nextsector.fetch_add(1); i < sectors.Size(); i = nextsector.fetch_add(1))
+		{
+			CreateVerticesForSector(&sectors[i], verticesPerSector[i]);
+		}
+	};
+
+	int numthreads = clamp<int>(std::thread::hardware_concurrency(), 1, MaxThreads);
+	numthreads = clamp<int>(sectors.Size() / MinSectorsPerThread, 1, numthreads);
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numthreads; i++)
+	{
+		threads.emplace_back(work);
+	}
+	work();
+	for (auto &thread : threads)
 	{
-		CreateVerticesForSector(&sectors[i], verticesPerSector[i]);
+		thread.join();
 	}
 	return verticesPerSector;
 }
@@ -75,6 +75,7 @@ void FLightBuffer::Clear()
 {
 	mIndex = 0;
 	mLastMappedIndex = UINT_MAX;
+	mGeneration++;
 }
 
 int FLightBuffer::UploadLights(FDynLightData &data)
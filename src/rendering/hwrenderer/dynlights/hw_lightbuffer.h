@@ -21,6 +21,7 @@ class FLightBuffer
 	unsigned int mBufferSize;
 	unsigned int mByteSize;
     unsigned int mMaxUploadSize;
+	unsigned int mGeneration = 0;
     
 	void CheckSize();
 
@@ -33,6 +34,8 @@ public:
 	void Map() { mBuffer->Map(); }
 	void Unmap() { mBuffer->Unmap(); }
 	unsigned int GetBlockSize() const { return mBlockSize; }
+	// Changes with every Clear, so that indices from an earlier upload can be checked for validity.
+	unsigned int GetGeneration() const { return mGeneration; }
 	bool GetBufferType() const { return mBufferType; }
 
 	int DoBindUBO(unsigned int index);
@@ -0,0 +1,200 @@
+//
+//---------------------------------------------------------------------------
+//
+// Copyright(C) 2026 agent
+// All rights reserved.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//--------------------------------------------------------------------------
+//
+/*
+** hw_lightcache.cpp
+** Keeps the dynamic light lists of sections between frames
+**
+** Most lights and most planes do not change from one frame to the next,
+** so the lists only get rebuilt for sections where a light moved, changed
+** its appearance, got linked in or out, or where the plane moved.
+** The light buffer still gets refilled every frame because the GPU may
+** be reading last frame's data, but a list is only uploaded once per frame
+** no matter how often it gets drawn.
+**
+**/
+
+#include "c_cvars.h"
+#include "stats.h"
+#include "g_levellocals.h"
+#include "actorinlines.h"
+#include "hw_lightcache.h"
+#include "hw_lightbuffer.h"
+
+CVAR(Bool, gl_light_cache, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+FSectionLightCache sectionLightCache;
+
+static unsigned NextDataVersion = 1;
+static std::atomic<int> ListsRebuilt, ListsReused, UploadsReused, ListsUncached;
+static int LastRebuilt, LastReused, LastUploadsReused, LastUncached, LastLightsChanged;
+static int LightsChanged;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static void GetLightDataState(FDynamicLight *light, FLightDataState &state)
+{
+	state.Pos = light->Pos;
+	state.radius = light->GetRadius();
+	state.color = (light->GetRed() << 16) | (light->GetGreen() << 8) | light->GetBlue();
+	state.flags = *light->pLightFlags;
+	state.shadowmapIndex = light->mShadowmapIndex;
+	state.portalGroup = light->Sector ? light->Sector->PortalGroup : 0;
+	state.active = light->IsActive();
+	if (light->IsSpot())
+	{
+		state.spotInner = light->pSpotInnerAngle->Degrees;
+		state.spotOuter = light->pSpotOuterAngle->Degrees;
+		state.pitch = light->pPitch->Degrees;
+		state.yaw = light->target ? light->target->Angles.Yaw.Degrees : 0.;
+	}
+	else
+	{
+		state.spotInner = state.spotOuter = state.pitch = state.yaw = 0.;
+	}
+}
+
+//==========================================================================
+//
+// Must be called on the main thread before a scene gets set up, after
+// everything that can change the lights for this frame has been done.
+//
+//==========================================================================
+
+void FSectionLightCache::BeginScene(FLevelLocals *Level, FLightBuffer *buffer)
+{
+	if (buffer->GetGeneration() != mGeneration)
+	{
+		// A new frame. Publish the last one's statistics.
+		mGeneration = buffer->GetGeneration();
+		LastRebuilt = ListsRebuilt.exchange(0);
+		LastReused = ListsReused.exchange(0);
+		LastUploadsReused = UploadsReused.exchange(0);
+		LastUncached = ListsUncached.exchange(0);
+		LastLightsChanged = LightsChanged;
+		LightsChanged = 0;
+	}
+
+	unsigned numlists = Level->sections.allSections.Size() * 2;
+	if (Level != mLevel || numlists != mNumLists)
+	{
+		mLists.reset(numlists > 0 ? new FSectionLightList[numlists] : nullptr);
+		mLevel = Level;
+		mNumLists = numlists;
+	}
+
+	FLightDataState state;
+	for (auto light = Level->lights; light; light = light->next)
+	{
+		GetLightDataState(light, state);
+		if (light->mDataVersion == 0 || !(state == light->mDataState))
+		{
+			light->mDataState = state;
+			light->mDataVersion = NextDataVersion++;
+			if (NextDataVersion == 0) NextDataVersion = 1;
+			LightsChanged++;
+		}
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FSectionLightList *FSectionLightCache::Lock(FSection *section, bool ceiling)
+{
+	if (!gl_light_cache || section == nullptr || mLevel == nullptr) return nullptr;
+	unsigned index = mLevel->sections.SectionIndex(section) * 2 + ceiling;
+	if (index >= mNumLists) return nullptr;
+
+	auto list = &mLists[index];
+	if (list->busy.test_and_set(std::memory_order_acquire)) return nullptr;
+	return list;
+}
+
+int FSectionLightCache::Upload(FSectionLightList *list, FLightBuffer *buffer, bool rebuilt)
+{
+	(rebuilt ? ListsRebuilt : ListsReused)++;
+	if (!rebuilt && list->uploadGeneration == buffer->GetGeneration())
+	{
+		UploadsReused++;
+		return list->uploadIndex;
+	}
+	list->uploadIndex = buffer->UploadLights(list->data);
+	list->uploadGeneration = buffer->GetGeneration();
+	return list->uploadIndex;
+}
+
+void FSectionLightCache::CountUncached()
+{
+	ListsUncached++;
+}
+
+//==========================================================================
+//
+// The node list is compared as a whole, including inactive lights, so
+// that any light being linked, unlinked or changed invalidates it.
+// Light versions are never reused, so a stale pointer to a deleted light
+// cannot match a new one.
+//
+//==========================================================================
+
+bool FSectionLightList::IsValid(FLightNode *node, const secplane_t &plane, int group) const
+{
+	if (!valid || group != portalgroup || plane.fD() != d || plane.Normal() != normal) return false;
+
+	unsigned i = 0;
+	for (; node; node = node->nextLight, i++)
+	{
+		if (i >= lights.Size()) return false;
+		auto light = node->lightsource;
+		if (lights[i].light != light || lights[i].version != light->mDataVersion || light->mDataVersion == 0) return false;
+	}
+	return i == lights.Size();
+}
+
+void FSectionLightList::Store(FLightNode *node, const secplane_t &plane, int group)
+{
+	lights.Clear();
+	for (; node; node = node->nextLight)
+	{
+		lights.Push({ node->lightsource, node->lightsource->mDataVersion });
+	}
+	normal = plane.Normal();
+	d = plane.fD();
+	portalgroup = group;
+	valid = true;
+	uploadGeneration = 0;
+}
+
+ADD_STAT(lightlists)
+{
+	FString out;
+	out.Format("Flat light lists: %d rebuilt, %d reused, %d uploads reused, %d uncached, %d lights changed",
+		LastRebuilt, LastReused, LastUploadsReused, LastUncached, LastLightsChanged);
+	return out;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "tarray.h"
+#include "vectors.h"
+#include "hw_dynlightdata.h"
+
+struct FLevelLocals;
+struct FSection;
+struct FLightNode;
+class FLightBuffer;
+
+//==========================================================================
+//
+// The dynamic light list of one section's floor or ceiling, kept from
+// the last time it got built. It is valid for as long as the section
+// is touched by the same lights, none of them changed and the plane
+// did not move.
+//
+//==========================================================================
+
+struct FSectionLightList
+{
+	struct Entry
+	{
+		FDynamicLight *light;
+		unsigned version;
+	};
+
+	std::atomic_flag busy = ATOMIC_FLAG_INIT;
+	TArray<Entry> lights;
+	DVector3 normal;
+	double d;
+	int portalgroup;
+	bool valid = false;
+
+	FDynLightData data;
+	unsigned uploadGeneration;
+	int uploadIndex;
+
+	bool IsValid(FLightNode *node, const secplane_t &plane, int portalgroup) const;
+	void Store(FLightNode *node, const secplane_t &plane, int portalgroup);
+};
+
+class FSectionLightCache
+{
+	std::unique_ptr<FSectionLightList[]> mLists;
+	FLevelLocals *mLevel = nullptr;
+	unsigned mNumLists = 0;
+	unsigned mGeneration = 0;
+
+public:
+	void BeginScene(FLevelLocals *Level, FLightBuffer *buffer);
+
+	// Returns nullptr if the list is being used by another thread. The caller has to build the lights itself then.
+	FSectionLightList *Lock(FSection *section, bool ceiling);
+	void Unlock(FSectionLightList *list) { list->busy.clear(std::memory_order_release); }
+
+	// Uploads the list's data unless that already happened since the light buffer was last cleared.
+	int Upload(FSectionLightList *list, FLightBuffer *buffer, bool rebuilt);
+
+	// Counts a surface that could not use the cache.
+	static void CountUncached();
+};
+
+extern FSectionLightCache sectionLightCache;
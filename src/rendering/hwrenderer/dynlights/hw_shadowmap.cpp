@@ -159,7 +159,7 @@ bool IShadowMap::ValidateAABBTree(FLevelLocals *Level)
 	if (mAABBTree)
 		return true;
 
-	mAABBTree.reset(new hwrenderer::LevelAABBTree(Level));
+	mAABBTree.reset(new LevelAABBTree(Level));
 	return false;
 }
 
@@ -1,7 +1,7 @@
 
 #pragma once
 
-#include "hw_aabbtree.h"
+#include "p_aabbtree.h"
 #include "stats.h"
 #include <memory>
 
@@ -51,7 +51,7 @@ protected:
 	unsigned mLastNumSegs = 0;
 
 	// AABB-tree of the level, used for ray tests
-	std::unique_ptr<hwrenderer::LevelAABBTree> mAABBTree;
+	std::unique_ptr<LevelAABBTree> mAABBTree;
 
 	IShadowMap(const IShadowMap &) = delete;
 	IShadowMap &operator=(IShadowMap &) = delete;
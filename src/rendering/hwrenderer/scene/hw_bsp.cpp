@@ -33,6 +33,7 @@
 #include "po_man.h"
 #include "m_fixed.h"
 #include "ctpl.h"
+#include "templates.h"
 #include "hwrenderer/scene/hw_fakeflat.h"
 #include "hwrenderer/scene/hw_clipper.h"
 #include "hwrenderer/scene/hw_drawstructs.h"
@@ -46,6 +47,7 @@
 #endif // ARCH_IA32
 
 CVAR(Bool, gl_multithread, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CVAR(Int, gl_multithread_workers, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// 0 picks a count from the number of cores
 
 thread_local bool isWorkerThread;
 ctpl::thread_pool renderPool(1);
@@ -60,7 +62,6 @@ struct RenderJob
 		SpriteJob,
 		ParticleJob,
 		PortalJob,
-		TerminateJob	// inserted when all work is done so that the worker can return.
 	};
 	
 	int type;
@@ -72,8 +73,11 @@ struct RenderJob
 class RenderJobQueue
 {
 	RenderJob pool[300000];	// Way more than ever needed. The largest ever seen on a single viewpoint is around 40000.
+	std::atomic<bool> done[300000];
 	std::atomic<int> readindex{};
 	std::atomic<int> writeindex{};
+	std::atomic<int> doneindex{};	// all jobs below this one are done
+	std::atomic<bool> finished{};
 public:
 	void AddJob(int type, subsector_t *sub, seg_t *seg = nullptr)
 	{
@@ -83,59 +87,267 @@ public:
 		writeindex++;	// update index only after the value has been written.
 	}
 
-	RenderJob *GetJob()
+	// Any number of workers may take jobs from the queue. The returned index is the order
+	// in which the BSP traversal created the job, or -1 if there is nothing to do right now.
+	int GetJob()
 	{
-		if (readindex < writeindex) return &pool[readindex++];
-		return nullptr;
+		int index = readindex;
+		while (index < writeindex)
+		{
+			if (readindex.compare_exchange_weak(index, index + 1)) return index;
+		}
+		return -1;
+	}
+
+	RenderJob &operator[](int index)
+	{
+		return pool[index];
+	}
+
+	void FinishJob(int index)
+	{
+		done[index] = true;
+		// Whoever finishes the oldest job moves the mark past all the later ones that are already done.
+		int mark = doneindex;
+		while (mark < writeindex && done[mark])
+		{
+			if (doneindex.compare_exchange_weak(mark, mark + 1)) mark++;
+		}
+	}
+
+	// Jobs are handed out in order, so all earlier ones are already being worked on and will finish without waiting for this one.
+	void WaitForEarlierJobs(int index)
+	{
+		while (doneindex < index)
+		{
+#ifdef ARCH_IA32
+			_mm_pause();
+#endif // ARCH_IA32
+		}
+	}
+
+	// Called by the main thread after the last job has been added so that the workers can return.
+	void Finish()
+	{
+		finished = true;
+	}
+
+	bool IsFinished()
+	{
+		return finished;
 	}
 	
 	void ReleaseAll()
 	{
+		for (int i = 0; i < writeindex; i++) done[i] = false;
 		readindex = 0;
 		writeindex = 0;
+		doneindex = 0;
+		finished = false;
 	}
 };
 
 static RenderJobQueue jobQueue;	// One static queue is sufficient here. This code will never be called recursively.
 
-void HWDrawInfo::WorkerThread()
+//==========================================================================
+//
+// With more than one worker the jobs are no longer processed in order,
+// so each worker collects its draw items and decals separately and
+// remembers which job created them. Once all workers are done the items
+// are merged back in job order, which gives exactly the lists a single
+// worker would have produced.
+//
+//==========================================================================
+
+enum { MaxRenderWorkers = 16 };
+
+struct RenderWorker
+{
+	// Where the items of one job end in each list. Jobs that created nothing are not recorded.
+	struct JobEnd
+	{
+		int job;
+		unsigned drawitems[GLDL_TYPES];
+		unsigned decals[2];
+	};
+
+	HWDrawList drawlists[GLDL_TYPES];
+	TArray<GLDecal *> Decals[2];
+	TArray<JobEnd> jobs;
+	unsigned itemcount = 0;
+
+	void EndJob(int job)
+	{
+		JobEnd end;
+		unsigned count = 0;
+		end.job = job;
+		for (int i = 0; i < GLDL_TYPES; i++)
+		{
+			end.drawitems[i] = drawlists[i].drawitems.Size();
+			count += end.drawitems[i];
+		}
+		for (int i = 0; i < 2; i++)
+		{
+			end.decals[i] = Decals[i].Size();
+			count += end.decals[i];
+		}
+		if (count != itemcount)
+		{
+			jobs.Push(end);
+			itemcount = count;
+		}
+	}
+
+	void Clear()
+	{
+		for (auto &list : drawlists) list.Reset();
+		Decals[0].Clear();
+		Decals[1].Clear();
+		jobs.Clear();
+		itemcount = 0;
+	}
+};
+
+static RenderWorker renderWorkers[MaxRenderWorkers];
+static thread_local RenderWorker *currentWorker;
+static thread_local int currentJob;
+static int numRenderWorkers;	// number of workers processing the current scene
+static std::mutex sharedStateMutex;
+
+static int GetRenderWorkerCount()
+{
+	if (gl_multithread_workers > 0) return MIN<int>(gl_multithread_workers, MaxRenderWorkers);
+
+	// The main thread still has to walk the BSP alone, so past a few workers they mostly wait for jobs.
+	int cores = std::thread::hardware_concurrency();
+	return clamp(cores - 1, 1, 4);
+}
+
+HWDrawList *HWDrawInfo::CurrentDrawLists()
+{
+	return currentWorker ? currentWorker->drawlists : drawlists;
+}
+
+TArray<GLDecal *> *HWDrawInfo::CurrentDecals()
+{
+	return currentWorker ? currentWorker->Decals : Decals;
+}
+
+//==========================================================================
+//
+// Guards the scene state that the workers cannot keep apart: the portal
+// list, the missing texture collection, things that get claimed through
+// their validcount and actors that are temporarily moved through line
+// portals. The lock is only taken when more than one worker is running.
+//
+// To keep the result the same on every run, a job only gets the lock
+// once all earlier jobs are done. So everything that touches the shared
+// state happens in job order, like with a single worker.
+//
+//==========================================================================
+
+std::unique_lock<std::mutex> HWDrawInfo::LockSharedState()
+{
+	if (isWorkerThread && numRenderWorkers > 1)
+	{
+		jobQueue.WaitForEarlierJobs(currentJob);
+		return std::unique_lock<std::mutex>(sharedStateMutex);
+	}
+	return std::unique_lock<std::mutex>();
+}
+
+static void MergeWorkerOutput(HWDrawInfo *di, int numworkers)
+{
+	unsigned next[MaxRenderWorkers] = {};
+	while (true)
+	{
+		// Every worker took its jobs in ascending order, so the next job overall is the first pending one of some worker.
+		int best = -1;
+		for (int w = 0; w < numworkers; w++)
+		{
+			auto &jobs = renderWorkers[w].jobs;
+			if (next[w] < jobs.Size() && (best < 0 || jobs[next[w]].job < renderWorkers[best].jobs[next[best]].job))
+			{
+				best = w;
+			}
+		}
+		if (best < 0) break;
+
+		auto &worker = renderWorkers[best];
+		unsigned index = next[best]++;
+		const auto &end = worker.jobs[index];
+		const auto *start = index > 0 ? &worker.jobs[index - 1] : nullptr;
+		for (int i = 0; i < GLDL_TYPES; i++)
+		{
+			di->drawlists[i].AppendItems(worker.drawlists[i], start ? start->drawitems[i] : 0, end.drawitems[i]);
+		}
+		for (int i = 0; i < 2; i++)
+		{
+			for (unsigned j = start ? start->decals[i] : 0; j < end.decals[i]; j++)
+			{
+				di->Decals[i].Push(worker.Decals[i][j]);
+			}
+		}
+	}
+
+	for (int w = 0; w < numworkers; w++)
+	{
+		renderWorkers[w].Clear();
+	}
+}
+
+void HWDrawInfo::WorkerThread(int index)
 {
 	sector_t *front, *back;
 
-	WTTotal.Clock();
+	// Only the first worker updates the profiling timers. They are not meant to be used by several threads at once.
+	bool timed = index == 0;
+
+	if (timed) WTTotal.Clock();
 	isWorkerThread = true;	// for adding asserts in GL API code. The worker thread may never call any GL API.
+	currentWorker = numRenderWorkers > 1 ? &renderWorkers[index] : nullptr;
 	while (true)
 	{
-		auto job = jobQueue.GetJob();
-		if (job == nullptr)
+		int jobindex = jobQueue.GetJob();
+		if (jobindex < 0)
 		{
+			if (jobQueue.IsFinished())
+			{
+				// Jobs added before the queue was closed must still be done.
+				jobindex = jobQueue.GetJob();
+				if (jobindex < 0) break;
+			}
+			else
+			{
 #ifdef ARCH_IA32
-			// The queue is empty. But yielding would be too costly here and possibly cause further delays down the line if the thread is halted.
-			// So instead add a few pause instructions and retry immediately.
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
+				// The queue is empty. But yielding would be too costly here and possibly cause further delays down the line if the thread is halted.
+				// So instead add a few pause instructions and retry immediately.
+				_mm_pause();
+				_mm_pause();
+				_mm_pause();
+				_mm_pause();
+				_mm_pause();
+				_mm_pause();
+				_mm_pause();
+				_mm_pause();
+				_mm_pause();
+				_mm_pause();
 #endif // ARCH_IA32
+				continue;
+			}
 		}
+
+		auto job = &jobQueue[jobindex];
+		currentJob = jobindex;
+
 		// Note that the main thread MUST have prepared the fake sectors that get used below!
 		// This worker thread cannot prepare them itself without costly synchronization.
-		else switch (job->type)
+		switch (job->type)
 		{
-		case RenderJob::TerminateJob:
-			WTTotal.Unclock();
-			return;
-
 		case RenderJob::WallJob:
 		{
 			GLWall wall;
-			SetupWall.Clock();
+			if (timed) SetupWall.Clock();
 			wall.sub = job->sub;
 
 			front = hw_FakeFlat(job->sub->sector, in_area, false);
@@ -155,47 +367,61 @@ void HWDrawInfo::WorkerThread()
 
 			wall.Process(this, job->seg, front, back);
 			rendered_lines++;
-			SetupWall.Unclock();
+			if (timed) SetupWall.Unclock();
 			break;
 		}
 
 		case RenderJob::FlatJob:
 		{
 			GLFlat flat;
-			SetupFlat.Clock();
+			if (timed) SetupFlat.Clock();
 			flat.section = job->sub->section;
 			front = hw_FakeFlat(job->sub->render_sector, in_area, false);
 			flat.ProcessSector(this, front);
-			SetupFlat.Unclock();
+			if (timed) SetupFlat.Unclock();
 			break;
 		}
 
 		case RenderJob::SpriteJob:
-			SetupSprite.Clock();
+		{
+			// Things are claimed through their validcount, so the first job that sees one has to get it.
+			// They may also get moved through portals while being processed.
+			auto lock = LockSharedState();
+			if (timed) SetupSprite.Clock();
 			front = hw_FakeFlat(job->sub->sector, in_area, false);
 			RenderThings(job->sub, front);
-			SetupSprite.Unclock();
+			if (timed) SetupSprite.Unclock();
 			break;
+		}
 
 		case RenderJob::ParticleJob:
-			SetupSprite.Clock();
+			if (timed) SetupSprite.Clock();
 			front = hw_FakeFlat(job->sub->sector, in_area, false);
 			RenderParticles(job->sub, front);
-			SetupSprite.Unclock();
+			if (timed) SetupSprite.Unclock();
 			break;
 
 		case RenderJob::PortalJob:
+		{
+			auto lock = LockSharedState();
 			AddSubsectorToPortal((FSectorPortalGroup *)job->seg, job->sub);
 			break;
 		}
+		}
 
+		if (currentWorker)
+		{
+			currentWorker->EndJob(jobindex);
+			jobQueue.FinishJob(jobindex);
+		}
 	}
+	currentWorker = nullptr;
+	if (timed) WTTotal.Unclock();
 }
 
 
 
 
-
 EXTERN_CVAR(Bool, gl_render_segs)
 
 CVAR(Bool, gl_render_things, true, 0)
@@ -208,6 +434,7 @@ void HWDrawInfo::UnclipSubsector(subsector_t *sub)
 	seg_t * seg = sub->firstline;
 	auto &clipper = *mClipper;
 
+	clipper.CalcClipAngles(sub);
 	while (count--)
 	{
 		angle_t startAngle = clipper.GetClipAngle(seg->v2);
@@ -451,6 +678,7 @@ void HWDrawInfo::AddLines(subsector_t * sub, sector_t * sector)
 		int count = sub->numlines;
 		seg_t * seg = sub->firstline;
 
+		mClipper->CalcClipAngles(sub);
 		while (count--)
 		{
 			if (seg->linedef == nullptr)
@@ -558,8 +786,7 @@ void HWDrawInfo::RenderThings(subsector_t * sub, sector_t * sector)
 
 void HWDrawInfo::RenderParticles(subsector_t *sub, sector_t *front)
 {
-	SetupSprite.Clock();
-	for (int i = Level->ParticlesInSubsec[sub->Index()]; i != NO_PARTICLE; i = Level->Particles[i].snext)
+	for (uint32_t i = Level->ParticlesInSubsec[sub->Index()]; i != NO_PARTICLE; i = Level->Particles[i].snext)
 	{
 		if (mClipPortal)
 		{
@@ -570,7 +797,6 @@ void HWDrawInfo::RenderParticles(subsector_t *sub, sector_t *front)
 		GLSprite sprite;
 		sprite.ProcessParticle(this, &Level->Particles[i], front);
 	}
-	SetupSprite.Unclock();
 }
 
 
@@ -809,17 +1035,28 @@ void HWDrawInfo::RenderBSP(void *node, bool drawpsprites)
 	multithread = gl_multithread;
 	if (multithread)
 	{
+		int numworkers = GetRenderWorkerCount();
+		if (renderPool.size() < numworkers) renderPool.resize(numworkers);
+
 		jobQueue.ReleaseAll();
-		auto future = renderPool.push([&](int id) {
-			WorkerThread();
-		});
+		numRenderWorkers = numworkers;
+		std::future<void> futures[MaxRenderWorkers];
+		for (int i = 0; i < numworkers; i++)
+		{
+			futures[i] = renderPool.push([this, i](int id) {
+				WorkerThread(i);
+			});
+		}
 		RenderBSPNode(node);
 
-		jobQueue.AddJob(RenderJob::TerminateJob, nullptr, nullptr);
+		jobQueue.Finish();
 		Bsp.Unclock();
 		MTWait.Clock();
-		future.wait();
+		for (int i = 0; i < numworkers; i++) futures[i].wait();
 		MTWait.Unclock();
+		numRenderWorkers = 0;
+
+		if (numworkers > 1) MergeWorkerOutput(this, numworkers);
 	}
 	else
 	{
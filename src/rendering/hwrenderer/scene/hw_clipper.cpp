@@ -38,6 +38,10 @@
 #include "hw_clipper.h"
 #include "g_levellocals.h"
 
+#ifndef NO_SSE
+#include <emmintrin.h>
+#endif
+
 unsigned Clipper::starttime;
 
 Clipper::Clipper()
@@ -47,77 +51,46 @@ Clipper::Clipper()
 
 //-----------------------------------------------------------------------------
 //
-// RemoveRange
+// Clear
 //
 //-----------------------------------------------------------------------------
 
-void Clipper::RemoveRange(ClipNode * range)
+void Clipper::Clear()
 {
-	if (range == cliphead)
-	{
-		cliphead = cliphead->next;
-	}
-	else
-	{
-		if (range->prev) range->prev->next = range->next;
-		if (range->next) range->next->prev = range->prev;
-	}
-	
-	Free(range);
+	blocked = false;
+	ranges.Clear();
+	silhouette.Clear();
+	starttime++;
 }
 
 //-----------------------------------------------------------------------------
 //
-// Clear
+// SetSilhouette
 //
 //-----------------------------------------------------------------------------
 
-void Clipper::Clear()
+void Clipper::SetSilhouette()
 {
-	ClipNode *node = cliphead;
-	ClipNode *temp;
-	
-	blocked = false;
-	while (node != NULL)
-	{
-		temp = node;
-		node = node->next;
-		Free(temp);
-	}
-	node = silhouette;
-
-	while (node != NULL)
-	{
-		temp = node;
-		node = node->next;
-		Free(temp);
-	}
-	
-	cliphead = NULL;
-	silhouette = NULL;
-	starttime++;
+	silhouette = ranges;
 }
 
 //-----------------------------------------------------------------------------
 //
-// SetSilhouette
+// Returns the index of the first range that does not end before the
+// given angle. The ranges do not overlap, so their ends are sorted, too.
 //
 //-----------------------------------------------------------------------------
 
-void Clipper::SetSilhouette()
+unsigned Clipper::FirstRangeNotBefore(angle_t angle) const
 {
-	ClipNode *node = cliphead;
-	ClipNode *last = NULL;
-
-	while (node != NULL)
+	unsigned lo = 0, hi = ranges.Size();
+	while (lo < hi)
 	{
-		ClipNode *snode = NewRange(node->start, node->end);
-		if (silhouette == NULL) silhouette = snode;
-		snode->prev = last;
-		if (last != NULL) last->next = snode;
-		last = snode;
-		node = node->next;
+		unsigned mid = (lo + hi) / 2;
+		if (ranges[mid].end < angle) lo = mid + 1;
+		else hi = mid;
 	}
+	return lo;
 }
 
 //-----------------------------------------------------------------------------
@@ -128,21 +101,11 @@ void Clipper::SetSilhouette()
 
 bool Clipper::IsRangeVisible(angle_t startAngle, angle_t endAngle)
 {
-	ClipNode *ci;
-	ci = cliphead;
-	
-	if (endAngle==0 && ci && ci->start==0) return false;
-	
-	while (ci != NULL && ci->start < endAngle)
-	{
-		if (startAngle >= ci->start && endAngle <= ci->end)
-		{
-			return false;
-		}
-		ci = ci->next;
-	}
-	
-	return true;
+	if (endAngle==0 && ranges.Size() > 0 && ranges[0].start==0) return false;
+
+	// Only the first range reaching endAngle can contain the entire range.
+	unsigned i = FirstRangeNotBefore(endAngle);
+	return i == ranges.Size() || ranges[i].start >= endAngle || ranges[i].start > startAngle;
 }
 
 //-----------------------------------------------------------------------------
@@ -153,100 +116,33 @@ bool Clipper::IsRangeVisible(angle_t startAngle, angle_t endAngle)
 
 void Clipper::AddClipRange(angle_t start, angle_t end)
 {
-	ClipNode *node, *temp, *prevNode;
+	unsigned count = ranges.Size();
+	unsigned i = FirstRangeNotBefore(start);
 
-	if (cliphead)
+	if (i == count || ranges[i].start > end)
 	{
-		//check to see if range contains any old ranges
-		node = cliphead;
-		while (node != NULL && node->start < end)
-		{
-			if (node->start >= start && node->end <= end)
-			{
-				temp = node;
-				node = node->next;
-				RemoveRange(temp);
-			}
-			else if (node->start<=start && node->end>=end)
-			{
-				return;
-			}
-			else
-			{
-				node = node->next;
-			}
-		}
-		
-		//check to see if range overlaps a range (or possibly 2)
-		node = cliphead;
-		while (node != NULL && node->start <= end)
-		{
-			if (node->end >= start)
-			{
-				// we found the first overlapping node
-				if (node->start > start)
-				{
-					// the new range overlaps with this node's start point
-					node->start = start;
-				}
-
-				if (node->end < end) 
-				{
-					node->end = end;
-				}
-
-				ClipNode *node2 = node->next;
-				while (node2 && node2->start <= node->end)
-				{
-					if (node2->end > node->end) node->end = node2->end;
-					ClipNode *delnode = node2;
-					node2 = node2->next;
-					RemoveRange(delnode);
-				}
-				return;
-			}
-			node = node->next;		
-		}
-		
-		//just add range
-		node = cliphead;
-		prevNode = NULL;
-		temp = NewRange(start, end);
-		
-		while (node != NULL && node->start < end)
-		{
-			prevNode = node;
-			node = node->next;
-		}
-		
-		temp->next = node;
-		if (node == NULL)
-		{
-			temp->prev = prevNode;
-			if (prevNode) prevNode->next = temp;
-			if (!cliphead) cliphead = temp;
-		}
-		else
-		{
-			if (node == cliphead)
-			{
-				cliphead->prev = temp;
-				cliphead = temp;
-			}
-			else
-			{
-				temp->prev = prevNode;
-				prevNode->next = temp;
-				node->prev = temp;
-			}
-		}
+		// Nothing overlaps, so just add the range
+		ranges.Insert(i, { start, end });
+		return;
 	}
-	else
+
+	ClipRange &range = ranges[i];
+	if (range.start <= start && range.end >= end)
 	{
-		temp = NewRange(start, end);
-		cliphead = temp;
 		return;
 	}
+
+	// Merge everything the new range overlaps or touches into the first one
+	if (range.start > start) range.start = start;
+	if (range.end < end) range.end = end;
+
+	unsigned next = i + 1;
+	while (next < count && ranges[next].start <= range.end)
+	{
+		if (ranges[next].end > range.end) range.end = ranges[next].end;
+		next++;
+	}
+	ranges.Delete(i + 1, next - i - 1);
 }
 
 
@@ -258,26 +154,25 @@ void Clipper::AddClipRange(angle_t start, angle_t end)
 
 void Clipper::RemoveClipRange(angle_t start, angle_t end)
 {
-	ClipNode *node;
-
-	if (silhouette)
+	if (silhouette.Size() > 0)
 	{
-		node = silhouette;
-		while (node != NULL && node->end <= start)
+		unsigned count = silhouette.Size();
+		unsigned i = 0;
+		while (i < count && silhouette[i].end <= start)
 		{
-			node = node->next;
+			i++;
 		}
-		if (node != NULL && node->start <= start)
+		if (i < count && silhouette[i].start <= start)
 		{
-			if (node->end >= end) return;
-			start = node->end;
-			node = node->next;
+			if (silhouette[i].end >= end) return;
+			start = silhouette[i].end;
+			i++;
 		}
-		while (node != NULL && node->start < end)
+		while (i < count && silhouette[i].start < end)
 		{
-			DoRemoveClipRange(start, node->start);
-			start = node->end;
-			node = node->next;
+			DoRemoveClipRange(start, silhouette[i].start);
+			start = silhouette[i].end;
+			i++;
 		}
 		if (start >= end) return;
 	}
@@ -292,50 +187,37 @@ void Clipper::RemoveClipRange(angle_t start, angle_t end)
 
 void Clipper::DoRemoveClipRange(angle_t start, angle_t end)
 {
-	ClipNode *node, *temp;
+	unsigned first = FirstRangeNotBefore(start);
 
-	if (cliphead)
+	// Delete the ranges that lie completely inside. Only the first range can start before it.
+	unsigned i = first;
+	if (i < ranges.Size() && ranges[i].start < start) i++;
+	unsigned last = i;
+	while (last < ranges.Size() && ranges[last].start < end && ranges[last].end <= end)
 	{
-		//check to see if range contains any old ranges
-		node = cliphead;
-		while (node != NULL && node->start < end)
+		last++;
+	}
+	ranges.Delete(i, last - i);
+
+	// Cut off the parts that overlap, or split the range that contains the removed one
+	for (i = first; i < ranges.Size(); i++)
+	{
+		ClipRange &range = ranges[i];
+		if (range.start >= start && range.start <= end)
 		{
-			if (node->start >= start && node->end <= end)
-			{
-				temp = node;
-				node = node->next;
-				RemoveRange(temp);
-			}
-			else
-			{
-				node = node->next;
-			}
+			range.start = end;
+			break;
 		}
-		
-		//check to see if range overlaps a range (or possibly 2)
-		node = cliphead;
-		while (node != NULL)
+		else if (range.end >= start && range.end <= end)
 		{
-			if (node->start >= start && node->start <= end)
-			{
-				node->start = end;
-				break;
-			}
-			else if (node->end >= start && node->end <= end)
-			{
-				node->end=start;
-			}
-			else if (node->start < start && node->end > end)
-			{
-				temp = NewRange(end, node->end);
-				node->end=start;
-				temp->next=node->next;
-				temp->prev=node;
-				node->next=temp;
-				if (temp->next) temp->next->prev=temp;
-				break;
-			}
-			node = node->next;
+			range.end = start;
+		}
+		else if (range.start < start && range.end > end)
+		{
+			ClipRange back = { end, range.end };
+			range.end = start;
+			ranges.Insert(i + 1, back);
+			break;
 		}
 	}
 }
@@ -395,6 +277,83 @@ angle_t Clipper::PointToPseudoAngle(double x, double y)
 
 
 
+//-----------------------------------------------------------------------------
+//
+// PointToPseudoAngle for two points at once. The results are exactly the
+// same, including the rounding of the fixed point conversion.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef NO_SSE
+static inline void PointsToPseudoAngles(__m128d x, __m128d y, __m128d viewx, __m128d viewy, angle_t *angles)
+{
+	const __m128d signmask = _mm_set1_pd(-0.);
+	const __m128d zero = _mm_setzero_pd();
+
+	__m128d vecx = _mm_sub_pd(x, viewx);
+	__m128d vecy = _mm_sub_pd(y, viewy);
+	__m128d length = _mm_add_pd(_mm_andnot_pd(signmask, vecx), _mm_andnot_pd(signmask, vecy));
+	__m128d result = _mm_div_pd(vecy, length);
+	__m128d left = _mm_cmplt_pd(vecx, zero);
+	result = _mm_or_pd(_mm_and_pd(left, _mm_sub_pd(_mm_set1_pd(2.), result)), _mm_andnot_pd(left, result));
+
+	// xs_Fix<30>::ToFix: the lower half of the mantissa after adding the magic number.
+	__m128i fixed = _mm_castpd_si128(_mm_add_pd(result, _mm_set1_pd(_xs_doublemagic / (1 << 30))));
+	fixed = _mm_andnot_si128(_mm_castpd_si128(_mm_cmpeq_pd(length, zero)), fixed);	// the view position itself is at angle 0
+	fixed = _mm_shuffle_epi32(fixed, _MM_SHUFFLE(3, 1, 2, 0));
+	_mm_storel_epi64((__m128i*)angles, fixed);
+}
+#endif
+
+//-----------------------------------------------------------------------------
+//
+// The segs of a subsector share most of their vertices, and the ones
+// that were not seen yet from this view get their angles calculated in
+// pairs.
+//
+//-----------------------------------------------------------------------------
+
+void Clipper::CalcClipAngles(subsector_t *sub)
+{
+	pendingVertices.Clear();
+
+	int count = sub->numlines;
+	seg_t * seg = sub->firstline;
+	while (count--)
+	{
+		for (vertex_t *v : { seg->v1, seg->v2 })
+		{
+			if (unsigned(v->angletime) != starttime)
+			{
+				v->angletime = starttime;
+				pendingVertices.Push(v);
+			}
+		}
+		seg++;
+	}
+
+	unsigned i = 0;
+#ifndef NO_SSE
+	__m128d viewx = _mm_set1_pd(viewpoint->Pos.X);
+	__m128d viewy = _mm_set1_pd(viewpoint->Pos.Y);
+	for (; i + 1 < pendingVertices.Size(); i += 2)
+	{
+		vertex_t *v1 = pendingVertices[i];
+		vertex_t *v2 = pendingVertices[i + 1];
+		angle_t angles[2];
+		PointsToPseudoAngles(_mm_set_pd(v2->p.X, v1->p.X), _mm_set_pd(v2->p.Y, v1->p.Y), viewx, viewy, angles);
+		v1->viewangle = angles[0];
+		v2->viewangle = angles[1];
+	}
+#endif
+	for (; i < pendingVertices.Size(); i++)
+	{
+		vertex_t *v = pendingVertices[i];
+		v->viewangle = PointToPseudoAngle(v->p.X, v->p.Y);
+	}
+}
+
+
 //-----------------------------------------------------------------------------
 //
 // R_CheckBBox
@@ -434,8 +393,16 @@ bool Clipper::CheckBox(const float *bspcoord)
 	if (boxpos == 5) return true;
 	
 	check = checkcoord[boxpos];
+#ifndef NO_SSE
+	angle_t angles[2];
+	PointsToPseudoAngles(_mm_set_pd(bspcoord[check[2]], bspcoord[check[0]]), _mm_set_pd(bspcoord[check[3]], bspcoord[check[1]]),
+		_mm_set1_pd(vp->Pos.X), _mm_set1_pd(vp->Pos.Y), angles);
+	angle1 = angles[0];
+	angle2 = angles[1];
+#else
 	angle1 = PointToPseudoAngle (bspcoord[check[0]], bspcoord[check[1]]);
 	angle2 = PointToPseudoAngle (bspcoord[check[2]], bspcoord[check[3]]);
+#endif
 	
 	return SafeCheckRange(angle2, angle1);
 }
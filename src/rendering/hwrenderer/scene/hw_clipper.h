@@ -4,37 +4,29 @@
 #include "doomtype.h"
 #include "xs_Float.h"
 #include "r_utility.h"
-#include "memarena.h"
+#include "tarray.h"
 
-class ClipNode
+struct ClipRange
 {
-	friend class Clipper;
-	
-	ClipNode *prev, *next;
 	angle_t start, end;
-
-	bool operator== (const ClipNode &other)
-	{
-		return other.start == start && other.end == end;
-	}
 };
 
 
+// The clipped ranges are kept sorted and disjoint in a flat array, so they
+// are searched with a binary search instead of walking a linked list.
 class Clipper
 {
 	static unsigned starttime;
-	FMemArena nodearena;
-	ClipNode * freelist = nullptr;
 
-	ClipNode * clipnodes = nullptr;
-	ClipNode * cliphead = nullptr;
-	ClipNode * silhouette = nullptr;	// will be preserved even when RemoveClipRange is called
+	TArray<ClipRange> ranges;
+	TArray<ClipRange> silhouette;	// will be preserved even when RemoveClipRange is called
+	TArray<vertex_t *> pendingVertices;
     const FRenderViewpoint *viewpoint = nullptr;
 	bool blocked = false;
 
 	static angle_t AngleToPseudo(angle_t ang);
+	unsigned FirstRangeNotBefore(angle_t angle) const;
 	bool IsRangeVisible(angle_t startangle, angle_t endangle);
-	void RemoveRange(ClipNode * cn);
 	void AddClipRange(angle_t startangle, angle_t endangle);
 	void RemoveClipRange(angle_t startangle, angle_t endangle);
 	void DoRemoveClipRange(angle_t start, angle_t end);
@@ -45,33 +37,6 @@ public:
 
 	void Clear();
 
-	void Free(ClipNode *node)
-	{
-		node->next = freelist;
-		freelist = node;
-	}
-
-	ClipNode * GetNew()
-	{
-		if (freelist)
-		{
-			ClipNode * p = freelist;
-			freelist = p->next;
-			return p;
-		}
-		else return (ClipNode*)nodearena.Alloc(sizeof(ClipNode));
-	}
-
-	ClipNode * NewRange(angle_t start, angle_t end)
-	{
-		ClipNode * c = GetNew();
-
-		c->start = start;
-		c->end = end;
-		c->next = c->prev = NULL;
-		return c;
-	}
-    
     void SetViewpoint(const FRenderViewpoint &vp)
     {
         viewpoint = &vp;
@@ -151,6 +116,9 @@ public:
 
 	bool CheckBox(const float *bspcoord);
 
+	// Calculates the clip angles of all vertices of a subsector's segs at once.
+	void CalcClipAngles(subsector_t *sub);
+
 	// Used to speed up angle calculations during clipping
 	inline angle_t GetClipAngle(vertex_t *v)
 	{
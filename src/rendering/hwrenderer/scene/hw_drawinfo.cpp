@@ -41,6 +41,7 @@
 #include "hwrenderer/data/hw_viewpointbuffer.h"
 #include "hwrenderer/data/flatvertices.h"
 #include "hwrenderer/dynlights/hw_lightbuffer.h"
+#include "hwrenderer/dynlights/hw_lightcache.h"
 #include "hwrenderer/utility/hw_vrmodes.h"
 #include "hw_clipper.h"
 
@@ -408,8 +409,8 @@ void HWViewpointUniforms::SetDefaults()
 
 GLDecal *HWDrawInfo::AddDecal(bool onmirror)
 {
-	auto decal = (GLDecal*)RenderDataAllocator.Alloc(sizeof(GLDecal));
-	Decals[onmirror ? 1 : 0].Push(decal);
+	auto decal = RenderDataAllocator()->AllocMemory<GLDecal>();
+	CurrentDecals()[onmirror ? 1 : 0].Push(decal);
 	return decal;
 }
 
@@ -430,6 +431,9 @@ void HWDrawInfo::CreateScene(bool drawpsprites)
 	// reset the portal manager
 	screen->mPortalState->StartFrame();
 
+	// find the lights that changed since the last scene
+	if (Level->HasDynamicLights) sectionLightCache.BeginScene(Level, screen->mLights);
+
 	ProcessAll.Clock();
 
 	// clip the scene and fill the drawlists
@@ -446,6 +450,7 @@ void HWDrawInfo::CreateScene(bool drawpsprites)
 	HandleHackedSubsectors();	// open sector hacks for deep water
 	PrepareUnhandledMissingTextures();
 	DispatchRenderHacks();
+	screen->mVertexData->FlushPlaneUpdates();
 	screen->mLights->Unmap();
 	screen->mVertexData->Unmap();
 
@@ -670,7 +675,7 @@ void HWDrawInfo::AddSubsectorToPortal(FSectorPortalGroup *ptg, subsector_t *sub)
 	auto portal = FindPortal(ptg);
 	if (!portal)
 	{
-        portal = new HWSectorStackPortal(screen->mPortalState, ptg);
+        portal = RenderDataAllocator()->NewObject<HWSectorStackPortal>(screen->mPortalState, ptg);
 		Portals.Push(portal);
 	}
     auto ptl = static_cast<HWSectorStackPortal*>(portal);
@@ -2,6 +2,7 @@
 
 #include <atomic>
 #include <functional>
+#include <mutex>
 #include "vectors.h"
 #include "r_defs.h"
 #include "r_utility.h"
@@ -190,7 +191,7 @@ private:
 	subsector_t *currentsubsector;	// used by the line processing code.
 	sector_t *currentsector;
 
-	void WorkerThread();
+	void WorkerThread(int index);
 
 	void UnclipSubsector(subsector_t *sub);
 	
@@ -305,6 +306,11 @@ public:
 	void ProcessLowerMinisegs(TArray<seg_t *> &lowersegs);
     void AddSubsectorToPortal(FSectorPortalGroup *portal, subsector_t *sub);
     
+	// With several BSP workers each of them collects its draw items separately.
+	HWDrawList *CurrentDrawLists();
+	TArray<GLDecal *> *CurrentDecals();
+	std::unique_lock<std::mutex> LockSharedState();
+
     void AddWall(GLWall *w);
     void AddMirrorSurface(GLWall *w);
 	void AddFlat(GLFlat *flat, bool fog);
@@ -38,11 +38,11 @@
 #include "hw_drawinfo.h"
 #include "hw_fakeflat.h"
 
-FMemArena RenderDataAllocator(1024*1024);	// Use large blocks to reduce allocation time.
+CVAR(Bool, gl_sort_radix, true, 0)
 
 void ResetRenderDataAllocator()
 {
-	RenderDataAllocator.FreeAll();
+	RenderMemory::ClearThreadArenas();
 }
 
 //==========================================================================
@@ -585,12 +585,104 @@ inline int HWDrawList::CompareSprites(SortNode * a,SortNode * b)
 	GLSprite * s1= sprites[drawitems[a->itemindex].index];
 	GLSprite * s2= sprites[drawitems[b->itemindex].index];
 
-	int res = s1->depth - s2->depth;
-
-	if (res != 0) return -res;
+	// Depths are fixed point, so their difference can overflow for sprites far apart.
+	if (s1->depth != s2->depth) return s1->depth > s2->depth ? -1 : 1;
 	else return reverseSort? s2->index-s1->index : s1->index-s2->index;
 }
 
+//==========================================================================
+//
+// The order of CompareSprites as a single integer
+//
+//==========================================================================
+
+inline uint64_t HWDrawList::SpriteSortKey(SortNode * node)
+{
+	GLSprite * s = sprites[drawitems[node->itemindex].index];
+
+	uint32_t depth = ~((uint32_t)s->depth ^ 0x80000000);	// decreasing depth
+	uint32_t index = (uint32_t)s->index ^ 0x80000000;
+	if (reverseSort) index = ~index;
+	return ((uint64_t)depth << 32) | index;
+}
+
+//==========================================================================
+//
+// Stable sort of a run of sprites. Longer runs get their keys radix
+// sorted, which is linear and doesn't need to look at the sprites again
+// for every comparison.
+//
+//==========================================================================
+
+void HWDrawList::SortSprites(TArray<SortNode*> &list)
+{
+	enum { RadixSortThreshold = 64 };	// Below this the comparison sort is faster
+
+	unsigned count = list.Size();
+	if (!gl_sort_radix || count < RadixSortThreshold)
+	{
+		std::stable_sort(list.begin(), list.end(), [=](SortNode *a, SortNode *b)
+		{
+			return CompareSprites(a, b) < 0;
+		});
+		return;
+	}
+
+	static TArray<uint64_t> keys, tempkeys;
+	static TArray<SortNode*> tempnodes;
+	keys.Resize(count);
+	tempkeys.Resize(count);
+	tempnodes.Resize(count);
+
+	// All eight digit histograms are gathered in a single pass over the keys.
+	unsigned offsets[8][256] = {};
+	for (unsigned i = 0; i < count; i++)
+	{
+		uint64_t key = SpriteSortKey(list[i]);
+		keys[i] = key;
+		for (int digit = 0; digit < 8; digit++)
+		{
+			offsets[digit][(key >> (digit * 8)) & 0xff]++;
+		}
+	}
+
+	uint64_t *srckeys = &keys[0];
+	uint64_t *dstkeys = &tempkeys[0];
+	SortNode **src = &list[0];
+	SortNode **dst = &tempnodes[0];
+	for (int digit = 0; digit < 8; digit++)
+	{
+		int shift = digit * 8;
+		unsigned *offset = offsets[digit];
+
+		// Skip the pass if every key has the same digit. Sprites close to each other share the upper depth bits.
+		if (offset[(srckeys[0] >> shift) & 0xff] == count)
+			continue;
+
+		unsigned pos = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			unsigned n = offset[i];
+			offset[i] = pos;
+			pos += n;
+		}
+
+		for (unsigned i = 0; i < count; i++)
+		{
+			unsigned dstindex = offset[(srckeys[i] >> shift) & 0xff]++;
+			dstkeys[dstindex] = srckeys[i];
+			dst[dstindex] = src[i];
+		}
+		std::swap(srckeys, dstkeys);
+		std::swap(src, dst);
+	}
+
+	if (src != &list[0])
+	{
+		memcpy(&list[0], src, count * sizeof(SortNode*));
+	}
+}
+
 //==========================================================================
 //
 //
@@ -608,10 +700,7 @@ SortNode * HWDrawList::SortSpriteList(SortNode * head)
 
 	sortspritelist.Clear();
 	for(count=0,n=head;n;n=n->next) sortspritelist.Push(n);
-	std::stable_sort(sortspritelist.begin(), sortspritelist.end(), [=](SortNode *a, SortNode *b)
-	{
-		return CompareSprites(a, b) < 0;
-	});
+	SortSprites(sortspritelist);
 
 	for(i=0;i<sortspritelist.Size();i++)
 	{
@@ -705,7 +794,15 @@ void HWDrawList::Sort(HWDrawInfo *di)
 	reverseSort = !!(di->Level->i_compatflags & COMPATF_SPRITESORT);
     SortZ = di->Viewpoint.Pos.Z;
 	MakeSortList();
-	sorted = DoSort(di, SortNodes[SortNodeStart]);
+	if (gl_sort_radix && sprites.Size() == drawitems.Size())
+	{
+		// Without walls and flats there is nothing to split against.
+		sorted = SortSpriteList(SortNodes[SortNodeStart]);
+	}
+	else
+	{
+		sorted = DoSort(di, SortNodes[SortNodeStart]);
+	}
 }
 
 //==========================================================================
@@ -752,7 +849,7 @@ void HWDrawList::SortFlats()
 
 GLWall *HWDrawList::NewWall()
 {
-	auto wall = (GLWall*)RenderDataAllocator.Alloc(sizeof(GLWall));
+	auto wall = RenderDataAllocator()->AllocMemory<GLWall>();
 	drawitems.Push(GLDrawItem(GLDIT_WALL, walls.Push(wall)));
 	return wall;
 }
@@ -764,7 +861,7 @@ GLWall *HWDrawList::NewWall()
 //==========================================================================
 GLFlat *HWDrawList::NewFlat()
 {
-	auto flat = (GLFlat*)RenderDataAllocator.Alloc(sizeof(GLFlat));
+	auto flat = RenderDataAllocator()->AllocMemory<GLFlat>();
 	drawitems.Push(GLDrawItem(GLDIT_FLAT,flats.Push(flat)));
 	return flat;
 }
@@ -776,11 +873,38 @@ GLFlat *HWDrawList::NewFlat()
 //==========================================================================
 GLSprite *HWDrawList::NewSprite()
 {	
-	auto sprite = (GLSprite*)RenderDataAllocator.Alloc(sizeof(GLSprite));
+	auto sprite = RenderDataAllocator()->AllocMemory<GLSprite>();
 	drawitems.Push(GLDrawItem(GLDIT_SPRITE, sprites.Push(sprite)));
 	return sprite;
 }
 
+//==========================================================================
+//
+// Appends a range of another list's items, keeping their order
+//
+//==========================================================================
+void HWDrawList::AppendItems(const HWDrawList &other, unsigned start, unsigned end)
+{
+	for (unsigned i = start; i < end; i++)
+	{
+		const GLDrawItem &item = other.drawitems[i];
+		switch (item.rendertype)
+		{
+		case GLDIT_WALL:
+			drawitems.Push(GLDrawItem(GLDIT_WALL, walls.Push(other.walls[item.index])));
+			break;
+
+		case GLDIT_FLAT:
+			drawitems.Push(GLDrawItem(GLDIT_FLAT, flats.Push(other.flats[item.index])));
+			break;
+
+		case GLDIT_SPRITE:
+			drawitems.Push(GLDrawItem(GLDIT_SPRITE, sprites.Push(other.sprites[item.index])));
+			break;
+		}
+	}
+}
+
 //==========================================================================
 //
 //
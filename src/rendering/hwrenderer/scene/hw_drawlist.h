@@ -1,8 +1,9 @@
 #pragma once
 
-#include "memarena.h"
+#include "swrenderer/r_memory.h"
 
-extern FMemArena RenderDataAllocator;
+// Per-frame render data comes from the frame arena of the thread that creates it.
+inline RenderMemory *RenderDataAllocator() { return RenderMemory::ThreadArena(); }
 void ResetRenderDataAllocator();
 struct HWDrawInfo;
 class GLWall;
@@ -90,6 +91,7 @@ public:
 	GLWall *NewWall();
 	GLFlat *NewFlat();
 	GLSprite *NewSprite();
+	void AppendItems(const HWDrawList &other, unsigned start, unsigned end);
 	void Reset();
 	void SortWalls();
 	void SortFlats();
@@ -104,6 +106,8 @@ public:
 	void SortWallIntoWall(HWDrawInfo *di, SortNode * head,SortNode * sort);
 	void SortSpriteIntoWall(HWDrawInfo *di, SortNode * head,SortNode * sort);
 	int CompareSprites(SortNode * a,SortNode * b);
+	uint64_t SpriteSortKey(SortNode * node);
+	void SortSprites(TArray<SortNode*> &list);
 	SortNode * SortSpriteList(SortNode * head);
 	SortNode * DoSort(HWDrawInfo *di, SortNode * head);
 	void Sort(HWDrawInfo *di);
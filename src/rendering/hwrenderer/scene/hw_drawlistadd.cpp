@@ -37,6 +37,7 @@ EXTERN_CVAR(Bool, gl_seamless)
 
 void HWDrawInfo::AddWall(GLWall *wall)
 {
+	auto drawlists = CurrentDrawLists();
 	if (wall->flags & GLWall::GLWF_TRANSLUCENT)
 	{
 		auto newwall = drawlists[GLDL_TRANSLUCENT].NewWall();
@@ -69,7 +70,7 @@ void HWDrawInfo::AddWall(GLWall *wall)
 void HWDrawInfo::AddMirrorSurface(GLWall *w)
 {
 	w->type = RENDERWALL_MIRRORSURFACE;
-	auto newwall = drawlists[GLDL_TRANSLUCENTBORDER].NewWall();
+	auto newwall = CurrentDrawLists()[GLDL_TRANSLUCENTBORDER].NewWall();
 	*newwall = *w;
 
 	// Invalidate vertices to allow setting of texture coordinates
@@ -121,7 +122,7 @@ void HWDrawInfo::AddFlat(GLFlat *flat, bool fog)
 		bool masked = flat->gltexture->isMasked() && ((flat->renderflags&SSRF_RENDER3DPLANES) || flat->stack);
 		list = masked ? GLDL_MASKEDFLATS : GLDL_PLAINFLATS;
 	}
-	auto newflat = drawlists[list].NewFlat();
+	auto newflat = CurrentDrawLists()[list].NewFlat();
 	*newflat = *flat;
 }
 
@@ -144,7 +145,7 @@ void HWDrawInfo::AddSprite(GLSprite *sprite, bool translucent)
 		list = GLDL_MODELS;
 	}
 
-	auto newsprt = drawlists[list].NewSprite();
+	auto newsprt = CurrentDrawLists()[list].NewSprite();
 	*newsprt = *sprite;
 }
 
@@ -43,6 +43,7 @@
 #include "hwrenderer/scene/hw_drawinfo.h"
 #include "hwrenderer/data/flatvertices.h"
 #include "hwrenderer/dynlights/hw_lightbuffer.h"
+#include "hwrenderer/dynlights/hw_lightcache.h"
 #include "hw_drawstructs.h"
 #include "hw_renderstate.h"
 
@@ -140,12 +141,24 @@ void GLFlat::SetupLights(HWDrawInfo *di, FLightNode * node, FDynLightData &light
 {
 	Plane p;
 
-	lightdata.Clear();
 	if (renderstyle == STYLE_Add && !di->Level->lightadditivesurfaces)
 	{
 		dynlightindex = -1;
 		return;	// no lights on additively blended surfaces.
 	}
+
+	// The list only depends on the plane and the lights touching the section so it can be kept as long as neither changes.
+	auto cached = sectionLightCache.Lock(section, ceiling);
+	if (cached != nullptr && cached->IsValid(node, plane.plane, portalgroup))
+	{
+		dynlightindex = sectionLightCache.Upload(cached, screen->mLights, false);
+		sectionLightCache.Unlock(cached);
+		return;
+	}
+
+	FDynLightData &data = cached != nullptr ? cached->data : lightdata;
+	data.Clear();
+	if (cached != nullptr) cached->Store(node, plane.plane, portalgroup);
 	while (node)
 	{
 		FDynamicLight * light = node->lightsource;
@@ -167,11 +180,20 @@ void GLFlat::SetupLights(HWDrawInfo *di, FLightNode * node, FDynLightData &light
 		}
 
 		p.Set(plane.plane.Normal(), plane.plane.fD());
-		draw_dlightf += lightdata.GetLight(portalgroup, p, light, false);
+		draw_dlightf += data.GetLight(portalgroup, p, light, false);
 		node = node->nextLight;
 	}
 
-	dynlightindex = screen->mLights->UploadLights(lightdata);
+	if (cached != nullptr)
+	{
+		dynlightindex = sectionLightCache.Upload(cached, screen->mLights, true);
+		sectionLightCache.Unlock(cached);
+	}
+	else
+	{
+		FSectionLightCache::CountUncached();
+		dynlightindex = screen->mLights->UploadLights(data);
+	}
 }
 
 //==========================================================================
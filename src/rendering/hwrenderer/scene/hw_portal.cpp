@@ -97,7 +97,7 @@ void FPortalSceneState::EndFrame(HWDrawInfo *di, FRenderState &state)
 		{
 			RenderPortal(p, state, true, di);
 		}
-		delete p;
+		p->~HWPortal();	// the memory belongs to the frame arena
 	}
 	renderdepth--;
 
@@ -155,7 +155,7 @@ bool FPortalSceneState::RenderFirstSkyPortal(int recursion, HWDrawInfo *outer_di
 	{
 		portals.Delete(bestindex);
 		RenderPortal(best, state, false, outer_di);
-		delete best;
+		best->~HWPortal();
 		return true;
 	}
 	return false;
@@ -90,12 +90,12 @@ void HWDrawInfo::DispatchRenderHacks()
 
 static gl_subsectorrendernode *NewSubsectorRenderNode()
 {
-    return (gl_subsectorrendernode*)RenderDataAllocator.Alloc(sizeof(gl_subsectorrendernode));
+    return RenderDataAllocator()->AllocMemory<gl_subsectorrendernode>();
 }
 
 static gl_floodrendernode *NewFloodRenderNode()
 {
-    return (gl_floodrendernode*)RenderDataAllocator.Alloc(sizeof(gl_floodrendernode));
+    return RenderDataAllocator()->AllocMemory<gl_floodrendernode>();
 }
 
 //==========================================================================
@@ -194,6 +194,8 @@ void HWDrawInfo::AddUpperMissingTexture(side_t * side, subsector_t *sub, float B
 {
 	if (!side->segs[0]->backsector) return;
 
+	auto lock = LockSharedState();
+
 	for (int i = 0; i < side->numsegs; i++)
 	{
 		seg_t *seg = side->segs[i];
@@ -246,6 +248,9 @@ void HWDrawInfo::AddLowerMissingTexture(side_t * side, subsector_t *sub, float B
 {
 	sector_t *backsec = side->segs[0]->backsector;
 	if (!backsec) return;
+
+	auto lock = LockSharedState();
+
 	if (backsec->transdoor)
 	{
 		// Transparent door hacks alter the backsector's floor height so we should not
@@ -489,6 +489,7 @@ void GLWall::PutPortal(HWDrawInfo *di, int ptype, int plane)
 {
 	auto pstate = screen->mPortalState;
 	HWPortal * portal = nullptr;
+	auto lock = di->LockSharedState();
 
 	MakeVertices(di, false);
 	switch (ptype)
@@ -500,7 +501,7 @@ void GLWall::PutPortal(HWDrawInfo *di, int ptype, int plane)
 		portal = di->FindPortal(horizon);
 		if (!portal)
 		{
-			portal = new HWHorizonPortal(pstate, horizon, di->Viewpoint);
+			portal = RenderDataAllocator()->NewObject<HWHorizonPortal>(pstate, horizon, di->Viewpoint);
 			di->Portals.Push(portal);
 		}
 		portal->AddLine(this);
@@ -511,10 +512,10 @@ void GLWall::PutPortal(HWDrawInfo *di, int ptype, int plane)
 		if (!portal)
 		{
 			// either a regular skybox or an Eternity-style horizon
-			if (secportal->mType != PORTS_SKYVIEWPOINT) portal = new HWEEHorizonPortal(pstate, secportal);
+			if (secportal->mType != PORTS_SKYVIEWPOINT) portal = RenderDataAllocator()->NewObject<HWEEHorizonPortal>(pstate, secportal);
 			else
 			{
-				portal = new HWSkyboxPortal(pstate, secportal);
+				portal = RenderDataAllocator()->NewObject<HWSkyboxPortal>(pstate, secportal);
 				di->Portals.Push(portal);
 			}
 		}
@@ -525,7 +526,7 @@ void GLWall::PutPortal(HWDrawInfo *di, int ptype, int plane)
 		portal = di->FindPortal(this->portal);
 		if (!portal)
 		{
-			portal = new HWSectorStackPortal(pstate, this->portal);
+			portal = RenderDataAllocator()->NewObject<HWSectorStackPortal>(pstate, this->portal);
 			di->Portals.Push(portal);
 		}
 		portal->AddLine(this);
@@ -538,7 +539,7 @@ void GLWall::PutPortal(HWDrawInfo *di, int ptype, int plane)
 			portal = di->FindPortal(planemirror);
 			if (!portal)
 			{
-				portal = new HWPlaneMirrorPortal(pstate, planemirror);
+				portal = RenderDataAllocator()->NewObject<HWPlaneMirrorPortal>(pstate, planemirror);
 				di->Portals.Push(portal);
 			}
 			portal->AddLine(this);
@@ -549,7 +550,7 @@ void GLWall::PutPortal(HWDrawInfo *di, int ptype, int plane)
 		portal = di->FindPortal(seg->linedef);
 		if (!portal)
 		{
-			portal = new HWMirrorPortal(pstate, seg->linedef);
+			portal = RenderDataAllocator()->NewObject<HWMirrorPortal>(pstate, seg->linedef);
 			di->Portals.Push(portal);
 		}
 		portal->AddLine(this);
@@ -571,7 +572,7 @@ void GLWall::PutPortal(HWDrawInfo *di, int ptype, int plane)
 			{
 				di->ProcessActorsInPortal(otherside->getPortal()->mGroup, di->in_area);
 			}
-			portal = new HWLineToLinePortal(pstate, lineportal);
+			portal = RenderDataAllocator()->NewObject<HWLineToLinePortal>(pstate, lineportal);
 			di->Portals.Push(portal);
 		}
 		portal->AddLine(this);
@@ -582,7 +583,7 @@ void GLWall::PutPortal(HWDrawInfo *di, int ptype, int plane)
 		portal = di->FindPortal(sky);
 		if (!portal)
 		{
-			portal = new HWSkyPortal(screen->mSkyData, pstate, sky);
+			portal = RenderDataAllocator()->NewObject<HWSkyPortal>(screen->mSkyData, pstate, sky);
 			di->Portals.Push(portal);
 		}
 		portal->AddLine(this);
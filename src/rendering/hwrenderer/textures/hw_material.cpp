@@ -28,9 +28,12 @@
 #include "c_dispatch.h"
 #include "hw_ihwtexture.h"
 #include "hw_material.h"
+#include <mutex>
 
 EXTERN_CVAR(Bool, gl_texture_usehires)
 
+static std::mutex MaterialMutex;
+
 //===========================================================================
 // 
 //	Quick'n dirty image rescaling.
@@ -466,6 +469,11 @@ again:
 		FMaterial *hwtex = tex->Material[expand];
 		if (hwtex == NULL && create)
 		{
+			// The hardware renderer's BSP workers may all ask for a new material at the same time.
+			std::lock_guard<std::mutex> lock(MaterialMutex);
+			hwtex = tex->Material[expand];
+			if (hwtex != NULL) return hwtex;
+
 			if (expand)
 			{
 				if (tex->isWarped() || tex->isHardwareCanvas() || tex->shaderindex >= FIRST_USER_SHADER || (tex->shaderindex >= SHADER_Specular && tex->shaderindex <= SHADER_PBRBrightmap))
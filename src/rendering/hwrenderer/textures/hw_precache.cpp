@@ -212,6 +212,7 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 				}
 			}
 		}
+		FImageSource::StartAsyncDecoding();
 
 		// cache all used textures
 		for (int i = cnt - 1; i >= 0; i--)
@@ -4,6 +4,7 @@
 #include "stats.h"
 #include "x86.h"
 #include "m_fixed.h"
+#include <atomic>
 
 extern glcycle_t RenderWall,SetupWall,ClipWall;
 extern glcycle_t RenderFlat,SetupFlat;
@@ -15,8 +16,10 @@ extern glcycle_t Dirty;
 extern glcycle_t drawcalls, twoD, Flush3D;
 extern glcycle_t MTWait, WTTotal;
 
-extern int iter_dlightf, iter_dlight, draw_dlight, draw_dlightf;
-extern int rendered_lines,rendered_flats,rendered_sprites,rendered_decals,render_vertexsplit,render_texsplit;
+// Counters that the BSP worker threads update
+extern std::atomic<int> iter_dlightf, iter_dlight, draw_dlight, draw_dlightf;
+extern std::atomic<int> rendered_lines,rendered_flats,rendered_sprites,rendered_decals,render_texsplit;
+extern int render_vertexsplit;
 extern int rendered_portals;
 
 extern int vertexcount, flatvertices, flatprimitives;
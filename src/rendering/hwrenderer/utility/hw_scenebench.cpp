@@ -0,0 +1,359 @@
+/*
+**
+**  Hardware renderer scene setup benchmark
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 agent
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** hwscenebench [maxworkers [repeat]]
+**
+** Runs the hardware renderer's scene setup (BSP traversal and the wall,
+** flat and sprite processing that fills the draw lists) for the current
+** view, first single threaded and then with 1 to maxworkers BSP workers.
+** Nothing gets drawn, so this only needs the renderer's buffers and
+** works in -headless mode without a GPU context. Each worker count prints
+** its average time and a hash of the draw lists, which must be the same
+** for all of them.
+**
+** hwsortbench [repeat]
+**
+** Captures the translucent draw list of the current view and sorts copies
+** of it, first with the comparison sort for sprites and then with the
+** radix sort. Each prints its average time and a hash of the items in
+** drawing order, which must be the same for both.
+**
+*/
+
+#include "templates.h"
+#include "c_dispatch.h"
+#include "c_cvars.h"
+#include "d_player.h"
+#include "doomstat.h"
+#include "g_game.h"
+#include "g_levellocals.h"
+#include "m_crc32.h"
+#include "r_utility.h"
+#include "v_video.h"
+#include "hwrenderer/data/flatvertices.h"
+#include "hwrenderer/dynlights/hw_lightbuffer.h"
+#include "hwrenderer/scene/hw_drawinfo.h"
+#include "hwrenderer/scene/hw_drawstructs.h"
+#include "hwrenderer/scene/hw_fakeflat.h"
+#include "hwrenderer/scene/hw_portal.h"
+
+EXTERN_CVAR(Bool, gl_multithread)
+EXTERN_CVAR(Int, gl_multithread_workers)
+EXTERN_CVAR(Bool, gl_sort_radix)
+
+//-----------------------------------------------------------------------------
+//
+// Only values that do not depend on the order in which the workers ran
+// go into the hash. Vertex and light buffer offsets do.
+//
+//-----------------------------------------------------------------------------
+
+static void HashItem(const HWDrawList &list, const GLDrawItem &item, uint32_t &hash)
+{
+	auto add = [&](const void *data, size_t size)
+	{
+		hash = AddCRC32(hash, (const uint8_t *)data, (unsigned)size);
+	};
+
+	add(&item.rendertype, sizeof(item.rendertype));
+	switch (item.rendertype)
+	{
+	case GLDIT_WALL:
+	{
+		GLWall *wall = list.walls[item.index];
+		add(&wall->seg, sizeof(wall->seg));
+		add(&wall->type, sizeof(wall->type));
+		add(wall->ztop, sizeof(wall->ztop));
+		add(wall->zbottom, sizeof(wall->zbottom));
+		break;
+	}
+
+	case GLDIT_FLAT:
+	{
+		GLFlat *flat = list.flats[item.index];
+		add(&flat->section, sizeof(flat->section));
+		add(&flat->ceiling, sizeof(flat->ceiling));
+		add(&flat->z, sizeof(flat->z));
+		break;
+	}
+
+	case GLDIT_SPRITE:
+	{
+		GLSprite *sprite = list.sprites[item.index];
+		add(&sprite->actor, sizeof(sprite->actor));
+		add(&sprite->particle, sizeof(sprite->particle));
+		add(&sprite->x, sizeof(sprite->x));
+		add(&sprite->y, sizeof(sprite->y));
+		add(&sprite->z, sizeof(sprite->z));
+		break;
+	}
+	}
+}
+
+static uint32_t HashDrawLists(HWDrawInfo *di)
+{
+	uint32_t hash = 0;
+	for (auto &list : di->drawlists)
+	{
+		for (auto &item : list.drawitems)
+		{
+			HashItem(list, item, hash);
+		}
+	}
+	for (auto &decals : di->Decals)
+	{
+		for (auto decal : decals)
+		{
+			hash = AddCRC32(hash, (const uint8_t *)&decal->decal, sizeof(decal->decal));
+		}
+	}
+	return hash;
+}
+
+//-----------------------------------------------------------------------------
+//
+// Sets up the main view the way the renderers do, minus everything that
+// would need the GPU.
+//
+//-----------------------------------------------------------------------------
+
+static HWDrawInfo *BeginScene(AActor *camera)
+{
+	hw_ClearFakeFlat();
+	screen->mVertexData->Reset();
+	screen->mLights->Clear();
+
+	R_SetupFrame(r_viewpoint, r_viewwindow, camera);
+
+	auto di = HWDrawInfo::StartDrawInfo(r_viewpoint.ViewLevel, nullptr, r_viewpoint, nullptr);
+	auto &vp = di->Viewpoint;
+	di->SetViewArea();
+	di->SetFullbrightFlags(camera->player);
+	vp.FieldOfView = r_viewpoint.FieldOfView;
+	vp.SetViewAngle(r_viewwindow);
+	di->SetViewMatrix(vp.HWAngles, vp.Pos.X, vp.Pos.Y, vp.Pos.Z, false, false);
+	di->SetCameraPos(vp.Pos);
+	di->VPUniforms.CalcDependencies();
+
+	screen->mPortalState->BeginScene();
+	di->UpdateCurrentMapSection();
+	return di;
+}
+
+static void EndScene(HWDrawInfo *di)
+{
+	// The portals are not rendered, so they have to be discarded the way FPortalSceneState::EndFrame would.
+	HWPortal *p;
+	while (di->Portals.Pop(p))
+	{
+		if (p) p->~HWPortal();
+	}
+	screen->mPortalState->renderdepth--;
+
+	di->EndDrawInfo();
+}
+
+//-----------------------------------------------------------------------------
+//
+// Times the creation of the main view's draw lists.
+//
+//-----------------------------------------------------------------------------
+
+static double RunSceneSetup(AActor *camera, uint32_t &hash)
+{
+	auto di = BeginScene(camera);
+
+	cycle_t setup;
+	setup.Reset();
+	setup.Clock();
+	di->CreateScene(false);
+	setup.Unclock();
+
+	hash = HashDrawLists(di);
+	EndScene(di);
+	return setup.TimeMS();
+}
+
+static bool CanRunBenchmark(const char *name)
+{
+	if (gamestate != GS_LEVEL || players[consoleplayer].camera == nullptr)
+	{
+		Printf("%s needs a level to be loaded.\n", name);
+		return false;
+	}
+	if (screen->mVertexData == nullptr || screen->mLights == nullptr)
+	{
+		Printf("The current video backend has no hardware renderer buffers.\n");
+		return false;
+	}
+	return true;
+}
+
+CCMD(hwscenebench)
+{
+	if (!CanRunBenchmark("hwscenebench")) return;
+
+	int maxworkers = argv.argc() > 1 ? clamp(atoi(argv[1]), 1, 16) : 4;
+	int repeat = argv.argc() > 2 ? MAX(atoi(argv[2]), 1) : 20;
+
+	AActor *camera = players[consoleplayer].camera;
+	bool savedMultithread = gl_multithread;
+	int savedWorkers = gl_multithread_workers;
+	bool savedNoInterpolate = r_NoInterpolate;
+	r_NoInterpolate = true;
+
+	uint32_t reference = 0;
+	for (int workers = 0; workers <= maxworkers; workers++)
+	{
+		// 0 is the single threaded path without any workers.
+		gl_multithread = workers > 0;
+		gl_multithread_workers = MAX(workers, 1);
+
+		uint32_t hash = 0;
+		RunSceneSetup(camera, hash);	// warm up the material and sprite caches
+
+		double total = 0;
+		bool stable = true;
+		for (int i = 0; i < repeat; i++)
+		{
+			uint32_t passhash;
+			total += RunSceneSetup(camera, passhash);
+			if (passhash != hash) stable = false;
+		}
+		if (workers == 0) reference = hash;
+
+		FString name = workers == 0 ? FString("single threaded") : FStringf("%d %s", workers, workers == 1 ? "worker" : "workers");
+		Printf("%-16s %7.3f ms  hash=%08x%s%s\n", name.GetChars(), total / repeat, hash,
+			hash != reference ? "  (differs from single threaded)" : "", stable ? "" : "  (not stable between passes)");
+	}
+
+	gl_multithread = savedMultithread;
+	gl_multithread_workers = savedWorkers;
+	r_NoInterpolate = savedNoInterpolate;
+}
+
+//-----------------------------------------------------------------------------
+//
+// Sorting splits walls and sprites, so every pass sorts fresh copies of
+// the captured items.
+//
+//-----------------------------------------------------------------------------
+
+static void CopyItems(HWDrawList &dest, const HWDrawList &src)
+{
+	for (auto &item : src.drawitems)
+	{
+		switch (item.rendertype)
+		{
+		case GLDIT_WALL:
+			*dest.NewWall() = *src.walls[item.index];
+			break;
+
+		case GLDIT_FLAT:
+			*dest.NewFlat() = *src.flats[item.index];
+			break;
+
+		case GLDIT_SPRITE:
+			*dest.NewSprite() = *src.sprites[item.index];
+			break;
+		}
+	}
+}
+
+// Same traversal as HWDrawList::DrawSorted
+static void HashSortedItems(const HWDrawList &list, SortNode *head, uint32_t &hash)
+{
+	if (head->left) HashSortedItems(list, head->left, hash);
+	for (SortNode *node = head; node; node = node->equal)
+	{
+		HashItem(list, list.drawitems[node->itemindex], hash);
+	}
+	if (head->right) HashSortedItems(list, head->right, hash);
+}
+
+CCMD(hwsortbench)
+{
+	if (!CanRunBenchmark("hwsortbench")) return;
+
+	int repeat = argv.argc() > 1 ? MAX(atoi(argv[1]), 1) : 100;
+
+	AActor *camera = players[consoleplayer].camera;
+	bool savedRadix = gl_sort_radix;
+	bool savedNoInterpolate = r_NoInterpolate;
+	r_NoInterpolate = true;
+
+	auto di = BeginScene(camera);
+	di->CreateScene(false);
+
+	const HWDrawList &captured = di->drawlists[GLDL_TRANSLUCENT];
+	Printf("%u translucent items: %u walls, %u flats, %u sprites\n", captured.drawitems.Size(),
+		captured.walls.Size(), captured.flats.Size(), captured.sprites.Size());
+
+	if (captured.drawitems.Size() > 0)
+	{
+		uint32_t reference = 0;
+		for (int radix = 0; radix < 2; radix++)
+		{
+			gl_sort_radix = !!radix;
+
+			double total = 0;
+			uint32_t hash = 0;
+			for (int i = 0; i <= repeat; i++)
+			{
+				HWDrawList list;
+				CopyItems(list, captured);
+
+				cycle_t sort;
+				sort.Reset();
+				sort.Clock();
+				screen->mVertexData->Map();
+				list.Sort(di);
+				screen->mVertexData->Unmap();
+				sort.Unclock();
+
+				// The first pass only warms up the caches.
+				if (i > 0) total += sort.TimeMS();
+
+				hash = 0;
+				HashSortedItems(list, list.sorted, hash);
+			}
+			if (radix == 0) reference = hash;
+
+			Printf("%-16s %7.3f ms  hash=%08x%s\n", radix ? "radix sort" : "comparison sort", total / repeat, hash,
+				hash != reference ? "  (differs from the comparison sort)" : "");
+		}
+	}
+
+	EndScene(di);
+	gl_sort_radix = savedRadix;
+	r_NoInterpolate = savedNoInterpolate;
+}
@@ -35,6 +35,7 @@
 #include "r_data/colormaps.h"
 #include "swrenderer/r_swcolormaps.h"
 #include "poly_draw_args.h"
+#include "swrenderer/drawers/r_lightramp.h"
 #include "swrenderer/viewport/r_viewport.h"
 #include "polyrenderer/poly_renderthread.h"
 
@@ -126,6 +127,11 @@ void PolyDrawArgs::SetLight(FSWColormap *base_colormap, uint32_t lightlevel, dou
 	mDesaturate += mDesaturate >> 7;
 	mSimpleShade = (base_colormap->Color.d == 0x00ffffff && base_colormap->Fade.d == 0x00000000 && base_colormap->Desaturate == 0);
 	mColormaps = base_colormap->Maps;
+
+	if (!mSimpleShade && PolyTriangleDrawer::IsBgra())
+		mLightRamp = swrenderer::LightRamp::Get(mLightRed, mLightGreen, mLightBlue, mFadeRed, mFadeGreen, mFadeBlue, mDesaturate);
+	else
+		mLightRamp = nullptr;
 }
 
 void PolyDrawArgs::SetColor(uint32_t bgra, uint8_t palindex)
@@ -29,6 +29,7 @@
 class PolyRenderThread;
 class FSoftwareTexture;
 class Mat4f;
+namespace swrenderer { class LightRamp; }
 
 enum class PolyDrawMode
 {
@@ -114,6 +115,7 @@ public:
 	uint16_t ShadeFadeGreen() const { return mFadeGreen; }
 	uint16_t ShadeFadeBlue() const { return mFadeBlue; }
 	uint16_t ShadeDesaturate() const { return mDesaturate; }
+	const swrenderer::LightRamp *ShadeRamp() const { return mLightRamp; }
 
 	bool SimpleShade() const { return mSimpleShade; }
 	bool NearestFilter() const { return mNearestFilter; }
@@ -153,6 +155,7 @@ private:
 	uint16_t mFadeGreen = 0;
 	uint16_t mFadeBlue = 0;
 	uint16_t mDesaturate = 0;
+	const swrenderer::LightRamp *mLightRamp = nullptr;
 	float mGlobVis = 0.0f;
 	bool mSimpleShade = true;
 	bool mNearestFilter = true;
@@ -21,6 +21,8 @@
 */
 
 #include <stddef.h>
+#include <atomic>
+#include <chrono>
 #include "templates.h"
 #include "doomdef.h"
 
@@ -38,6 +40,9 @@
 #include "polyrenderer/poly_renderer.h"
 #include "swrenderer/drawers/r_draw_rgba.h"
 #include "screen_triangle.h"
+#include "swrenderer/r_memory.h"
+#include "c_dispatch.h"
+#include "stats.h"
 #include "x86.h"
 
 static bool isBgraRenderTarget = false;
@@ -107,6 +112,11 @@ void PolyTriangleDrawer::SetModelVertexShader(const DrawerCommandQueuePtr &queue
 	queue->Push<PolySetModelVertexShaderCommand>(frame1, frame2, interpolationFactor);
 }
 
+void PolyTriangleDrawer::SetTileBinning(const DrawerCommandQueuePtr &queue, bool enable)
+{
+	queue->Push<PolySetTileBinningCommand>(enable);
+}
+
 void PolyTriangleDrawer::DrawArray(const DrawerCommandQueuePtr &queue, const PolyDrawArgs &args, const void *vertices, int vcount, PolyDrawMode mode)
 {
 	queue->Push<DrawPolyTrianglesCommand>(args, vertices, nullptr, vcount, mode);
@@ -126,15 +136,11 @@ void PolyTriangleThreadData::ClearStencil(uint8_t value)
 	int height = buffer->Height();
 	uint8_t *data = buffer->Values();
 
-	int skip = skipped_by_thread(0);
-	int count = count_for_thread(0, height);
-
-	data += skip * width;
-	for (int i = 0; i < count; i++)
+	ForEachOwnedRegion(0, 0, width, height, [&](int x0, int y0, int x1, int y1, int ystep)
 	{
-		memset(data, value, width);
-		data += num_cores * width;
-	}
+		for (int y = y0; y < y1; y += ystep)
+			memset(data + y * width + x0, value, x1 - x0);
+	});
 }
 
 void PolyTriangleThreadData::SetViewport(int x, int y, int width, int height, uint8_t *new_dest, int new_dest_width, int new_dest_height, int new_dest_pitch, bool new_dest_bgra)
@@ -428,7 +434,7 @@ void PolyTriangleThreadData::DrawShadedTriangle(const ShadedTriVertex *vert, boo
 			args->v1 = &clippedvert[numclipvert - 1];
 			args->v2 = &clippedvert[i - 1];
 			args->v3 = &clippedvert[i - 2];
-			if (IsFrontfacing(args) == ccw && args->CalculateGradients())
+			if (IsFrontfacing(args) == ccw)
 			{
 				ScreenTriangle::Draw(args, this);
 			}
@@ -441,7 +447,7 @@ void PolyTriangleThreadData::DrawShadedTriangle(const ShadedTriVertex *vert, boo
 			args->v1 = &clippedvert[0];
 			args->v2 = &clippedvert[i - 1];
 			args->v3 = &clippedvert[i];
-			if (IsFrontfacing(args) != ccw && args->CalculateGradients())
+			if (IsFrontfacing(args) != ccw)
 			{
 				ScreenTriangle::Draw(args, this);
 			}
@@ -623,6 +629,160 @@ int PolyTriangleThreadData::ClipEdge(const ShadedTriVertex *verts, ShadedTriVert
 	return inputverts;
 }
 
+/////////////////////////////////////////////////////////////////////////////
+
+static std::atomic<int> BlendedFrames, SharedFrames, BlendedVertices;
+static int LastBlendedFrames, LastSharedFrames, LastBlendedVertices;
+
+PolyModelFrameCache::PolyModelFrameCache(RenderMemory *memory) : Memory(memory)
+{
+	Clear();
+}
+
+void PolyModelFrameCache::Clear()
+{
+	Entries.Clear();
+	for (int i = 0; i < NumBuckets; i++)
+		Buckets[i] = -1;
+}
+
+FModelVertex *PolyModelFrameCache::GetFrame(const FModelVertex *vertices, unsigned int frame1, unsigned int frame2, unsigned int size, float interpolation)
+{
+	unsigned int hash = (unsigned int)(((uintptr_t)vertices >> 4) ^ (frame1 * 31) ^ (frame2 * 17)) % NumBuckets;
+	for (int i = Buckets[hash]; i != -1; i = Entries[i].next)
+	{
+		const Entry &entry = Entries[i];
+		if (entry.vertices == vertices && entry.frame1 == frame1 && entry.frame2 == frame2 && entry.size == size && entry.interpolation == interpolation)
+		{
+			SharedFrames++;
+			return entry.blended;
+		}
+	}
+
+	FModelVertex *blended = Memory->AllocMemory<FModelVertex>(size);
+	Blend(blended, vertices + frame1, vertices + frame2, size, interpolation);
+	Buckets[hash] = Entries.Push({ vertices, frame1, frame2, size, interpolation, blended, Buckets[hash] });
+
+	BlendedFrames++;
+	BlendedVertices += size;
+	return blended;
+}
+
+void PolyModelFrameCache::Blend(FModelVertex *dest, const FModelVertex *frame1, const FModelVertex *frame2, unsigned int size, float interpolation)
+{
+	// Must match the interpolation in PolyTriangleThreadData::ShadeVertex
+	float frac = interpolation;
+	float inv_frac = 1.0f - frac;
+	for (unsigned int i = 0; i < size; i++)
+	{
+		const FModelVertex &v1 = frame1[i];
+		const FModelVertex &v2 = frame2[i];
+		FModelVertex &v = dest[i];
+		v.x = v1.x * inv_frac + v2.x * frac;
+		v.y = v1.y * inv_frac + v2.y * frac;
+		v.z = v1.z * inv_frac + v2.z * frac;
+		v.u = v1.u;
+		v.v = v1.v;
+		v.packedNormal = v1.packedNormal;
+	}
+}
+
+void PolyModelFrameCache::NewFrame()
+{
+	LastBlendedFrames = BlendedFrames.exchange(0);
+	LastSharedFrames = SharedFrames.exchange(0);
+	LastBlendedVertices = BlendedVertices.exchange(0);
+}
+
+ADD_STAT(modelframes)
+{
+	FString out;
+	out.Format("Model frames: %d interpolated, %d shared, %d vertices", LastBlendedFrames, LastSharedFrames, LastBlendedVertices);
+	return out;
+}
+
+//==========================================================================
+//
+// Interpolates a made up model for a number of instances, once for every
+// instance and once through the frame cache, and checks that both give
+// the same vertices. The instances cycle through a few frame pairs and
+// interpolation factors, like a group of monsters playing the same
+// animation does.
+//
+//==========================================================================
+
+CCMD(benchmodelframes)
+{
+	int instances = argv.argc() > 1 ? MAX(atoi(argv[1]), 1) : 200;
+	int passes = argv.argc() > 2 ? MAX(atoi(argv[2]), 1) : 20;
+	const unsigned int numVertices = 1500;
+	const unsigned int numFrames = 8;
+	const float factors[] = { 0.f, 0.25f, 0.5f, 0.75f };
+
+	TArray<FModelVertex> model(numVertices * numFrames, true);
+	uint32_t seed = 0x12345678;
+	for (auto &v : model)
+	{
+		seed = seed * 1664525 + 1013904223;
+		float x = (seed >> 8) * (1.f / 65536.f);
+		v.Set(x, x * 0.5f, x * 0.25f, x, 1.f - x);
+		v.packedNormal = seed;
+	}
+
+	auto instanceFrames = [&](int i, unsigned int &frame1, unsigned int &frame2, float &interpolation)
+	{
+		unsigned int frame = i % numFrames;
+		frame1 = frame * numVertices;
+		frame2 = (frame + 1) % numFrames * numVertices;
+		interpolation = factors[(i / numFrames) % countof(factors)];
+	};
+
+	RenderMemory memory("modelframes");
+	PolyModelFrameCache cache(&memory);
+	TArray<FModelVertex> reference(numVertices * instances, true);
+	TArray<FModelVertex *> cached(instances, true);
+
+	auto start = std::chrono::steady_clock::now();
+	for (int pass = 0; pass < passes; pass++)
+	{
+		for (int i = 0; i < instances; i++)
+		{
+			unsigned int frame1, frame2;
+			float interpolation;
+			instanceFrames(i, frame1, frame2, interpolation);
+			PolyModelFrameCache::Blend(&reference[i * numVertices], &model[frame1], &model[frame2], numVertices, interpolation);
+		}
+	}
+	auto middle = std::chrono::steady_clock::now();
+	for (int pass = 0; pass < passes; pass++)
+	{
+		cache.Clear();
+		memory.Clear();
+		for (int i = 0; i < instances; i++)
+		{
+			unsigned int frame1, frame2;
+			float interpolation;
+			instanceFrames(i, frame1, frame2, interpolation);
+			cached[i] = cache.GetFrame(model.Data(), frame1, frame2, numVertices, interpolation);
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	int mismatches = 0;
+	for (int i = 0; i < instances; i++)
+	{
+		if (memcmp(&reference[i * numVertices], cached[i], numVertices * sizeof(FModelVertex)) != 0) mismatches++;
+	}
+
+	double uncachedTime = std::chrono::duration<double, std::micro>(middle - start).count() / ((double)passes * instances);
+	double cachedTime = std::chrono::duration<double, std::micro>(end - middle).count() / ((double)passes * instances);
+	Printf("%d instances of %u vertices, %d passes\n", instances, numVertices, passes);
+	Printf("every instance %6.3f us/instance  cached %6.3f us/instance  %5.2fx%s\n", uncachedTime, cachedTime, uncachedTime / cachedTime,
+		mismatches ? FStringf("  (%d instances differ)", mismatches).GetChars() : "");
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
 PolyTriangleThreadData *PolyTriangleThreadData::Get(DrawerThread *thread)
 {
 	if (!thread->poly)
@@ -687,6 +847,17 @@ void PolySetModelVertexShaderCommand::Execute(DrawerThread *thread)
 
 /////////////////////////////////////////////////////////////////////////////
 
+PolySetTileBinningCommand::PolySetTileBinningCommand(bool value) : value(value)
+{
+}
+
+void PolySetTileBinningCommand::Execute(DrawerThread *thread)
+{
+	PolyTriangleThreadData::Get(thread)->SetTileBinning(value);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
 PolyClearStencilCommand::PolyClearStencilCommand(uint8_t value) : value(value)
 {
 }
@@ -737,3 +908,23 @@ void DrawRectCommand::Execute(DrawerThread *thread)
 	else
 		ScreenTriangle::RectDrawers8[blendmode](destOrg, destWidth, destHeight, destPitch, &args, PolyTriangleThreadData::Get(thread));
 }
+
+/////////////////////////////////////////////////////////////////////////////
+
+PolyMemcpyCommand::PolyMemcpyCommand(void *dest, const void *src, int width, int height, int srcpitch, int pixelsize)
+	: dest(dest), src(src), width(width), height(height), srcpitch(srcpitch), pixelsize(pixelsize)
+{
+}
+
+void PolyMemcpyCommand::Execute(DrawerThread *thread)
+{
+	PolyTriangleThreadData::Get(thread)->ForEachOwnedRegion(0, 0, width, height, [&](int x0, int y0, int x1, int y1, int ystep)
+	{
+		for (int y = y0; y < y1; y += ystep)
+		{
+			uint8_t *d = (uint8_t*)dest + (y * width + x0) * pixelsize;
+			const uint8_t *s = (const uint8_t*)src + (y * srcpitch + x0) * pixelsize;
+			memcpy(d, s, (x1 - x0) * pixelsize);
+		}
+	});
+}
@@ -41,12 +41,49 @@ public:
 	static void SetTwoSided(const DrawerCommandQueuePtr &queue, bool twosided);
 	static void SetWeaponScene(const DrawerCommandQueuePtr &queue, bool enable);
 	static void SetModelVertexShader(const DrawerCommandQueuePtr &queue, int frame1, int frame2, float interpolationFactor);
+	static void SetTileBinning(const DrawerCommandQueuePtr &queue, bool enable);
 	static void SetTransform(const DrawerCommandQueuePtr &queue, const Mat4f *objectToClip, const Mat4f *objectToWorld);
 	static void DrawArray(const DrawerCommandQueuePtr &queue, const PolyDrawArgs &args, const void *vertices, int vcount, PolyDrawMode mode = PolyDrawMode::Triangles);
 	static void DrawElements(const DrawerCommandQueuePtr &queue, const PolyDrawArgs &args, const void *vertices, const unsigned int *elements, int count, PolyDrawMode mode = PolyDrawMode::Triangles);
 	static bool IsBgra();
 };
 
+class RenderMemory;
+struct FModelVertex;
+
+// Interpolated model frames of one render thread, valid until its frame memory gets cleared.
+// Blending a frame pair here, once, spares every drawer thread from interpolating each vertex it shades.
+// Models drawn with the same frame pair and interpolation factor share the result.
+class PolyModelFrameCache
+{
+public:
+	PolyModelFrameCache(RenderMemory *memory);
+
+	void Clear();
+	FModelVertex *GetFrame(const FModelVertex *vertices, unsigned int frame1, unsigned int frame2, unsigned int size, float interpolation);
+
+	static void Blend(FModelVertex *dest, const FModelVertex *frame1, const FModelVertex *frame2, unsigned int size, float interpolation);
+
+	// Publishes the counters of the frame that just ended
+	static void NewFrame();
+
+private:
+	struct Entry
+	{
+		const FModelVertex *vertices;
+		unsigned int frame1, frame2, size;
+		float interpolation;
+		FModelVertex *blended;
+		int next;
+	};
+
+	enum { NumBuckets = 64 };
+
+	RenderMemory *Memory;
+	TArray<Entry> Entries;
+	int Buckets[NumBuckets];
+};
+
 class PolyTriangleThreadData
 {
 public:
@@ -59,6 +96,7 @@ public:
 	void SetTwoSided(bool value) { twosided = value; }
 	void SetWeaponScene(bool value) { weaponScene = value; }
 	void SetModelVertexShader(int frame1, int frame2, float interpolationFactor) { modelFrame1 = frame1; modelFrame2 = frame2; modelInterpolationFactor = interpolationFactor; }
+	void SetTileBinning(bool value) { tilebinning = value; }
 
 	void DrawElements(const PolyDrawArgs &args, const void *vertices, const unsigned int *elements, int count, PolyDrawMode mode);
 	void DrawArray(const PolyDrawArgs &args, const void *vertices, int vcount, PolyDrawMode mode);
@@ -90,6 +128,44 @@ public:
 		return MAX(c, 0);
 	}
 
+	// With tile binning each thread owns whole screen tiles instead of every num_cores'th line.
+	// Anything writing to the render target while it is active must use the same ownership.
+	enum { TileWidth = 64, TileHeight = 32 };
+	bool tilebinning = false;
+
+	bool IsTileOwner(int tileX, int tileY) const
+	{
+		return (tileX + tileY) % num_cores == core;
+	}
+
+	// Calls callback(x0, y0, x1, y1, ystep) for every part of the box this thread writes to.
+	// y0 is the first line owned by the thread and every ystep'th line after it is owned too.
+	template<typename CallbackT>
+	void ForEachOwnedRegion(int x0, int y0, int x1, int y1, CallbackT callback)
+	{
+		y0 = MAX(y0, numa_start_y);
+		y1 = MIN(y1, numa_end_y);
+		if (x1 <= x0 || y1 <= y0)
+			return;
+
+		if (!tilebinning)
+		{
+			callback(x0, y0 + skipped_by_thread(y0), x1, y1, num_cores);
+			return;
+		}
+
+		for (int tileY = y0 / TileHeight; tileY * TileHeight < y1; tileY++)
+		{
+			int tiley0 = MAX(tileY * TileHeight, y0);
+			int tiley1 = MIN((tileY + 1) * TileHeight, y1);
+			for (int tileX = x0 / TileWidth; tileX * TileWidth < x1; tileX++)
+			{
+				if (IsTileOwner(tileX, tileY))
+					callback(MAX(tileX * TileWidth, x0), tiley0, MIN((tileX + 1) * TileWidth, x1), tiley1, 1);
+			}
+		}
+	}
+
 	// Varyings
 	float worldposX[MAXWIDTH];
 	float worldposY[MAXWIDTH];
@@ -194,6 +270,17 @@ private:
 	float interpolationFactor;
 };
 
+class PolySetTileBinningCommand : public PolyDrawerCommand
+{
+public:
+	PolySetTileBinningCommand(bool value);
+
+	void Execute(DrawerThread *thread) override;
+
+private:
+	bool value;
+};
+
 class PolyClearStencilCommand : public PolyDrawerCommand
 {
 public:
@@ -249,3 +336,20 @@ public:
 private:
 	RectDrawArgs args;
 };
+
+// Copy the finished frame to video memory using the same pixel ownership as the poly drawers
+class PolyMemcpyCommand : public PolyDrawerCommand
+{
+public:
+	PolyMemcpyCommand(void *dest, const void *src, int width, int height, int srcpitch, int pixelsize);
+
+	void Execute(DrawerThread *thread) override;
+
+private:
+	void *dest;
+	const void *src;
+	int width;
+	int height;
+	int srcpitch;
+	int pixelsize;
+};
@@ -52,36 +52,73 @@ static void SortVertices(const TriDrawTriangleArgs *args, ShadedTriVertex **sort
 		std::swap(sortedVertices[1], sortedVertices[2]);
 }
 
-void ScreenTriangle::Draw(const TriDrawTriangleArgs *args, PolyTriangleThreadData *thread)
+// Finds the start/end X positions for every ystep'th line in [y, yend) along a pair of triangle edges
+static int WalkEdges(int16_t *edges, int y, int yend, int ystep, float shortPos, float shortStep, float longPos, float longStep, int clipleft, int clipright)
 {
-	using namespace TriScreenDrawerModes;
-
-	// Sort vertices by Y position
-	ShadedTriVertex *sortedVertices[3];
-	SortVertices(args, sortedVertices);
-
-	int clipleft = 0;
-	int cliptop = MAX(thread->viewport_y, thread->numa_start_y);
-	int clipright = thread->dest_width;
-	int clipbottom = MIN(thread->dest_height, thread->numa_end_y);
-
-	int topY = (int)(sortedVertices[0]->y + 0.5f);
-	int midY = (int)(sortedVertices[1]->y + 0.5f);
-	int bottomY = (int)(sortedVertices[2]->y + 0.5f);
+#ifndef NO_SSE
+	__m128 mlineindex = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	__m128 mshortPos = _mm_add_ps(_mm_set1_ps(shortPos), _mm_mul_ps(_mm_set1_ps(shortStep), mlineindex));
+	__m128 mlongPos = _mm_add_ps(_mm_set1_ps(longPos), _mm_mul_ps(_mm_set1_ps(longStep), mlineindex));
+	__m128 mshortStep = _mm_set1_ps(shortStep * 4.0f);
+	__m128 mlongStep = _mm_set1_ps(longStep * 4.0f);
+	__m128 mclipleft = _mm_set1_ps((float)clipleft);
+	__m128 mclipright = _mm_set1_ps((float)clipright);
+
+	// Clamping before the conversion gives the same result as converting first, as truncation is monotonic
+	while (y + ystep * 3 < yend)
+	{
+		__m128 x0 = _mm_min_ps(_mm_max_ps(_mm_min_ps(mshortPos, mlongPos), mclipleft), mclipright);
+		__m128 x1 = _mm_min_ps(_mm_max_ps(_mm_max_ps(mshortPos, mlongPos), mclipleft), mclipright);
+		__m128i ix0 = _mm_cvttps_epi32(x0);
+		__m128i ix1 = _mm_cvttps_epi32(x1);
+		__m128i packed = _mm_packs_epi32(_mm_unpacklo_epi32(ix0, ix1), _mm_unpackhi_epi32(ix0, ix1));
 
-	topY = MAX(topY, cliptop);
-	midY = MIN(midY, clipbottom);
-	bottomY = MIN(bottomY, clipbottom);
+		if (ystep == 1)
+		{
+			_mm_storeu_si128((__m128i*)&edges[y << 1], packed);
+		}
+		else
+		{
+			int16_t lines[8];
+			_mm_storeu_si128((__m128i*)lines, packed);
+			for (int i = 0; i < 4; i++)
+			{
+				edges[(y + ystep * i) << 1] = lines[i * 2];
+				edges[((y + ystep * i) << 1) + 1] = lines[i * 2 + 1];
+			}
+		}
 
-	if (topY >= bottomY)
-		return;
+		mshortPos = _mm_add_ps(mshortPos, mshortStep);
+		mlongPos = _mm_add_ps(mlongPos, mlongStep);
+		y += ystep * 4;
+	}
 
-	topY += thread->skipped_by_thread(topY);
-	int num_cores = thread->num_cores;
+	shortPos = _mm_cvtss_f32(mshortPos);
+	longPos = _mm_cvtss_f32(mlongPos);
+#endif
 
-	// Find start/end X positions for each line covered by the triangle:
+	while (y < yend)
+	{
+		int x0 = (int)shortPos;
+		int x1 = (int)longPos;
+		if (x1 < x0) std::swap(x0, x1);
+		x0 = clamp(x0, clipleft, clipright);
+		x1 = clamp(x1, clipleft, clipright);
+
+		edges[y << 1] = x0;
+		edges[(y << 1) + 1] = x1;
+
+		shortPos += shortStep;
+		longPos += longStep;
+		y += ystep;
+	}
+	return y;
+}
 
-	int16_t edges[MAXHEIGHT * 2];
+// Draws every ystep'th line in [topY, bottomY) of the triangle, clipped to [clipleft, clipright)
+static void DrawTriangleRegion(const TriDrawTriangleArgs *args, PolyTriangleThreadData *thread, ShadedTriVertex **sortedVertices, int opt, int16_t *edges, int clipleft, int clipright, int topY, int bottomY, int ystep)
+{
+	int midY = MIN((int)(sortedVertices[1]->y + 0.5f), bottomY);
 
 	int y = topY;
 
@@ -89,7 +126,6 @@ void ScreenTriangle::Draw(const TriDrawTriangleArgs *args, PolyTriangleThreadDat
 	float longDY = sortedVertices[2]->y - sortedVertices[0]->y;
 	float longStep = longDX / longDY;
 	float longPos = sortedVertices[0]->x + longStep * (y + 0.5f - sortedVertices[0]->y) + 0.5f;
-	longStep *= num_cores;
 
 	if (y < midY)
 	{
@@ -97,23 +133,10 @@ void ScreenTriangle::Draw(const TriDrawTriangleArgs *args, PolyTriangleThreadDat
 		float shortDY = sortedVertices[1]->y - sortedVertices[0]->y;
 		float shortStep = shortDX / shortDY;
 		float shortPos = sortedVertices[0]->x + shortStep * (y + 0.5f - sortedVertices[0]->y) + 0.5f;
-		shortStep *= num_cores;
 
-		while (y < midY)
-		{
-			int x0 = (int)shortPos;
-			int x1 = (int)longPos;
-			if (x1 < x0) std::swap(x0, x1);
-			x0 = clamp(x0, clipleft, clipright);
-			x1 = clamp(x1, clipleft, clipright);
-
-			edges[y << 1] = x0;
-			edges[(y << 1) + 1] = x1;
-
-			shortPos += shortStep;
-			longPos += longStep;
-			y += num_cores;
-		}
+		int endY = WalkEdges(edges, y, midY, ystep, shortPos, shortStep * ystep, longPos, longStep * ystep, clipleft, clipright);
+		longPos += longStep * (endY - y);
+		y = endY;
 	}
 
 	if (y < bottomY)
@@ -122,37 +145,149 @@ void ScreenTriangle::Draw(const TriDrawTriangleArgs *args, PolyTriangleThreadDat
 		float shortDY = sortedVertices[2]->y - sortedVertices[1]->y;
 		float shortStep = shortDX / shortDY;
 		float shortPos = sortedVertices[1]->x + shortStep * (y + 0.5f - sortedVertices[1]->y) + 0.5f;
-		shortStep *= num_cores;
 
-		while (y < bottomY)
+		WalkEdges(edges, y, bottomY, ystep, shortPos, shortStep * ystep, longPos, longStep * ystep, clipleft, clipright);
+	}
+
+	ScreenTriangle::TriangleDrawers[opt](args, thread, edges, topY, bottomY, ystep);
+}
+
+// Conservative test for whether a triangle covers any pixel in a box, using its edge functions
+class TriangleEdgeTest
+{
+public:
+	TriangleEdgeTest(ShadedTriVertex **v)
+	{
+		float area = (v[1]->x - v[0]->x) * (v[2]->y - v[0]->y) - (v[1]->y - v[0]->y) * (v[2]->x - v[0]->x);
+		float sign = area < 0.0f ? -1.0f : 1.0f;
+		for (int i = 0; i < 3; i++)
 		{
-			int x0 = (int)shortPos;
-			int x1 = (int)longPos;
-			if (x1 < x0) std::swap(x0, x1);
-			x0 = clamp(x0, clipleft, clipright);
-			x1 = clamp(x1, clipleft, clipright);
-
-			edges[y << 1] = x0;
-			edges[(y << 1) + 1] = x1;
-
-			shortPos += shortStep;
-			longPos += longStep;
-			y += num_cores;
+			const ShadedTriVertex *a = v[i];
+			const ShadedTriVertex *b = v[(i + 1) % 3];
+			dx[i] = (b->x - a->x) * sign;
+			dy[i] = (b->y - a->y) * sign;
+			ax[i] = a->x;
+			ay[i] = a->y;
 		}
 	}
 
+	bool Overlaps(int x0, int y0, int x1, int y1) const
+	{
+		// Grow the box by a pixel so the rounding done by the edge walker can't miss any coverage
+		float left = (float)(x0 - 1), right = (float)(x1 + 1), top = (float)(y0 - 1), bottom = (float)(y1 + 1);
+#ifndef NO_SSE
+		__m128 px = _mm_setr_ps(left, right, left, right);
+		__m128 py = _mm_setr_ps(top, top, bottom, bottom);
+		for (int i = 0; i < 3; i++)
+		{
+			__m128 e = _mm_sub_ps(
+				_mm_mul_ps(_mm_set1_ps(dx[i]), _mm_sub_ps(py, _mm_set1_ps(ay[i]))),
+				_mm_mul_ps(_mm_set1_ps(dy[i]), _mm_sub_ps(px, _mm_set1_ps(ax[i]))));
+			if (_mm_movemask_ps(_mm_cmplt_ps(e, _mm_setzero_ps())) == 15)
+				return false;
+		}
+#else
+		float px[4] = { left, right, left, right };
+		float py[4] = { top, top, bottom, bottom };
+		for (int i = 0; i < 3; i++)
+		{
+			int outside = 0;
+			for (int j = 0; j < 4; j++)
+			{
+				if (dx[i] * (py[j] - ay[i]) - dy[i] * (px[j] - ax[i]) < 0.0f)
+					outside++;
+			}
+			if (outside == 4)
+				return false;
+		}
+#endif
+		return true;
+	}
+
+private:
+	float dx[3], dy[3], ax[3], ay[3];
+};
+
+void ScreenTriangle::Draw(TriDrawTriangleArgs *args, PolyTriangleThreadData *thread)
+{
+	using namespace TriScreenDrawerModes;
+
+	// Sort vertices by Y position
+	ShadedTriVertex *sortedVertices[3];
+	SortVertices(args, sortedVertices);
+
+	int clipleft = 0;
+	int cliptop = MAX(thread->viewport_y, thread->numa_start_y);
+	int clipright = thread->dest_width;
+	int clipbottom = MIN(thread->dest_height, thread->numa_end_y);
+
+	int topY = (int)(sortedVertices[0]->y + 0.5f);
+	int bottomY = (int)(sortedVertices[2]->y + 0.5f);
+
+	topY = MAX(topY, cliptop);
+	bottomY = MIN(bottomY, clipbottom);
+
+	if (topY >= bottomY)
+		return;
+
 	int opt = 0;
 	if (args->uniforms->DepthTest()) opt |= SWTRI_DepthTest;
 	/*if (args->uniforms->StencilTest())*/ opt |= SWTRI_StencilTest;
 	if (args->uniforms->WriteColor()) opt |= SWTRI_WriteColor;
 	if (args->uniforms->WriteDepth()) opt |= SWTRI_WriteDepth;
 	if (args->uniforms->WriteStencil()) opt |= SWTRI_WriteStencil;
-	
-	TriangleDrawers[opt](args, thread, edges, topY, bottomY);
+
+	int16_t edges[MAXHEIGHT * 2];
+
+	if (!thread->tilebinning)
+	{
+		topY += thread->skipped_by_thread(topY);
+		if (topY < bottomY && args->CalculateGradients())
+			DrawTriangleRegion(args, thread, sortedVertices, opt, edges, clipleft, clipright, topY, bottomY, thread->num_cores);
+		return;
+	}
+
+	// Only set up the triangle if it touches a tile owned by this thread
+	float minX = MIN(MIN(sortedVertices[0]->x, sortedVertices[1]->x), sortedVertices[2]->x);
+	float maxX = MAX(MAX(sortedVertices[0]->x, sortedVertices[1]->x), sortedVertices[2]->x);
+	int leftX = (int)clamp(minX - 1.0f, (float)clipleft, (float)clipright);
+	int rightX = (int)clamp(maxX + 2.0f, (float)clipleft, (float)clipright);
+	if (leftX >= rightX)
+		return;
+
+	const int tileWidth = PolyTriangleThreadData::TileWidth;
+	const int tileHeight = PolyTriangleThreadData::TileHeight;
+	TriangleEdgeTest edgeTest(sortedVertices);
+	bool gradientsReady = false;
+
+	for (int tileY = topY / tileHeight; tileY * tileHeight < bottomY; tileY++)
+	{
+		int tileTop = MAX(tileY * tileHeight, topY);
+		int tileBottom = MIN((tileY + 1) * tileHeight, bottomY);
+		for (int tileX = leftX / tileWidth; tileX * tileWidth < rightX; tileX++)
+		{
+			if (!thread->IsTileOwner(tileX, tileY))
+				continue;
+
+			int tileLeft = MAX(tileX * tileWidth, clipleft);
+			int tileRight = MIN((tileX + 1) * tileWidth, clipright);
+			if (!edgeTest.Overlaps(tileLeft, tileTop, tileRight, tileBottom))
+				continue;
+
+			if (!gradientsReady)
+			{
+				if (!args->CalculateGradients())
+					return;
+				gradientsReady = true;
+			}
+
+			DrawTriangleRegion(args, thread, sortedVertices, opt, edges, tileLeft, tileRight, tileTop, tileBottom, 1);
+		}
+	}
 }
 
 template<typename OptT>
-void DrawTriangle(const TriDrawTriangleArgs *args, PolyTriangleThreadData *thread, int16_t *edges, int topY, int bottomY)
+void DrawTriangle(const TriDrawTriangleArgs *args, PolyTriangleThreadData *thread, int16_t *edges, int topY, int bottomY, int ystep)
 {
 	using namespace TriScreenDrawerModes;
 
@@ -200,8 +335,7 @@ void DrawTriangle(const TriDrawTriangleArgs *args, PolyTriangleThreadData *threa
 		weaponWOffset = thread->weaponScene ? 1.0f : 0.0f;
 	}
 
-	int num_cores = thread->num_cores;
-	for (int y = topY; y < bottomY; y += num_cores)
+	for (int y = topY; y < bottomY; y += ystep)
 	{
 		int x = edges[y << 1];
 		int xend = edges[(y << 1) + 1];
@@ -833,6 +967,7 @@ void DrawSpanOpt32(int y, int x0, int x1, const TriDrawTriangleArgs *args, PolyT
 
 	uint32_t fixedlight;
 	uint32_t shade_fade_r, shade_fade_g, shade_fade_b, shade_light_r, shade_light_g, shade_light_b, desaturate, inv_desaturate;
+	const swrenderer::LightRamp *ramp;
 	fixed_t fuzzscale;
 	int _fuzzpos;
 	const uint32_t *texPixels, *translation;
@@ -882,6 +1017,11 @@ void DrawSpanOpt32(int y, int x0, int x1, const TriDrawTriangleArgs *args, PolyT
 		inv_desaturate = 256 - desaturate;
 	}
 
+	if (OptT::Flags & SWOPT_LightRamp)
+	{
+		ramp = args->uniforms->ShadeRamp();
+	}
+
 	if (ModeT::BlendOp == STYLEOP_Fuzz)
 	{
 		fuzzscale = (200 << FRACBITS) / viewheight;
@@ -1005,16 +1145,24 @@ void DrawSpanOpt32(int y, int x0, int x1, const TriDrawTriangleArgs *args, PolyT
 			}
 
 			uint32_t shadedfg_r, shadedfg_g, shadedfg_b;
-			if (OptT::Flags & SWOPT_ColoredFog)
+			if (OptT::Flags & SWOPT_LightRamp)
+			{
+				uint32_t shaded = ramp->Shade(fg, lightshade);
+				shadedfg_r = RPART(shaded);
+				shadedfg_g = GPART(shaded);
+				shadedfg_b = BPART(shaded);
+			}
+			else if (OptT::Flags & SWOPT_ColoredFog)
 			{
 				uint32_t fg_r = RPART(fg);
 				uint32_t fg_g = GPART(fg);
 				uint32_t fg_b = BPART(fg);
+				// The fade colors are 0-256 here, so clamp like the light ramps do
 				uint32_t intensity = ((fg_r * 77 + fg_g * 143 + fg_b * 37) >> 8) * desaturate;
 				int inv_light = 256 - lightshade;
-				shadedfg_r = (((shade_fade_r * inv_light + ((fg_r * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_r) >> 8;
-				shadedfg_g = (((shade_fade_g * inv_light + ((fg_g * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_g) >> 8;
-				shadedfg_b = (((shade_fade_b * inv_light + ((fg_b * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_b) >> 8;
+				shadedfg_r = MIN((((shade_fade_r * inv_light + ((fg_r * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_r) >> 8, (uint32_t)255);
+				shadedfg_g = MIN((((shade_fade_g * inv_light + ((fg_g * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_g) >> 8, (uint32_t)255);
+				shadedfg_b = MIN((((shade_fade_b * inv_light + ((fg_b * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_b) >> 8, (uint32_t)255);
 			}
 			else
 			{
@@ -1077,11 +1225,22 @@ void DrawSpanOpt32(int y, int x0, int x1, const TriDrawTriangleArgs *args, PolyT
 				uint32_t fg_r = RPART(fg);
 				uint32_t fg_g = GPART(fg);
 				uint32_t fg_b = BPART(fg);
-				uint32_t intensity = ((fg_r * 77 + fg_g * 143 + fg_b * 37) >> 8) * desaturate;
-				int inv_light = 256 - lightshade;
-				shadedfg_r = (((shade_fade_r * inv_light + ((fg_r * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_r) >> 8;
-				shadedfg_g = (((shade_fade_g * inv_light + ((fg_g * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_g) >> 8;
-				shadedfg_b = (((shade_fade_b * inv_light + ((fg_b * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_b) >> 8;
+				if (OptT::Flags & SWOPT_LightRamp)
+				{
+					uint32_t shaded = ramp->Shade(fg, lightshade);
+					shadedfg_r = RPART(shaded);
+					shadedfg_g = GPART(shaded);
+					shadedfg_b = BPART(shaded);
+				}
+				else
+				{
+					// The fade colors are 0-256 here, so clamp like the light ramps do
+					uint32_t intensity = ((fg_r * 77 + fg_g * 143 + fg_b * 37) >> 8) * desaturate;
+					int inv_light = 256 - lightshade;
+					shadedfg_r = MIN((((shade_fade_r * inv_light + ((fg_r * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_r) >> 8, (uint32_t)255);
+					shadedfg_g = MIN((((shade_fade_g * inv_light + ((fg_g * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_g) >> 8, (uint32_t)255);
+					shadedfg_b = MIN((((shade_fade_b * inv_light + ((fg_b * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_b) >> 8, (uint32_t)255);
+				}
 
 				if (OptT::Flags & SWOPT_DynLights)
 				{
@@ -1222,12 +1381,15 @@ void DrawSpan32(int y, int x0, int x1, const TriDrawTriangleArgs *args, PolyTria
 {
 	using namespace TriScreenDrawerModes;
 
+	bool ramp = args->uniforms->ShadeRamp() != nullptr;
 	if (args->uniforms->NumLights() == 0 && args->uniforms->DynLightColor() == 0)
 	{
 		if (!args->uniforms->FixedLight())
 		{
 			if (args->uniforms->SimpleShade())
 				DrawSpanOpt32<ModeT, DrawerOpt>(y, x0, x1, args, thread);
+			else if (ramp)
+				DrawSpanOpt32<ModeT, DrawerOptCR>(y, x0, x1, args, thread);
 			else
 				DrawSpanOpt32<ModeT, DrawerOptC>(y, x0, x1, args, thread);
 		}
@@ -1235,6 +1397,8 @@ void DrawSpan32(int y, int x0, int x1, const TriDrawTriangleArgs *args, PolyTria
 		{
 			if (args->uniforms->SimpleShade())
 				DrawSpanOpt32<ModeT, DrawerOptF>(y, x0, x1, args, thread);
+			else if (ramp)
+				DrawSpanOpt32<ModeT, DrawerOptCFR>(y, x0, x1, args, thread);
 			else
 				DrawSpanOpt32<ModeT, DrawerOptCF>(y, x0, x1, args, thread);
 		}
@@ -1245,6 +1409,8 @@ void DrawSpan32(int y, int x0, int x1, const TriDrawTriangleArgs *args, PolyTria
 		{
 			if (args->uniforms->SimpleShade())
 				DrawSpanOpt32<ModeT, DrawerOptL>(y, x0, x1, args, thread);
+			else if (ramp)
+				DrawSpanOpt32<ModeT, DrawerOptLCR>(y, x0, x1, args, thread);
 			else
 				DrawSpanOpt32<ModeT, DrawerOptLC>(y, x0, x1, args, thread);
 		}
@@ -1252,6 +1418,8 @@ void DrawSpan32(int y, int x0, int x1, const TriDrawTriangleArgs *args, PolyTria
 		{
 			if (args->uniforms->SimpleShade())
 				DrawSpanOpt32<ModeT, DrawerOptLF>(y, x0, x1, args, thread);
+			else if (ramp)
+				DrawSpanOpt32<ModeT, DrawerOptLCFR>(y, x0, x1, args, thread);
 			else
 				DrawSpanOpt32<ModeT, DrawerOptLCF>(y, x0, x1, args, thread);
 		}
@@ -1633,199 +1801,197 @@ void DrawRect8(const void *destOrg, int destWidth, int destHeight, int destPitch
 	uint32_t stepU = (int32_t)(fstepU * 0x1000000);
 	uint32_t stepV = (int32_t)(fstepV * 0x1000000);
 
-	uint32_t posV = startV;
-	y1 = MIN(y1, thread->numa_end_y);
-	int num_cores = thread->num_cores;
-	int skip = thread->skipped_by_thread(y0);
-	posV += skip * stepV;
-	stepV *= num_cores;
-	for (int y = y0 + skip; y < y1; y += num_cores, posV += stepV)
+	thread->ForEachOwnedRegion(x0, y0, x1, y1, [&](int rx0, int ry0, int rx1, int ry1, int ystep)
 	{
-		uint8_t *destLine = ((uint8_t*)destOrg) + y * destPitch;
-
-		uint32_t posU = startU;
-		for (int x = x0; x < x1; x++)
+		uint32_t posV = startV + (ry0 - y0) * stepV;
+		for (int y = ry0; y < ry1; y += ystep, posV += stepV * ystep)
 		{
-			if (ModeT::BlendOp == STYLEOP_Fuzz)
-			{
-				using namespace swrenderer;
-
-				uint32_t texelX = (((posU << 8) >> 16) * texWidth) >> 16;
-				uint32_t texelY = (((posV << 8) >> 16) * texHeight) >> 16;
-				unsigned int sampleshadeout = (texPixels[texelX * texHeight + texelY] != 0) ? 256 : 0;
-
-				int scaled_x = (x * fuzzscale) >> FRACBITS;
-				int fuzz_x = fuzz_random_x_offset[scaled_x % FUZZ_RANDOM_X_SIZE] + _fuzzpos;
-
-				fixed_t fuzzcount = FUZZTABLE << FRACBITS;
-				fixed_t fuzz = ((fuzz_x << FRACBITS) + y * fuzzscale) % fuzzcount;
-				unsigned int alpha = fuzzoffset[fuzz >> FRACBITS];
-
-				sampleshadeout = (sampleshadeout * alpha) >> 5;
+			uint8_t *destLine = ((uint8_t*)destOrg) + y * destPitch;
 
-				uint32_t a = 256 - sampleshadeout;
-
-				uint32_t dest = GPalette.BaseColors[destLine[x]].d;
-				uint32_t r = (RPART(dest) * a) >> 8;
-				uint32_t g = (GPART(dest) * a) >> 8;
-				uint32_t b = (BPART(dest) * a) >> 8;
-				destLine[x] = RGB256k.All[((r >> 2) << 12) | ((g >> 2) << 6) | (b >> 2)];
-			}
-			else
+			uint32_t posU = startU + (rx0 - x0) * stepU;
+			for (int x = rx0; x < rx1; x++)
 			{
-				int fg = 0;
-				if (ModeT::SWFlags & SWSTYLEF_Fill)
-				{
-					fg = fillcolor;
-				}
-				else
+				if (ModeT::BlendOp == STYLEOP_Fuzz)
 				{
+					using namespace swrenderer;
+
 					uint32_t texelX = (((posU << 8) >> 16) * texWidth) >> 16;
 					uint32_t texelY = (((posV << 8) >> 16) * texHeight) >> 16;
-					fg = texPixels[texelX * texHeight + texelY];
-				}
+					unsigned int sampleshadeout = (texPixels[texelX * texHeight + texelY] != 0) ? 256 : 0;
 
-				int fgalpha = 255;
+					int scaled_x = (x * fuzzscale) >> FRACBITS;
+					int fuzz_x = fuzz_random_x_offset[scaled_x % FUZZ_RANDOM_X_SIZE] + _fuzzpos;
 
-				if (ModeT::BlendDest == STYLEALPHA_InvSrc)
-				{
-					if (fg == 0)
-						fgalpha = 0;
-				}
+					fixed_t fuzzcount = FUZZTABLE << FRACBITS;
+					fixed_t fuzz = ((fuzz_x << FRACBITS) + y * fuzzscale) % fuzzcount;
+					unsigned int alpha = fuzzoffset[fuzz >> FRACBITS];
 
-				if ((ModeT::Flags & STYLEF_ColorIsFixed) && !(ModeT::SWFlags & SWSTYLEF_Fill))
-				{
-					if (ModeT::Flags & STYLEF_RedIsAlpha)
-						fgalpha = fg;
-					fg = fillcolor;
-				}
+					sampleshadeout = (sampleshadeout * alpha) >> 5;
 
-				if (!(ModeT::Flags & STYLEF_Alpha1))
-				{
-					fgalpha = (fgalpha * alpha) >> 8;
-				}
-
-				if (ModeT::SWFlags & SWSTYLEF_Translated)
-					fg = translation[fg];
-
-				uint8_t shadedfg = colormaps[light + fg];
+					uint32_t a = 256 - sampleshadeout;
 
-				if (ModeT::BlendSrc == STYLEALPHA_One && ModeT::BlendDest == STYLEALPHA_Zero)
-				{
-					destLine[x] = shadedfg;
+					uint32_t dest = GPalette.BaseColors[destLine[x]].d;
+					uint32_t r = (RPART(dest) * a) >> 8;
+					uint32_t g = (GPART(dest) * a) >> 8;
+					uint32_t b = (BPART(dest) * a) >> 8;
+					destLine[x] = RGB256k.All[((r >> 2) << 12) | ((g >> 2) << 6) | (b >> 2)];
 				}
-				else if (ModeT::BlendSrc == STYLEALPHA_One && ModeT::BlendDest == STYLEALPHA_One)
+				else
 				{
-					uint32_t src = GPalette.BaseColors[shadedfg];
-					uint32_t dest = GPalette.BaseColors[destLine[x]];
-
-					if (ModeT::BlendOp == STYLEOP_Add)
+					int fg = 0;
+					if (ModeT::SWFlags & SWSTYLEF_Fill)
 					{
-						uint32_t out_r = MIN<uint32_t>(RPART(dest) + RPART(src), 255);
-						uint32_t out_g = MIN<uint32_t>(GPART(dest) + GPART(src), 255);
-						uint32_t out_b = MIN<uint32_t>(BPART(dest) + BPART(src), 255);
-						destLine[x] = RGB256k.All[((out_r >> 2) << 12) | ((out_g >> 2) << 6) | (out_b >> 2)];
+						fg = fillcolor;
 					}
-					else if (ModeT::BlendOp == STYLEOP_RevSub)
+					else
 					{
-						uint32_t out_r = MAX<uint32_t>(RPART(dest) - RPART(src), 0);
-						uint32_t out_g = MAX<uint32_t>(GPART(dest) - GPART(src), 0);
-						uint32_t out_b = MAX<uint32_t>(BPART(dest) - BPART(src), 0);
-						destLine[x] = RGB256k.All[((out_r >> 2) << 12) | ((out_g >> 2) << 6) | (out_b >> 2)];
+						uint32_t texelX = (((posU << 8) >> 16) * texWidth) >> 16;
+						uint32_t texelY = (((posV << 8) >> 16) * texHeight) >> 16;
+						fg = texPixels[texelX * texHeight + texelY];
 					}
-					else //if (ModeT::BlendOp == STYLEOP_Sub)
+
+					int fgalpha = 255;
+
+					if (ModeT::BlendDest == STYLEALPHA_InvSrc)
 					{
-						uint32_t out_r = MAX<uint32_t>(RPART(src) - RPART(dest), 0);
-						uint32_t out_g = MAX<uint32_t>(GPART(src) - GPART(dest), 0);
-						uint32_t out_b = MAX<uint32_t>(BPART(src) - BPART(dest), 0);
-						destLine[x] = RGB256k.All[((out_r >> 2) << 12) | ((out_g >> 2) << 6) | (out_b >> 2)];
+						if (fg == 0)
+							fgalpha = 0;
 					}
-				}
-				else if (ModeT::SWFlags & SWSTYLEF_SrcColorOneMinusSrcColor)
-				{
-					uint32_t src = GPalette.BaseColors[shadedfg];
-					uint32_t dest = GPalette.BaseColors[destLine[x]];
-
-					uint32_t sfactor_r = RPART(src); sfactor_r += sfactor_r >> 7; // 255 -> 256
-					uint32_t sfactor_g = GPART(src); sfactor_g += sfactor_g >> 7; // 255 -> 256
-					uint32_t sfactor_b = BPART(src); sfactor_b += sfactor_b >> 7; // 255 -> 256
-					uint32_t sfactor_a = fgalpha; sfactor_a += sfactor_a >> 7; // 255 -> 256
-					uint32_t dfactor_r = 256 - sfactor_r;
-					uint32_t dfactor_g = 256 - sfactor_g;
-					uint32_t dfactor_b = 256 - sfactor_b;
-					uint32_t out_r = (RPART(dest) * dfactor_r + RPART(src) * sfactor_r + 128) >> 8;
-					uint32_t out_g = (GPART(dest) * dfactor_g + GPART(src) * sfactor_g + 128) >> 8;
-					uint32_t out_b = (BPART(dest) * dfactor_b + BPART(src) * sfactor_b + 128) >> 8;
 
-					destLine[x] = RGB256k.All[((out_r >> 2) << 12) | ((out_g >> 2) << 6) | (out_b >> 2)];
-				}
-				else if (ModeT::BlendSrc == STYLEALPHA_Src && ModeT::BlendDest == STYLEALPHA_InvSrc && fgalpha == 255)
-				{
-					destLine[x] = shadedfg;
-				}
-				else if (ModeT::BlendSrc != STYLEALPHA_Src || ModeT::BlendDest != STYLEALPHA_InvSrc || fgalpha != 0)
-				{
-					uint32_t src = GPalette.BaseColors[shadedfg];
-					uint32_t dest = GPalette.BaseColors[destLine[x]];
-
-					uint32_t sfactor = fgalpha; sfactor += sfactor >> 7; // 255 -> 256
-					uint32_t dfactor = 256 - sfactor;
-					uint32_t src_r = RPART(src) * sfactor;
-					uint32_t src_g = GPART(src) * sfactor;
-					uint32_t src_b = BPART(src) * sfactor;
-					uint32_t dest_r = RPART(dest);
-					uint32_t dest_g = GPART(dest);
-					uint32_t dest_b = BPART(dest);
-					if (ModeT::BlendDest == STYLEALPHA_One)
+					if ((ModeT::Flags & STYLEF_ColorIsFixed) && !(ModeT::SWFlags & SWSTYLEF_Fill))
 					{
-						dest_r <<= 8;
-						dest_g <<= 8;
-						dest_b <<= 8;
+						if (ModeT::Flags & STYLEF_RedIsAlpha)
+							fgalpha = fg;
+						fg = fillcolor;
 					}
-					else
+
+					if (!(ModeT::Flags & STYLEF_Alpha1))
 					{
-						uint32_t dfactor = 256 - sfactor;
-						dest_r *= dfactor;
-						dest_g *= dfactor;
-						dest_b *= dfactor;
+						fgalpha = (fgalpha * alpha) >> 8;
 					}
 
-					uint32_t out_r, out_g, out_b;
-					if (ModeT::BlendOp == STYLEOP_Add)
+					if (ModeT::SWFlags & SWSTYLEF_Translated)
+						fg = translation[fg];
+
+					uint8_t shadedfg = colormaps[light + fg];
+
+					if (ModeT::BlendSrc == STYLEALPHA_One && ModeT::BlendDest == STYLEALPHA_Zero)
 					{
-						if (ModeT::BlendDest == STYLEALPHA_One)
+						destLine[x] = shadedfg;
+					}
+					else if (ModeT::BlendSrc == STYLEALPHA_One && ModeT::BlendDest == STYLEALPHA_One)
+					{
+						uint32_t src = GPalette.BaseColors[shadedfg];
+						uint32_t dest = GPalette.BaseColors[destLine[x]];
+
+						if (ModeT::BlendOp == STYLEOP_Add)
 						{
-							out_r = MIN<int32_t>((dest_r + src_r + 128) >> 8, 255);
-							out_g = MIN<int32_t>((dest_g + src_g + 128) >> 8, 255);
-							out_b = MIN<int32_t>((dest_b + src_b + 128) >> 8, 255);
+							uint32_t out_r = MIN<uint32_t>(RPART(dest) + RPART(src), 255);
+							uint32_t out_g = MIN<uint32_t>(GPART(dest) + GPART(src), 255);
+							uint32_t out_b = MIN<uint32_t>(BPART(dest) + BPART(src), 255);
+							destLine[x] = RGB256k.All[((out_r >> 2) << 12) | ((out_g >> 2) << 6) | (out_b >> 2)];
 						}
-						else
+						else if (ModeT::BlendOp == STYLEOP_RevSub)
+						{
+							uint32_t out_r = MAX<uint32_t>(RPART(dest) - RPART(src), 0);
+							uint32_t out_g = MAX<uint32_t>(GPART(dest) - GPART(src), 0);
+							uint32_t out_b = MAX<uint32_t>(BPART(dest) - BPART(src), 0);
+							destLine[x] = RGB256k.All[((out_r >> 2) << 12) | ((out_g >> 2) << 6) | (out_b >> 2)];
+						}
+						else //if (ModeT::BlendOp == STYLEOP_Sub)
 						{
-							out_r = (dest_r + src_r + 128) >> 8;
-							out_g = (dest_g + src_g + 128) >> 8;
-							out_b = (dest_b + src_b + 128) >> 8;
+							uint32_t out_r = MAX<uint32_t>(RPART(src) - RPART(dest), 0);
+							uint32_t out_g = MAX<uint32_t>(GPART(src) - GPART(dest), 0);
+							uint32_t out_b = MAX<uint32_t>(BPART(src) - BPART(dest), 0);
+							destLine[x] = RGB256k.All[((out_r >> 2) << 12) | ((out_g >> 2) << 6) | (out_b >> 2)];
 						}
 					}
-					else if (ModeT::BlendOp == STYLEOP_RevSub)
+					else if (ModeT::SWFlags & SWSTYLEF_SrcColorOneMinusSrcColor)
 					{
-						out_r = MAX<int32_t>(static_cast<int32_t>(dest_r - src_r + 128) >> 8, 0);
-						out_g = MAX<int32_t>(static_cast<int32_t>(dest_g - src_g + 128) >> 8, 0);
-						out_b = MAX<int32_t>(static_cast<int32_t>(dest_b - src_b + 128) >> 8, 0);
+						uint32_t src = GPalette.BaseColors[shadedfg];
+						uint32_t dest = GPalette.BaseColors[destLine[x]];
+
+						uint32_t sfactor_r = RPART(src); sfactor_r += sfactor_r >> 7; // 255 -> 256
+						uint32_t sfactor_g = GPART(src); sfactor_g += sfactor_g >> 7; // 255 -> 256
+						uint32_t sfactor_b = BPART(src); sfactor_b += sfactor_b >> 7; // 255 -> 256
+						uint32_t sfactor_a = fgalpha; sfactor_a += sfactor_a >> 7; // 255 -> 256
+						uint32_t dfactor_r = 256 - sfactor_r;
+						uint32_t dfactor_g = 256 - sfactor_g;
+						uint32_t dfactor_b = 256 - sfactor_b;
+						uint32_t out_r = (RPART(dest) * dfactor_r + RPART(src) * sfactor_r + 128) >> 8;
+						uint32_t out_g = (GPART(dest) * dfactor_g + GPART(src) * sfactor_g + 128) >> 8;
+						uint32_t out_b = (BPART(dest) * dfactor_b + BPART(src) * sfactor_b + 128) >> 8;
+
+						destLine[x] = RGB256k.All[((out_r >> 2) << 12) | ((out_g >> 2) << 6) | (out_b >> 2)];
 					}
-					else //if (ModeT::BlendOp == STYLEOP_Sub)
+					else if (ModeT::BlendSrc == STYLEALPHA_Src && ModeT::BlendDest == STYLEALPHA_InvSrc && fgalpha == 255)
 					{
-						out_r = MAX<int32_t>(static_cast<int32_t>(src_r - dest_r + 128) >> 8, 0);
-						out_g = MAX<int32_t>(static_cast<int32_t>(src_g - dest_g + 128) >> 8, 0);
-						out_b = MAX<int32_t>(static_cast<int32_t>(src_b - dest_b + 128) >> 8, 0);
+						destLine[x] = shadedfg;
 					}
+					else if (ModeT::BlendSrc != STYLEALPHA_Src || ModeT::BlendDest != STYLEALPHA_InvSrc || fgalpha != 0)
+					{
+						uint32_t src = GPalette.BaseColors[shadedfg];
+						uint32_t dest = GPalette.BaseColors[destLine[x]];
 
-					destLine[x] = RGB256k.All[((out_r >> 2) << 12) | ((out_g >> 2) << 6) | (out_b >> 2)];
+						uint32_t sfactor = fgalpha; sfactor += sfactor >> 7; // 255 -> 256
+						uint32_t dfactor = 256 - sfactor;
+						uint32_t src_r = RPART(src) * sfactor;
+						uint32_t src_g = GPART(src) * sfactor;
+						uint32_t src_b = BPART(src) * sfactor;
+						uint32_t dest_r = RPART(dest);
+						uint32_t dest_g = GPART(dest);
+						uint32_t dest_b = BPART(dest);
+						if (ModeT::BlendDest == STYLEALPHA_One)
+						{
+							dest_r <<= 8;
+							dest_g <<= 8;
+							dest_b <<= 8;
+						}
+						else
+						{
+							uint32_t dfactor = 256 - sfactor;
+							dest_r *= dfactor;
+							dest_g *= dfactor;
+							dest_b *= dfactor;
+						}
+
+						uint32_t out_r, out_g, out_b;
+						if (ModeT::BlendOp == STYLEOP_Add)
+						{
+							if (ModeT::BlendDest == STYLEALPHA_One)
+							{
+								out_r = MIN<int32_t>((dest_r + src_r + 128) >> 8, 255);
+								out_g = MIN<int32_t>((dest_g + src_g + 128) >> 8, 255);
+								out_b = MIN<int32_t>((dest_b + src_b + 128) >> 8, 255);
+							}
+							else
+							{
+								out_r = (dest_r + src_r + 128) >> 8;
+								out_g = (dest_g + src_g + 128) >> 8;
+								out_b = (dest_b + src_b + 128) >> 8;
+							}
+						}
+						else if (ModeT::BlendOp == STYLEOP_RevSub)
+						{
+							out_r = MAX<int32_t>(static_cast<int32_t>(dest_r - src_r + 128) >> 8, 0);
+							out_g = MAX<int32_t>(static_cast<int32_t>(dest_g - src_g + 128) >> 8, 0);
+							out_b = MAX<int32_t>(static_cast<int32_t>(dest_b - src_b + 128) >> 8, 0);
+						}
+						else //if (ModeT::BlendOp == STYLEOP_Sub)
+						{
+							out_r = MAX<int32_t>(static_cast<int32_t>(src_r - dest_r + 128) >> 8, 0);
+							out_g = MAX<int32_t>(static_cast<int32_t>(src_g - dest_g + 128) >> 8, 0);
+							out_b = MAX<int32_t>(static_cast<int32_t>(src_b - dest_b + 128) >> 8, 0);
+						}
+
+						destLine[x] = RGB256k.All[((out_r >> 2) << 12) | ((out_g >> 2) << 6) | (out_b >> 2)];
+					}
 				}
-			}
 
-			posU += stepU;
+				posU += stepU;
+			}
 		}
-	}
+	});
 }
 
 template<typename ModeT, typename OptT>
@@ -1884,225 +2050,223 @@ void DrawRectOpt32(const void *destOrg, int destWidth, int destHeight, int destP
 	uint32_t stepU = (int32_t)(fstepU * 0x1000000);
 	uint32_t stepV = (int32_t)(fstepV * 0x1000000);
 
-	uint32_t posV = startV;
-	y1 = MIN(y1, thread->numa_end_y);
-	int num_cores = thread->num_cores;
-	int skip = thread->skipped_by_thread(y0);
-	posV += skip * stepV;
-	stepV *= num_cores;
-	for (int y = y0 + skip; y < y1; y += num_cores, posV += stepV)
+	thread->ForEachOwnedRegion(x0, y0, x1, y1, [&](int rx0, int ry0, int rx1, int ry1, int ystep)
 	{
-		uint32_t *destLine = ((uint32_t*)destOrg) + y * destPitch;
-
-		uint32_t posU = startU;
-		for (int x = x0; x < x1; x++)
+		uint32_t posV = startV + (ry0 - y0) * stepV;
+		for (int y = ry0; y < ry1; y += ystep, posV += stepV * ystep)
 		{
-			if (ModeT::BlendOp == STYLEOP_Fuzz)
-			{
-				using namespace swrenderer;
+			uint32_t *destLine = ((uint32_t*)destOrg) + y * destPitch;
 
-				uint32_t texelX = (((posU << 8) >> 16) * texWidth) >> 16;
-				uint32_t texelY = (((posV << 8) >> 16) * texHeight) >> 16;
-				unsigned int sampleshadeout = APART(texPixels[texelX * texHeight + texelY]);
-				sampleshadeout += sampleshadeout >> 7; // 255 -> 256
+			uint32_t posU = startU + (rx0 - x0) * stepU;
+			for (int x = rx0; x < rx1; x++)
+			{
+				if (ModeT::BlendOp == STYLEOP_Fuzz)
+				{
+					using namespace swrenderer;
 
-				int scaled_x = (x * fuzzscale) >> FRACBITS;
-				int fuzz_x = fuzz_random_x_offset[scaled_x % FUZZ_RANDOM_X_SIZE] + _fuzzpos;
+					uint32_t texelX = (((posU << 8) >> 16) * texWidth) >> 16;
+					uint32_t texelY = (((posV << 8) >> 16) * texHeight) >> 16;
+					unsigned int sampleshadeout = APART(texPixels[texelX * texHeight + texelY]);
+					sampleshadeout += sampleshadeout >> 7; // 255 -> 256
 
-				fixed_t fuzzcount = FUZZTABLE << FRACBITS;
-				fixed_t fuzz = ((fuzz_x << FRACBITS) + y * fuzzscale) % fuzzcount;
-				unsigned int alpha = fuzzoffset[fuzz >> FRACBITS];
+					int scaled_x = (x * fuzzscale) >> FRACBITS;
+					int fuzz_x = fuzz_random_x_offset[scaled_x % FUZZ_RANDOM_X_SIZE] + _fuzzpos;
 
-				sampleshadeout = (sampleshadeout * alpha) >> 5;
+					fixed_t fuzzcount = FUZZTABLE << FRACBITS;
+					fixed_t fuzz = ((fuzz_x << FRACBITS) + y * fuzzscale) % fuzzcount;
+					unsigned int alpha = fuzzoffset[fuzz >> FRACBITS];
 
-				uint32_t a = 256 - sampleshadeout;
+					sampleshadeout = (sampleshadeout * alpha) >> 5;
 
-				uint32_t dest = destLine[x];
-				uint32_t out_r = (RPART(dest) * a) >> 8;
-				uint32_t out_g = (GPART(dest) * a) >> 8;
-				uint32_t out_b = (BPART(dest) * a) >> 8;
-				destLine[x] = MAKEARGB(255, out_r, out_g, out_b);
-			}
-			else
-			{
-				uint32_t fg = 0;
+					uint32_t a = 256 - sampleshadeout;
 
-				if (ModeT::SWFlags & SWSTYLEF_Fill)
-				{
-					fg = fillcolor;
-				}
-				else if (ModeT::SWFlags & SWSTYLEF_FogBoundary)
-				{
-					fg = destLine[x];
+					uint32_t dest = destLine[x];
+					uint32_t out_r = (RPART(dest) * a) >> 8;
+					uint32_t out_g = (GPART(dest) * a) >> 8;
+					uint32_t out_b = (BPART(dest) * a) >> 8;
+					destLine[x] = MAKEARGB(255, out_r, out_g, out_b);
 				}
 				else
 				{
-					uint32_t texelX = (((posU << 8) >> 16) * texWidth) >> 16;
-					uint32_t texelY = (((posV << 8) >> 16) * texHeight) >> 16;
+					uint32_t fg = 0;
 
-					if (ModeT::SWFlags & SWSTYLEF_Translated)
+					if (ModeT::SWFlags & SWSTYLEF_Fill)
 					{
-						fg = translation[((const uint8_t*)texPixels)[texelX * texHeight + texelY]];
+						fg = fillcolor;
 					}
-					else if (ModeT::Flags & STYLEF_RedIsAlpha)
+					else if (ModeT::SWFlags & SWSTYLEF_FogBoundary)
 					{
-						fg = ((const uint8_t*)texPixels)[texelX * texHeight + texelY];
+						fg = destLine[x];
 					}
 					else
 					{
-						fg = texPixels[texelX * texHeight + texelY];
-					}
-				}
-
-				if ((ModeT::Flags & STYLEF_ColorIsFixed) && !(ModeT::SWFlags & SWSTYLEF_Fill))
-				{
-					if (ModeT::Flags & STYLEF_RedIsAlpha)
-						fg = (fg << 24) | (fillcolor & 0x00ffffff);
-					else
-						fg = (fg & 0xff000000) | (fillcolor & 0x00ffffff);
-				}
-
-				uint32_t fgalpha = fg >> 24;
-
-				if (!(ModeT::Flags & STYLEF_Alpha1))
-				{
-					fgalpha = (fgalpha * alpha) >> 8;
-				}
+						uint32_t texelX = (((posU << 8) >> 16) * texWidth) >> 16;
+						uint32_t texelY = (((posV << 8) >> 16) * texHeight) >> 16;
 
-				int lightshade = light;
-
-				uint32_t lit_r = 0, lit_g = 0, lit_b = 0;
-
-				uint32_t shadedfg_r, shadedfg_g, shadedfg_b;
-				if (OptT::Flags & SWOPT_ColoredFog)
-				{
-					uint32_t fg_r = RPART(fg);
-					uint32_t fg_g = GPART(fg);
-					uint32_t fg_b = BPART(fg);
-					uint32_t intensity = ((fg_r * 77 + fg_g * 143 + fg_b * 37) >> 8) * desaturate;
-					shadedfg_r = (((shade_fade_r + ((fg_r * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_r) >> 8;
-					shadedfg_g = (((shade_fade_g + ((fg_g * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_g) >> 8;
-					shadedfg_b = (((shade_fade_b + ((fg_b * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_b) >> 8;
-				}
-				else
-				{
-					shadedfg_r = (RPART(fg) * lightshade) >> 8;
-					shadedfg_g = (GPART(fg) * lightshade) >> 8;
-					shadedfg_b = (BPART(fg) * lightshade) >> 8;
-				}
-
-				if (ModeT::BlendSrc == STYLEALPHA_One && ModeT::BlendDest == STYLEALPHA_Zero)
-				{
-					destLine[x] = MAKEARGB(255, shadedfg_r, shadedfg_g, shadedfg_b);
-				}
-				else if (ModeT::BlendSrc == STYLEALPHA_One && ModeT::BlendDest == STYLEALPHA_One)
-				{
-					uint32_t dest = destLine[x];
-
-					if (ModeT::BlendOp == STYLEOP_Add)
-					{
-						uint32_t out_r = MIN<uint32_t>(RPART(dest) + shadedfg_r, 255);
-						uint32_t out_g = MIN<uint32_t>(GPART(dest) + shadedfg_g, 255);
-						uint32_t out_b = MIN<uint32_t>(BPART(dest) + shadedfg_b, 255);
-						destLine[x] = MAKEARGB(255, out_r, out_g, out_b);
+						if (ModeT::SWFlags & SWSTYLEF_Translated)
+						{
+							fg = translation[((const uint8_t*)texPixels)[texelX * texHeight + texelY]];
+						}
+						else if (ModeT::Flags & STYLEF_RedIsAlpha)
+						{
+							fg = ((const uint8_t*)texPixels)[texelX * texHeight + texelY];
+						}
+						else
+						{
+							fg = texPixels[texelX * texHeight + texelY];
+						}
 					}
-					else if (ModeT::BlendOp == STYLEOP_RevSub)
+
+					if ((ModeT::Flags & STYLEF_ColorIsFixed) && !(ModeT::SWFlags & SWSTYLEF_Fill))
 					{
-						uint32_t out_r = MAX<uint32_t>(RPART(dest) - shadedfg_r, 0);
-						uint32_t out_g = MAX<uint32_t>(GPART(dest) - shadedfg_g, 0);
-						uint32_t out_b = MAX<uint32_t>(BPART(dest) - shadedfg_b, 0);
-						destLine[x] = MAKEARGB(255, out_r, out_g, out_b);
+						if (ModeT::Flags & STYLEF_RedIsAlpha)
+							fg = (fg << 24) | (fillcolor & 0x00ffffff);
+						else
+							fg = (fg & 0xff000000) | (fillcolor & 0x00ffffff);
 					}
-					else //if (ModeT::BlendOp == STYLEOP_Sub)
+
+					uint32_t fgalpha = fg >> 24;
+
+					if (!(ModeT::Flags & STYLEF_Alpha1))
 					{
-						uint32_t out_r = MAX<uint32_t>(shadedfg_r - RPART(dest), 0);
-						uint32_t out_g = MAX<uint32_t>(shadedfg_g - GPART(dest), 0);
-						uint32_t out_b = MAX<uint32_t>(shadedfg_b - BPART(dest), 0);
-						destLine[x] = MAKEARGB(255, out_r, out_g, out_b);
+						fgalpha = (fgalpha * alpha) >> 8;
 					}
-				}
-				else if (ModeT::SWFlags & SWSTYLEF_SrcColorOneMinusSrcColor)
-				{
-					uint32_t dest = destLine[x];
 
-					uint32_t sfactor_r = shadedfg_r; sfactor_r += sfactor_r >> 7; // 255 -> 256
-					uint32_t sfactor_g = shadedfg_g; sfactor_g += sfactor_g >> 7; // 255 -> 256
-					uint32_t sfactor_b = shadedfg_b; sfactor_b += sfactor_b >> 7; // 255 -> 256
-					uint32_t sfactor_a = fgalpha; sfactor_a += sfactor_a >> 7; // 255 -> 256
-					uint32_t dfactor_r = 256 - sfactor_r;
-					uint32_t dfactor_g = 256 - sfactor_g;
-					uint32_t dfactor_b = 256 - sfactor_b;
-					uint32_t out_r = (RPART(dest) * dfactor_r + shadedfg_r * sfactor_r + 128) >> 8;
-					uint32_t out_g = (GPART(dest) * dfactor_g + shadedfg_g * sfactor_g + 128) >> 8;
-					uint32_t out_b = (BPART(dest) * dfactor_b + shadedfg_b * sfactor_b + 128) >> 8;
+					int lightshade = light;
 
-					destLine[x] = MAKEARGB(255, out_r, out_g, out_b);
-				}
-				else if (ModeT::BlendSrc == STYLEALPHA_Src && ModeT::BlendDest == STYLEALPHA_InvSrc && fgalpha == 255)
-				{
-					destLine[x] = MAKEARGB(255, shadedfg_r, shadedfg_g, shadedfg_b);
-				}
-				else if (ModeT::BlendSrc != STYLEALPHA_Src || ModeT::BlendDest != STYLEALPHA_InvSrc || fgalpha != 0)
-				{
-					uint32_t dest = destLine[x];
+					uint32_t lit_r = 0, lit_g = 0, lit_b = 0;
 
-					uint32_t sfactor = fgalpha; sfactor += sfactor >> 7; // 255 -> 256
-					uint32_t src_r = shadedfg_r * sfactor;
-					uint32_t src_g = shadedfg_g * sfactor;
-					uint32_t src_b = shadedfg_b * sfactor;
-					uint32_t dest_r = RPART(dest);
-					uint32_t dest_g = GPART(dest);
-					uint32_t dest_b = BPART(dest);
-					if (ModeT::BlendDest == STYLEALPHA_One)
+					uint32_t shadedfg_r, shadedfg_g, shadedfg_b;
+					if (OptT::Flags & SWOPT_ColoredFog)
 					{
-						dest_r <<= 8;
-						dest_g <<= 8;
-						dest_b <<= 8;
+						uint32_t fg_r = RPART(fg);
+						uint32_t fg_g = GPART(fg);
+						uint32_t fg_b = BPART(fg);
+						uint32_t intensity = ((fg_r * 77 + fg_g * 143 + fg_b * 37) >> 8) * desaturate;
+						shadedfg_r = (((shade_fade_r + ((fg_r * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_r) >> 8;
+						shadedfg_g = (((shade_fade_g + ((fg_g * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_g) >> 8;
+						shadedfg_b = (((shade_fade_b + ((fg_b * inv_desaturate + intensity) >> 8) * lightshade) >> 8) * shade_light_b) >> 8;
 					}
 					else
 					{
-						uint32_t dfactor = 256 - sfactor;
-						dest_r *= dfactor;
-						dest_g *= dfactor;
-						dest_b *= dfactor;
+						shadedfg_r = (RPART(fg) * lightshade) >> 8;
+						shadedfg_g = (GPART(fg) * lightshade) >> 8;
+						shadedfg_b = (BPART(fg) * lightshade) >> 8;
 					}
 
-					uint32_t out_r, out_g, out_b;
-					if (ModeT::BlendOp == STYLEOP_Add)
+					if (ModeT::BlendSrc == STYLEALPHA_One && ModeT::BlendDest == STYLEALPHA_Zero)
 					{
-						if (ModeT::BlendDest == STYLEALPHA_One)
+						destLine[x] = MAKEARGB(255, shadedfg_r, shadedfg_g, shadedfg_b);
+					}
+					else if (ModeT::BlendSrc == STYLEALPHA_One && ModeT::BlendDest == STYLEALPHA_One)
+					{
+						uint32_t dest = destLine[x];
+
+						if (ModeT::BlendOp == STYLEOP_Add)
 						{
-							out_r = MIN<int32_t>((dest_r + src_r + 128) >> 8, 255);
-							out_g = MIN<int32_t>((dest_g + src_g + 128) >> 8, 255);
-							out_b = MIN<int32_t>((dest_b + src_b + 128) >> 8, 255);
+							uint32_t out_r = MIN<uint32_t>(RPART(dest) + shadedfg_r, 255);
+							uint32_t out_g = MIN<uint32_t>(GPART(dest) + shadedfg_g, 255);
+							uint32_t out_b = MIN<uint32_t>(BPART(dest) + shadedfg_b, 255);
+							destLine[x] = MAKEARGB(255, out_r, out_g, out_b);
 						}
-						else
+						else if (ModeT::BlendOp == STYLEOP_RevSub)
 						{
-							out_r = (dest_r + src_r + 128) >> 8;
-							out_g = (dest_g + src_g + 128) >> 8;
-							out_b = (dest_b + src_b + 128) >> 8;
+							uint32_t out_r = MAX<uint32_t>(RPART(dest) - shadedfg_r, 0);
+							uint32_t out_g = MAX<uint32_t>(GPART(dest) - shadedfg_g, 0);
+							uint32_t out_b = MAX<uint32_t>(BPART(dest) - shadedfg_b, 0);
+							destLine[x] = MAKEARGB(255, out_r, out_g, out_b);
+						}
+						else //if (ModeT::BlendOp == STYLEOP_Sub)
+						{
+							uint32_t out_r = MAX<uint32_t>(shadedfg_r - RPART(dest), 0);
+							uint32_t out_g = MAX<uint32_t>(shadedfg_g - GPART(dest), 0);
+							uint32_t out_b = MAX<uint32_t>(shadedfg_b - BPART(dest), 0);
+							destLine[x] = MAKEARGB(255, out_r, out_g, out_b);
 						}
 					}
-					else if (ModeT::BlendOp == STYLEOP_RevSub)
+					else if (ModeT::SWFlags & SWSTYLEF_SrcColorOneMinusSrcColor)
 					{
-						out_r = MAX<int32_t>(static_cast<int32_t>(dest_r - src_r + 128) >> 8, 0);
-						out_g = MAX<int32_t>(static_cast<int32_t>(dest_g - src_g + 128) >> 8, 0);
-						out_b = MAX<int32_t>(static_cast<int32_t>(dest_b - src_b + 128) >> 8, 0);
+						uint32_t dest = destLine[x];
+
+						uint32_t sfactor_r = shadedfg_r; sfactor_r += sfactor_r >> 7; // 255 -> 256
+						uint32_t sfactor_g = shadedfg_g; sfactor_g += sfactor_g >> 7; // 255 -> 256
+						uint32_t sfactor_b = shadedfg_b; sfactor_b += sfactor_b >> 7; // 255 -> 256
+						uint32_t sfactor_a = fgalpha; sfactor_a += sfactor_a >> 7; // 255 -> 256
+						uint32_t dfactor_r = 256 - sfactor_r;
+						uint32_t dfactor_g = 256 - sfactor_g;
+						uint32_t dfactor_b = 256 - sfactor_b;
+						uint32_t out_r = (RPART(dest) * dfactor_r + shadedfg_r * sfactor_r + 128) >> 8;
+						uint32_t out_g = (GPART(dest) * dfactor_g + shadedfg_g * sfactor_g + 128) >> 8;
+						uint32_t out_b = (BPART(dest) * dfactor_b + shadedfg_b * sfactor_b + 128) >> 8;
+
+						destLine[x] = MAKEARGB(255, out_r, out_g, out_b);
 					}
-					else //if (ModeT::BlendOp == STYLEOP_Sub)
+					else if (ModeT::BlendSrc == STYLEALPHA_Src && ModeT::BlendDest == STYLEALPHA_InvSrc && fgalpha == 255)
 					{
-						out_r = MAX<int32_t>(static_cast<int32_t>(src_r - dest_r + 128) >> 8, 0);
-						out_g = MAX<int32_t>(static_cast<int32_t>(src_g - dest_g + 128) >> 8, 0);
-						out_b = MAX<int32_t>(static_cast<int32_t>(src_b - dest_b + 128) >> 8, 0);
+						destLine[x] = MAKEARGB(255, shadedfg_r, shadedfg_g, shadedfg_b);
 					}
+					else if (ModeT::BlendSrc != STYLEALPHA_Src || ModeT::BlendDest != STYLEALPHA_InvSrc || fgalpha != 0)
+					{
+						uint32_t dest = destLine[x];
+
+						uint32_t sfactor = fgalpha; sfactor += sfactor >> 7; // 255 -> 256
+						uint32_t src_r = shadedfg_r * sfactor;
+						uint32_t src_g = shadedfg_g * sfactor;
+						uint32_t src_b = shadedfg_b * sfactor;
+						uint32_t dest_r = RPART(dest);
+						uint32_t dest_g = GPART(dest);
+						uint32_t dest_b = BPART(dest);
+						if (ModeT::BlendDest == STYLEALPHA_One)
+						{
+							dest_r <<= 8;
+							dest_g <<= 8;
+							dest_b <<= 8;
+						}
+						else
+						{
+							uint32_t dfactor = 256 - sfactor;
+							dest_r *= dfactor;
+							dest_g *= dfactor;
+							dest_b *= dfactor;
+						}
 
-					destLine[x] = MAKEARGB(255, out_r, out_g, out_b);
+						uint32_t out_r, out_g, out_b;
+						if (ModeT::BlendOp == STYLEOP_Add)
+						{
+							if (ModeT::BlendDest == STYLEALPHA_One)
+							{
+								out_r = MIN<int32_t>((dest_r + src_r + 128) >> 8, 255);
+								out_g = MIN<int32_t>((dest_g + src_g + 128) >> 8, 255);
+								out_b = MIN<int32_t>((dest_b + src_b + 128) >> 8, 255);
+							}
+							else
+							{
+								out_r = (dest_r + src_r + 128) >> 8;
+								out_g = (dest_g + src_g + 128) >> 8;
+								out_b = (dest_b + src_b + 128) >> 8;
+							}
+						}
+						else if (ModeT::BlendOp == STYLEOP_RevSub)
+						{
+							out_r = MAX<int32_t>(static_cast<int32_t>(dest_r - src_r + 128) >> 8, 0);
+							out_g = MAX<int32_t>(static_cast<int32_t>(dest_g - src_g + 128) >> 8, 0);
+							out_b = MAX<int32_t>(static_cast<int32_t>(dest_b - src_b + 128) >> 8, 0);
+						}
+						else //if (ModeT::BlendOp == STYLEOP_Sub)
+						{
+							out_r = MAX<int32_t>(static_cast<int32_t>(src_r - dest_r + 128) >> 8, 0);
+							out_g = MAX<int32_t>(static_cast<int32_t>(src_g - dest_g + 128) >> 8, 0);
+							out_b = MAX<int32_t>(static_cast<int32_t>(src_b - dest_b + 128) >> 8, 0);
+						}
+
+						destLine[x] = MAKEARGB(255, out_r, out_g, out_b);
+					}
 				}
-			}
 
-			posU += stepU;
+				posU += stepU;
+			}
 		}
-	}
+	});
 }
 
 template<typename ModeT>
@@ -2244,7 +2408,7 @@ void(*ScreenTriangle::RectDrawers32[])(const void *, int, int, int, const RectDr
 	&DrawRect32<TriScreenDrawerModes::StyleAddShadedTranslated>
 };
 
-void(*ScreenTriangle::TriangleDrawers[])(const TriDrawTriangleArgs *args, PolyTriangleThreadData *thread, int16_t *edges, int topY, int bottomY) =
+void(*ScreenTriangle::TriangleDrawers[])(const TriDrawTriangleArgs *args, PolyTriangleThreadData *thread, int16_t *edges, int topY, int bottomY, int ystep) =
 {
 	nullptr,
 	nullptr,
@@ -131,9 +131,9 @@ enum class TriBlendMode
 class ScreenTriangle
 {
 public:
-	static void Draw(const TriDrawTriangleArgs *args, PolyTriangleThreadData *thread);
+	static void Draw(TriDrawTriangleArgs *args, PolyTriangleThreadData *thread);
 
-	static void(*TriangleDrawers[])(const TriDrawTriangleArgs *args, PolyTriangleThreadData *thread, int16_t *edges, int topY, int bottomY);
+	static void(*TriangleDrawers[])(const TriDrawTriangleArgs *args, PolyTriangleThreadData *thread, int16_t *edges, int topY, int bottomY, int ystep);
 
 	static void(*SpanDrawers8[])(int y, int x0, int x1, const TriDrawTriangleArgs *args, PolyTriangleThreadData *thread);
 	static void(*SpanDrawers32[])(int y, int x0, int x1, const TriDrawTriangleArgs *args, PolyTriangleThreadData *thread);
@@ -189,7 +189,8 @@ namespace TriScreenDrawerModes
 	{
 		SWOPT_DynLights = 1,
 		SWOPT_ColoredFog = 2,
-		SWOPT_FixedLight = 4
+		SWOPT_FixedLight = 4,
+		SWOPT_LightRamp = 8
 	};
 
 	struct DrawerOpt { static const int Flags = 0; };
@@ -200,6 +201,10 @@ namespace TriScreenDrawerModes
 	struct DrawerOptLC { static const int Flags = SWOPT_DynLights | SWOPT_ColoredFog; };
 	struct DrawerOptLF { static const int Flags = SWOPT_DynLights | SWOPT_FixedLight; };
 	struct DrawerOptLCF { static const int Flags = SWOPT_DynLights | SWOPT_ColoredFog | SWOPT_FixedLight; };
+	struct DrawerOptCR { static const int Flags = SWOPT_ColoredFog | SWOPT_LightRamp; };
+	struct DrawerOptCFR { static const int Flags = SWOPT_ColoredFog | SWOPT_FixedLight | SWOPT_LightRamp; };
+	struct DrawerOptLCR { static const int Flags = SWOPT_DynLights | SWOPT_ColoredFog | SWOPT_LightRamp; };
+	struct DrawerOptLCFR { static const int Flags = SWOPT_DynLights | SWOPT_ColoredFog | SWOPT_FixedLight | SWOPT_LightRamp; };
 
 	static const int fuzzcolormap[FUZZTABLE] =
 	{
@@ -45,6 +45,8 @@ EXTERN_CVAR(Int, screenblocks)
 EXTERN_CVAR(Float, r_visibility)
 EXTERN_CVAR(Bool, r_models)
 
+CVAR(Bool, r_poly_tilebinning, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
 extern bool r_modelscene;
 
 /////////////////////////////////////////////////////////////////////////////
@@ -73,7 +75,7 @@ void PolyRenderer::RenderView(player_t *player, DCanvas *target, void *videobuff
 	Threads.MainThread()->FlushDrawQueue();
 
 	auto copyqueue = std::make_shared<DrawerCommandQueue>(Threads.MainThread()->FrameMemory.get());
-	copyqueue->Push<MemcpyCommand>(videobuffer, target->GetPixels(), target->GetWidth(), target->GetHeight(), target->GetPitch(), target->IsBgra() ? 4 : 1);
+	copyqueue->Push<PolyMemcpyCommand>(videobuffer, target->GetPixels(), target->GetWidth(), target->GetHeight(), target->GetPitch(), target->IsBgra() ? 4 : 1);
 	DrawerThreads::Execute(copyqueue);
 
 	PolyDrawerWaitCycles.Clock();
@@ -104,7 +106,9 @@ void PolyRenderer::RenderViewToCanvas(AActor *actor, DCanvas *canvas, int x, int
 	// Render:
 	RenderActorView(actor, false, dontmaplines);
 	Threads.MainThread()->FlushDrawQueue();
+	PolyDrawerWaitCycles.Clock();
 	DrawerThreads::WaitForWorkers();
+	PolyDrawerWaitCycles.Unclock();
 
 	RenderToCanvas = false;
 
@@ -172,6 +176,7 @@ void PolyRenderer::RenderActorView(AActor *actor, bool drawpsprites, bool dontma
 	Threads.MainThread()->TranslucentObjects.clear();
 
 	PolyTriangleDrawer::ResizeBuffers(RenderTarget);
+	PolyTriangleDrawer::SetTileBinning(Threads.MainThread()->DrawQueue, r_poly_tilebinning);
 	PolyTriangleDrawer::ClearStencil(Threads.MainThread()->DrawQueue, 0);
 	SetSceneViewport();
 
@@ -48,7 +48,8 @@ EXTERN_CVAR(Int, r_scene_multithreaded);
 
 PolyRenderThread::PolyRenderThread(int threadIndex) : MainThread(threadIndex == 0), ThreadIndex(threadIndex)
 {
-	FrameMemory.reset(new RenderMemory());
+	FrameMemory.reset(new RenderMemory("polyrenderer"));
+	ModelFrames.reset(new PolyModelFrameCache(FrameMemory.get()));
 	DrawQueue = std::make_shared<DrawerCommandQueue>(FrameMemory.get());
 }
 
@@ -130,9 +131,11 @@ PolyRenderThreads::~PolyRenderThreads()
 
 void PolyRenderThreads::Clear()
 {
+	PolyModelFrameCache::NewFrame();
 	for (auto &thread : Threads)
 	{
 		thread->FrameMemory->Clear();
+		thread->ModelFrames->Clear();
 		thread->DrawQueue->Clear();
 		
 		while (!thread->UsedDrawQueues.empty())
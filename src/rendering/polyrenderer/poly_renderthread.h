@@ -28,6 +28,7 @@
 
 class DrawerCommandQueue;
 typedef std::shared_ptr<DrawerCommandQueue> DrawerCommandQueuePtr;
+class PolyModelFrameCache;
 class RenderMemory;
 class PolyTranslucentObject;
 class PolyDrawSectorPortal;
@@ -48,6 +49,7 @@ public:
 	int ThreadIndex = 0;
 
 	std::unique_ptr<RenderMemory> FrameMemory;
+	std::unique_ptr<PolyModelFrameCache> ModelFrames;
 	DrawerCommandQueuePtr DrawQueue;
 
 	std::vector<PolyTranslucentObject *> TranslucentObjects;
@@ -316,5 +316,10 @@ void PolyModelVertexBuffer::SetupFrame(FModelRenderer *renderer, unsigned int fr
 	PolyModelRenderer *polyrenderer = (PolyModelRenderer *)renderer;
 	polyrenderer->VertexBuffer = mVertexBuffer.Size() ? &mVertexBuffer[0] : nullptr;
 	polyrenderer->IndexBuffer = mIndexBuffer.Size() ? &mIndexBuffer[0] : nullptr;
+	if (frame1 != frame2 && polyrenderer->InterpolationFactor != 0.f && polyrenderer->VertexBuffer && size > 0)
+	{
+		polyrenderer->VertexBuffer = polyrenderer->Thread->ModelFrames->GetFrame(polyrenderer->VertexBuffer, frame1, frame2, size, polyrenderer->InterpolationFactor);
+		frame1 = frame2 = 0;
+	}
 	PolyTriangleDrawer::SetModelVertexShader(polyrenderer->Thread->DrawQueue, frame1, frame2, polyrenderer->InterpolationFactor);
 }
@@ -59,12 +59,17 @@
 #include "r_draw_sprite32_sse2.h"
 #include "r_draw_span32_sse2.h"
 #include "r_draw_sky32_sse2.h"
+#include "r_draw_wall32_avx2.h"
+#include "r_draw_span32_avx2.h"
 #endif
 
 #include "gi.h"
 #include "stats.h"
 #include "x86.h"
+#include "c_dispatch.h"
+#include "swrenderer/r_swcolormaps.h"
 #include <vector>
+#include <chrono>
 
 // Use linear filtering when scaling up
 CVAR(Bool, r_magfilter, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
@@ -78,36 +83,70 @@ CVAR(Bool, r_mipmap, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 // Level of detail texture bias
 CVAR(Float, r_lod_bias, -1.5, 0); // To do: add CVAR_ARCHIVE | CVAR_GLOBALCONFIG when a good default has been decided
 
+// Use the AVX2 wall and span drawers when the CPU supports them
+CVAR(Bool, r_drawers_avx2, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
+
 namespace swrenderer
 {
+#ifdef NO_SSE
+	// There are no AVX2 drawers without SSE; fall back to the scalar commands
+	typedef DrawWall32Command DrawWall32AVX2Command;
+	typedef DrawWallMasked32Command DrawWallMasked32AVX2Command;
+	typedef DrawWallAddClamp32Command DrawWallAddClamp32AVX2Command;
+	typedef DrawWallSubClamp32Command DrawWallSubClamp32AVX2Command;
+	typedef DrawWallRevSubClamp32Command DrawWallRevSubClamp32AVX2Command;
+	typedef DrawSpan32Command DrawSpan32AVX2Command;
+	typedef DrawSpanMasked32Command DrawSpanMasked32AVX2Command;
+	typedef DrawSpanTranslucent32Command DrawSpanTranslucent32AVX2Command;
+	typedef DrawSpanAddClamp32Command DrawSpanAddClamp32AVX2Command;
+#endif
+
+	static bool UseAVX2Drawers()
+	{
+#ifdef NO_SSE
+		return false;
+#else
+		return CPU.bAVX2 && r_drawers_avx2;
+#endif
+	}
+
+	template<typename CommandT, typename AVX2CommandT, typename ArgsT>
+	static void PushVectorCommand(const DrawerCommandQueuePtr &queue, const ArgsT &args)
+	{
+		if (UseAVX2Drawers())
+			queue->Push<AVX2CommandT>(args);
+		else
+			queue->Push<CommandT>(args);
+	}
+
 	void SWTruecolorDrawers::DrawWallColumn(const WallDrawerArgs &args)
 	{
-		Queue->Push<DrawWall32Command>(args);
+		PushVectorCommand<DrawWall32Command, DrawWall32AVX2Command>(Queue, args);
 	}
 	
 	void SWTruecolorDrawers::DrawWallMaskedColumn(const WallDrawerArgs &args)
 	{
-		Queue->Push<DrawWallMasked32Command>(args);
+		PushVectorCommand<DrawWallMasked32Command, DrawWallMasked32AVX2Command>(Queue, args);
 	}
 	
 	void SWTruecolorDrawers::DrawWallAddColumn(const WallDrawerArgs &args)
 	{
-		Queue->Push<DrawWallAddClamp32Command>(args);
+		PushVectorCommand<DrawWallAddClamp32Command, DrawWallAddClamp32AVX2Command>(Queue, args);
 	}
 	
 	void SWTruecolorDrawers::DrawWallAddClampColumn(const WallDrawerArgs &args)
 	{
-		Queue->Push<DrawWallAddClamp32Command>(args);
+		PushVectorCommand<DrawWallAddClamp32Command, DrawWallAddClamp32AVX2Command>(Queue, args);
 	}
 	
 	void SWTruecolorDrawers::DrawWallSubClampColumn(const WallDrawerArgs &args)
 	{
-		Queue->Push<DrawWallSubClamp32Command>(args);
+		PushVectorCommand<DrawWallSubClamp32Command, DrawWallSubClamp32AVX2Command>(Queue, args);
 	}
 	
 	void SWTruecolorDrawers::DrawWallRevSubClampColumn(const WallDrawerArgs &args)
 	{
-		Queue->Push<DrawWallRevSubClamp32Command>(args);
+		PushVectorCommand<DrawWallRevSubClamp32Command, DrawWallRevSubClamp32AVX2Command>(Queue, args);
 	}
 	
 	void SWTruecolorDrawers::DrawColumn(const SpriteDrawerArgs &args)
@@ -211,32 +250,32 @@ namespace swrenderer
 
 	void SWTruecolorDrawers::DrawSpan(const SpanDrawerArgs &args)
 	{
-		Queue->Push<DrawSpan32Command>(args);
+		PushVectorCommand<DrawSpan32Command, DrawSpan32AVX2Command>(Queue, args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanMasked(const SpanDrawerArgs &args)
 	{
-		Queue->Push<DrawSpanMasked32Command>(args);
+		PushVectorCommand<DrawSpanMasked32Command, DrawSpanMasked32AVX2Command>(Queue, args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanTranslucent(const SpanDrawerArgs &args)
 	{
-		Queue->Push<DrawSpanTranslucent32Command>(args);
+		PushVectorCommand<DrawSpanTranslucent32Command, DrawSpanTranslucent32AVX2Command>(Queue, args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanMaskedTranslucent(const SpanDrawerArgs &args)
 	{
-		Queue->Push<DrawSpanAddClamp32Command>(args);
+		PushVectorCommand<DrawSpanAddClamp32Command, DrawSpanAddClamp32AVX2Command>(Queue, args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanAddClamp(const SpanDrawerArgs &args)
 	{
-		Queue->Push<DrawSpanTranslucent32Command>(args);
+		PushVectorCommand<DrawSpanTranslucent32Command, DrawSpanTranslucent32AVX2Command>(Queue, args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanMaskedAddClamp(const SpanDrawerArgs &args)
 	{
-		Queue->Push<DrawSpanAddClamp32Command>(args);
+		PushVectorCommand<DrawSpanAddClamp32Command, DrawSpanAddClamp32AVX2Command>(Queue, args);
 	}
 	
 	void SWTruecolorDrawers::DrawSingleSkyColumn(const SkyDrawerArgs &args)
@@ -476,6 +515,8 @@ namespace swrenderer
 		_line = drawerargs.Viewport()->GetDest(0, _y);
 		_light = drawerargs.Light();
 		_shade_constants = drawerargs.ColormapConstants();
+		if (!_shade_constants.simple_shade)
+			_shade_constants.ramp = LightRamp::Get(_shade_constants);
 	}
 
 	void DrawFogBoundaryLineRGBACommand::Execute(DrawerThread *thread)
@@ -494,6 +535,12 @@ namespace swrenderer
 
 		do
 		{
+			if (constants.ramp)
+			{
+				dest[x] = 0xff000000 | constants.ramp->Shade(dest[x], light);
+				continue;
+			}
+
 			uint32_t red = (dest[x] >> 16) & 0xff;
 			uint32_t green = (dest[x] >> 8) & 0xff;
 			uint32_t blue = dest[x] & 0xff;
@@ -538,6 +585,8 @@ namespace swrenderer
 		_dest = drawerargs.Viewport()->GetDest(_x1, _y);
 		_light = drawerargs.Light();
 		_shade_constants = drawerargs.ColormapConstants();
+		if (!_shade_constants.simple_shade)
+			_shade_constants.ramp = LightRamp::Get(_shade_constants);
 		_plane_sz = plane_sz;
 		_plane_su = plane_su;
 		_plane_sv = plane_sv;
@@ -932,3 +981,185 @@ namespace swrenderer
 		}
 	}
 }
+
+#ifndef NO_SSE
+
+//==========================================================================
+//
+// Runs the SSE2 and AVX2 versions of the wall and span drawers over the
+// same synthetic input, times them and checks that the output matches.
+//
+//==========================================================================
+
+namespace swrenderer
+{
+	struct DrawerBenchResult
+	{
+		double sse2 = 0.0;
+		double avx2 = 0.0;
+		int mismatches = 0;
+	};
+
+	template<typename SSE2CommandT, typename AVX2CommandT, typename ArgsT>
+	static DrawerBenchResult BenchDrawer(DCanvas &canvas, DrawerThread *thread, const TArray<ArgsT> &commands, int passes)
+	{
+		DrawerBenchResult result;
+		size_t bytes = (size_t)canvas.GetPitch() * canvas.GetHeight() * 4;
+		TArray<uint8_t> reference(bytes, true);
+
+		for (int variant = 0; variant < 2; variant++)
+		{
+			if (variant == 1 && !CPU.bAVX2)
+				break;
+
+			memset(canvas.GetPixels(), 0x40, bytes);
+			auto start = std::chrono::steady_clock::now();
+			for (int pass = 0; pass < passes; pass++)
+			{
+				for (unsigned i = 0; i < commands.Size(); i++)
+				{
+					if (variant == 0)
+					{
+						SSE2CommandT cmd(commands[i]);
+						cmd.Execute(thread);
+					}
+					else
+					{
+						AVX2CommandT cmd(commands[i]);
+						cmd.Execute(thread);
+					}
+				}
+			}
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			if (variant == 0)
+			{
+				result.sse2 = ms;
+				memcpy(reference.Data(), canvas.GetPixels(), bytes);
+			}
+			else
+			{
+				result.avx2 = ms;
+				const uint32_t *a = (const uint32_t*)reference.Data();
+				const uint32_t *b = (const uint32_t*)canvas.GetPixels();
+				for (size_t i = 0; i < bytes / 4; i++)
+				{
+					if (a[i] != b[i]) result.mismatches++;
+				}
+			}
+		}
+		return result;
+	}
+
+	static void PrintDrawerBench(const char *name, const DrawerBenchResult &result)
+	{
+		if (result.avx2 > 0.0)
+		{
+			Printf("%-18s SSE2 %8.2f ms  AVX2 %8.2f ms  %5.2fx%s\n", name, result.sse2, result.avx2, result.sse2 / result.avx2,
+				result.mismatches ? FStringf("  (%d pixels differ)", result.mismatches).GetChars() : "");
+		}
+		else
+		{
+			Printf("%-18s SSE2 %8.2f ms\n", name, result.sse2);
+		}
+	}
+}
+
+CCMD(benchdrawers)
+{
+	using namespace swrenderer;
+
+	int passes = argv.argc() > 1 ? MAX(atoi(argv[1]), 1) : 20;
+	const int width = 640, height = 400;
+
+	DCanvas canvas(width, height, true);
+	RenderViewport viewport;
+	viewport.RenderTarget = &canvas;
+
+	// GetDest adds the view window offset
+	int savedx = viewwindowx, savedy = viewwindowy;
+	viewwindowx = viewwindowy = 0;
+
+	TArray<uint32_t> texels(128 * 128, true);
+	uint32_t seed = 0x12345678;
+	for (auto &texel : texels)
+	{
+		seed = seed * 1664525 + 1013904223;
+		texel = 0xff000000 | (seed >> 8);
+	}
+	// A few see-through texels to exercise the masked paths
+	for (unsigned i = 0; i < texels.Size(); i += 7)
+		texels[i] = 0;
+
+	auto makeWalls = [&](bool additive, fixed_t alpha)
+	{
+		TArray<WallDrawerArgs> walls;
+		for (int x = 0; x < width; x++)
+		{
+			WallDrawerArgs args;
+			args.SetStyle(false, additive, alpha, &NormalLight);
+			args.SetLight(0.0f, 8 << FRACBITS);
+			args.SetDest(&viewport, x, 0);
+			args.SetCount(height);
+			args.SetTexture((const uint8_t*)(texels.Data() + (x & 127) * 128), nullptr, 128);
+			args.SetTextureVPos(0);
+			args.SetTextureVStep(FRACUNIT / 3);
+			walls.Push(args);
+		}
+		return walls;
+	};
+
+	auto makeSpans = [&](bool masked, bool additive, fixed_t alpha, int texsize)
+	{
+		TArray<SpanDrawerArgs> spans;
+		for (int y = 0; y < height; y++)
+		{
+			SpanDrawerArgs args;
+			args.SetStyle(masked, additive, alpha, &NormalLight);
+			args.SetLight(0.0f, 8 << FRACBITS);
+			args.SetDestY(&viewport, y);
+			args.SetDestX1(0);
+			args.SetDestX2(width - 1);
+			args.SetTexture((const uint8_t*)texels.Data(), texsize, texsize, false);
+			args.SetTextureLOD(0.0);
+			args.SetTextureUPos(y / 400.0);
+			args.SetTextureVPos(0.0);
+			args.SetTextureUStep(0.0007);
+			args.SetTextureVStep(0.0031);
+			args.dc_normal = { 0.0f, 0.0f, 1.0f };
+			args.dc_viewpos = { 0.0f, 0.0f, 0.0f };
+			args.dc_viewpos_step = { 0.0f, 0.0f, 0.0f };
+			spans.Push(args);
+		}
+		return spans;
+	};
+
+	auto thread = std::make_unique<DrawerThread>();
+
+	if (!CPU.bAVX2)
+		Printf("This CPU does not support AVX2; only timing the SSE2 drawers.\n");
+	Printf("%d passes over a %dx%d canvas\n", passes, width, height);
+
+	auto opaqueWalls = makeWalls(false, OPAQUE);
+	auto addWalls = makeWalls(true, FRACUNIT / 2);
+	PrintDrawerBench("wall", BenchDrawer<DrawWall32Command, DrawWall32AVX2Command>(canvas, thread.get(), opaqueWalls, passes));
+	PrintDrawerBench("wall masked", BenchDrawer<DrawWallMasked32Command, DrawWallMasked32AVX2Command>(canvas, thread.get(), opaqueWalls, passes));
+	PrintDrawerBench("wall addclamp", BenchDrawer<DrawWallAddClamp32Command, DrawWallAddClamp32AVX2Command>(canvas, thread.get(), addWalls, passes));
+	PrintDrawerBench("wall subclamp", BenchDrawer<DrawWallSubClamp32Command, DrawWallSubClamp32AVX2Command>(canvas, thread.get(), addWalls, passes));
+
+	auto opaqueSpans = makeSpans(false, false, OPAQUE, 128);
+	auto spans64 = makeSpans(false, false, OPAQUE, 64);
+	auto maskedSpans = makeSpans(true, false, OPAQUE, 128);
+	auto transSpans = makeSpans(false, false, FRACUNIT / 2, 128);
+	auto addSpans = makeSpans(false, true, FRACUNIT / 2, 128);
+	PrintDrawerBench("span", BenchDrawer<DrawSpan32Command, DrawSpan32AVX2Command>(canvas, thread.get(), opaqueSpans, passes));
+	PrintDrawerBench("span 64x64", BenchDrawer<DrawSpan32Command, DrawSpan32AVX2Command>(canvas, thread.get(), spans64, passes));
+	PrintDrawerBench("span masked", BenchDrawer<DrawSpanMasked32Command, DrawSpanMasked32AVX2Command>(canvas, thread.get(), maskedSpans, passes));
+	PrintDrawerBench("span translucent", BenchDrawer<DrawSpanTranslucent32Command, DrawSpanTranslucent32AVX2Command>(canvas, thread.get(), transSpans, passes));
+	PrintDrawerBench("span addclamp", BenchDrawer<DrawSpanAddClamp32Command, DrawSpanAddClamp32AVX2Command>(canvas, thread.get(), addSpans, passes));
+
+	viewwindowx = savedx;
+	viewwindowy = savedy;
+}
+
+#endif
@@ -29,6 +29,7 @@
 #include "swrenderer/viewport/r_spandrawer.h"
 #include "swrenderer/viewport/r_walldrawer.h"
 #include "swrenderer/viewport/r_spritedrawer.h"
+#include "r_lightramp.h"
 
 #ifndef NO_SSE
 #include <immintrin.h>
@@ -70,6 +71,13 @@ namespace swrenderer
 	#define VECTORCALL
 	#endif
 
+	// Allow AVX2 intrinsics in a function without compiling the whole file for AVX2
+	#if defined(__GNUC__) && !defined(NO_SSE)
+	#define AVX2_TARGET __attribute__((target("avx2")))
+	#else
+	#define AVX2_TARGET
+	#endif
+
 	class DrawFuzzColumnRGBACommand : public DrawerCommand
 	{
 		int _x;
@@ -329,6 +337,10 @@ namespace swrenderer
 				green = green * light / 256;
 				blue = blue * light / 256;
 			}
+			else if (constants.ramp)
+			{
+				return constants.ramp->Shade(color.d, light);
+			}
 			else
 			{
 				uint32_t inv_light = 256 - light;
@@ -371,6 +383,10 @@ namespace swrenderer
 				green = green * light / 256;
 				blue = blue * light / 256;
 			}
+			else if (constants.ramp)
+			{
+				return constants.ramp->Shade(color, light);
+			}
 			else
 			{
 				uint32_t inv_light = 256 - light;
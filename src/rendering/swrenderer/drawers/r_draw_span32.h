@@ -41,9 +41,10 @@ namespace swrenderer
 		struct NearestFilter { static const int Mode = (int)FilterModes::Nearest; };
 		struct LinearFilter { static const int Mode = (int)FilterModes::Linear; };
 
-		enum class ShadeMode { Simple, Advanced };
+		enum class ShadeMode { Simple, Advanced, Ramp };
 		struct SimpleShade { static const int Mode = (int)ShadeMode::Simple; };
 		struct AdvancedShade { static const int Mode = (int)ShadeMode::Advanced; };
+		struct RampShade { static const int Mode = (int)ShadeMode::Ramp; };
 
 		enum class SpanTextureSize { SizeAny, Size64x64 };
 		struct TextureSizeAny { static const int Mode = (int)SpanTextureSize::SizeAny; };
@@ -131,6 +132,23 @@ namespace swrenderer
 						Loop<SimpleShade, LinearFilter, TextureSizeAny>(thread, texdata, shade_constants);
 				}
 			}
+			else if ((shade_constants.ramp = LightRamp::Get(shade_constants)) != nullptr)
+			{
+				if (is_nearest_filter)
+				{
+					if (is_64x64)
+						Loop<RampShade, NearestFilter, TextureSize64x64>(thread, texdata, shade_constants);
+					else
+						Loop<RampShade, NearestFilter, TextureSizeAny>(thread, texdata, shade_constants);
+				}
+				else
+				{
+					if (is_64x64)
+						Loop<RampShade, LinearFilter, TextureSize64x64>(thread, texdata, shade_constants);
+					else
+						Loop<RampShade, LinearFilter, TextureSizeAny>(thread, texdata, shade_constants);
+				}
+			}
 			else
 			{
 				if (is_nearest_filter)
@@ -162,7 +180,13 @@ namespace swrenderer
 			int inv_desaturate;
 			BgraColor shade_fade, shade_light;
 			int desaturate;
-			if (ShadeModeT::Mode == (int)ShadeMode::Advanced)
+			const uint8_t *ramp_row = nullptr;
+			if (ShadeModeT::Mode == (int)ShadeMode::Ramp)
+			{
+				ramp_row = shade_constants.ramp->Row(light);
+			}
+
+			if (ShadeModeT::Mode != (int)ShadeMode::Simple)
 			{
 				inv_desaturate = 256 - shade_constants.desaturate;
 				shade_fade.r = shade_constants.fade_red * inv_light;
@@ -216,7 +240,7 @@ namespace swrenderer
 				}
 
 				uint32_t ifgcolor = Sample<FilterModeT, TextureSizeT>(texdata.width, texdata.height, texdata.xone, texdata.yone, texdata.xstep, texdata.ystep, texdata.xfrac, texdata.yfrac, texdata.source);
-				BgraColor fgcolor = Shade<ShadeModeT>(ifgcolor, light, desaturate, inv_desaturate, shade_fade, shade_light, lights, num_lights, viewpos_x);
+				BgraColor fgcolor = Shade<ShadeModeT>(ifgcolor, light, desaturate, inv_desaturate, shade_fade, shade_light, ramp_row, lights, num_lights, viewpos_x);
 				BgraColor outcolor = Blend(fgcolor, bgcolor, srcalpha, destalpha, ifgcolor);
 
 				*dest = outcolor;
@@ -291,7 +315,7 @@ namespace swrenderer
 		}
 
 		template<typename ShadeModeT>
-		FORCEINLINE BgraColor Shade(BgraColor fgcolor, uint32_t light, uint32_t desaturate, uint32_t inv_desaturate, BgraColor shade_fade, BgraColor shade_light, const DrawerLight *lights, int num_lights, float viewpos_x)
+		FORCEINLINE BgraColor Shade(BgraColor fgcolor, uint32_t light, uint32_t desaturate, uint32_t inv_desaturate, BgraColor shade_fade, BgraColor shade_light, const uint8_t *ramp_row, const DrawerLight *lights, int num_lights, float viewpos_x)
 		{
 			using namespace DrawSpan32TModes;
 
@@ -302,6 +326,19 @@ namespace swrenderer
 				fgcolor.g = (fgcolor.g * light) >> 8;
 				fgcolor.b = (fgcolor.b * light) >> 8;
 			}
+			else if (ShadeModeT::Mode == (int)ShadeMode::Ramp)
+			{
+				if (desaturate != 0)
+				{
+					uint32_t intensity = ((fgcolor.r * 77 + fgcolor.g * 143 + fgcolor.b * 37) >> 8) * desaturate;
+					fgcolor.r = (fgcolor.r * inv_desaturate + intensity) >> 8;
+					fgcolor.g = (fgcolor.g * inv_desaturate + intensity) >> 8;
+					fgcolor.b = (fgcolor.b * inv_desaturate + intensity) >> 8;
+				}
+				fgcolor.r = ramp_row[fgcolor.r];
+				fgcolor.g = ramp_row[256 + fgcolor.g];
+				fgcolor.b = ramp_row[512 + fgcolor.b];
+			}
 			else
 			{
 				uint32_t intensity = ((fgcolor.r * 77 + fgcolor.g * 143 + fgcolor.b * 37) >> 8) * desaturate;
@@ -40,9 +40,10 @@ namespace swrenderer
 		struct NearestFilter { static const int Mode = (int)FilterModes::Nearest; };
 		struct LinearFilter { static const int Mode = (int)FilterModes::Linear; };
 
-		enum class ShadeMode { Simple, Advanced };
+		enum class ShadeMode { Simple, Advanced, Ramp };
 		struct SimpleShade { static const int Mode = (int)ShadeMode::Simple; };
 		struct AdvancedShade { static const int Mode = (int)ShadeMode::Advanced; };
+		struct RampShade { static const int Mode = (int)ShadeMode::Ramp; };
 	}
 
 	template<typename BlendT>
@@ -68,6 +69,13 @@ namespace swrenderer
 				else
 					Loop<SimpleShade, LinearFilter>(thread, shade_constants);
 			}
+			else if ((shade_constants.ramp = LightRamp::Get(shade_constants)) != nullptr)
+			{
+				if (is_nearest_filter)
+					Loop<RampShade, NearestFilter>(thread, shade_constants);
+				else
+					Loop<RampShade, LinearFilter>(thread, shade_constants);
+			}
 			else
 			{
 				if (is_nearest_filter)
@@ -94,7 +102,13 @@ namespace swrenderer
 			int inv_desaturate;
 			BgraColor shade_fade, shade_light;
 			int desaturate;
-			if (ShadeModeT::Mode == (int)ShadeMode::Advanced)
+			const uint8_t *ramp_row = nullptr;
+			if (ShadeModeT::Mode == (int)ShadeMode::Ramp)
+			{
+				ramp_row = shade_constants.ramp->Row(light);
+			}
+
+			if (ShadeModeT::Mode != (int)ShadeMode::Simple)
 			{
 				inv_desaturate = 256 - shade_constants.desaturate;
 				shade_fade.r = shade_constants.fade_red * inv_light;
@@ -158,7 +172,7 @@ namespace swrenderer
 				}
 
 				uint32_t ifgcolor = Sample<FilterModeT>(frac, source, source2, textureheight, one, texturefracx);
-				BgraColor fgcolor = Shade<ShadeModeT>(ifgcolor, light, desaturate, inv_desaturate, shade_fade, shade_light, lights, num_lights, viewpos_z);
+				BgraColor fgcolor = Shade<ShadeModeT>(ifgcolor, light, desaturate, inv_desaturate, shade_fade, shade_light, ramp_row, lights, num_lights, viewpos_z);
 				BgraColor outcolor = Blend(fgcolor, bgcolor, ifgcolor, srcalpha, destalpha);
 
 				*dest = outcolor;
@@ -205,7 +219,7 @@ namespace swrenderer
 		}
 
 		template<typename ShadeModeT>
-		FORCEINLINE BgraColor Shade(BgraColor fgcolor, uint32_t light, uint32_t desaturate, uint32_t inv_desaturate, BgraColor shade_fade, BgraColor shade_light, const DrawerLight *lights, int num_lights, float viewpos_z)
+		FORCEINLINE BgraColor Shade(BgraColor fgcolor, uint32_t light, uint32_t desaturate, uint32_t inv_desaturate, BgraColor shade_fade, BgraColor shade_light, const uint8_t *ramp_row, const DrawerLight *lights, int num_lights, float viewpos_z)
 		{
 			using namespace DrawWall32TModes;
 
@@ -216,6 +230,19 @@ namespace swrenderer
 				fgcolor.g = (fgcolor.g * light) >> 8;
 				fgcolor.b = (fgcolor.b * light) >> 8;
 			}
+			else if (ShadeModeT::Mode == (int)ShadeMode::Ramp)
+			{
+				if (desaturate != 0)
+				{
+					uint32_t intensity = ((fgcolor.r * 77 + fgcolor.g * 143 + fgcolor.b * 37) >> 8) * desaturate;
+					fgcolor.r = (fgcolor.r * inv_desaturate + intensity) >> 8;
+					fgcolor.g = (fgcolor.g * inv_desaturate + intensity) >> 8;
+					fgcolor.b = (fgcolor.b * inv_desaturate + intensity) >> 8;
+				}
+				fgcolor.r = ramp_row[fgcolor.r];
+				fgcolor.g = ramp_row[256 + fgcolor.g];
+				fgcolor.b = ramp_row[512 + fgcolor.b];
+			}
 			else
 			{
 				uint32_t intensity = ((fgcolor.r * 77 + fgcolor.g * 143 + fgcolor.b * 37) >> 8) * desaturate;
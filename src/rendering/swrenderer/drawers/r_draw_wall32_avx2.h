@@ -0,0 +1,301 @@
+/*
+**  AVX2 drawer commands for walls
+**  Copyright (c) 2016 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+*/
+
+#pragma once
+
+#include "swrenderer/drawers/r_draw_rgba.h"
+#include "swrenderer/drawers/r_draw_wall32_sse2.h"
+#include "swrenderer/viewport/r_walldrawer.h"
+
+namespace swrenderer
+{
+	// Same math as DrawWall32T, but four pixels at a time. Each 128-bit lane
+	// holds two pixels laid out exactly like the SSE2 version, so nearly all
+	// of the lane-local operations translate one to one.
+	template<typename BlendT>
+	class DrawWall32AVX2T : public DrawWall32T<BlendT>
+	{
+	public:
+		DrawWall32AVX2T(const WallDrawerArgs &drawerargs) : DrawWall32T<BlendT>(drawerargs) { }
+
+		void Execute(DrawerThread *thread) override
+		{
+			using namespace DrawWall32TModes;
+
+			const uint32_t *source2 = (const uint32_t*)this->args.TexturePixels2();
+			bool is_nearest_filter = (source2 == nullptr);
+			auto shade_constants = this->args.ColormapConstants();
+			if (shade_constants.simple_shade)
+			{
+				if (is_nearest_filter)
+					Loop<SimpleShade, NearestFilter>(thread, shade_constants);
+				else
+					Loop<SimpleShade, LinearFilter>(thread, shade_constants);
+			}
+			else
+			{
+				if (is_nearest_filter)
+					Loop<AdvancedShade, NearestFilter>(thread, shade_constants);
+				else
+					Loop<AdvancedShade, LinearFilter>(thread, shade_constants);
+			}
+		}
+
+		template<typename ShadeModeT, typename FilterModeT>
+		AVX2_TARGET void Loop(DrawerThread *thread, ShadeConstants shade_constants)
+		{
+			using namespace DrawWall32TModes;
+
+			auto &args = this->args;
+			const uint32_t *source = (const uint32_t*)args.TexturePixels();
+			const uint32_t *source2 = (const uint32_t*)args.TexturePixels2();
+			int textureheight = args.TextureHeight();
+			uint32_t one = ((0x80000000 + textureheight - 1) / textureheight) * 2 + 1;
+
+			// Shade constants
+			int light = 256 - (args.Light() >> (FRACBITS - 8));
+			__m256i mlight = _mm256_broadcastsi128_si256(_mm_set_epi16(256, light, light, light, 256, light, light, light));
+			__m256i inv_light = _mm256_broadcastsi128_si256(_mm_set_epi16(0, 256 - light, 256 - light, 256 - light, 0, 256 - light, 256 - light, 256 - light));
+
+			__m256i inv_desaturate, shade_fade, shade_light;
+			int desaturate;
+			if (ShadeModeT::Mode == (int)ShadeMode::Advanced)
+			{
+				inv_desaturate = _mm256_broadcastsi128_si256(_mm_setr_epi16(256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate));
+				shade_fade = _mm256_broadcastsi128_si256(_mm_set_epi16(shade_constants.fade_alpha, shade_constants.fade_red, shade_constants.fade_green, shade_constants.fade_blue, shade_constants.fade_alpha, shade_constants.fade_red, shade_constants.fade_green, shade_constants.fade_blue));
+				shade_fade = _mm256_mullo_epi16(shade_fade, inv_light);
+				shade_light = _mm256_broadcastsi128_si256(_mm_set_epi16(shade_constants.light_alpha, shade_constants.light_red, shade_constants.light_green, shade_constants.light_blue, shade_constants.light_alpha, shade_constants.light_red, shade_constants.light_green, shade_constants.light_blue));
+				desaturate = shade_constants.desaturate;
+			}
+			else
+			{
+				inv_desaturate = _mm256_setzero_si256();
+				shade_fade = _mm256_setzero_si256();
+				shade_light = _mm256_setzero_si256();
+				desaturate = 0;
+			}
+
+			int count = args.Count();
+			int pitch = args.Viewport()->RenderTarget->GetPitch();
+			uint32_t fracstep = args.TextureVStep();
+			uint32_t frac = args.TextureVPos();
+			uint32_t texturefracx = args.TextureUPos();
+			uint32_t *dest = (uint32_t*)args.Dest();
+			int dest_y = args.DestY();
+
+			auto lights = args.dc_lights;
+			auto num_lights = args.dc_num_lights;
+			float vpz = args.dc_viewpos.Z + args.dc_viewpos_step.Z * thread->skipped_by_thread(dest_y);
+			float stepvpz = args.dc_viewpos_step.Z * thread->num_cores;
+			__m256 viewpos_z = _mm256_setr_ps(vpz, vpz + stepvpz, 0.0f, 0.0f, vpz + stepvpz * 2.0f, vpz + stepvpz * 3.0f, 0.0f, 0.0f);
+			__m256 step_viewpos_z = _mm256_set1_ps(stepvpz * 4.0f);
+
+			count = thread->count_for_thread(dest_y, count);
+			if (count <= 0) return;
+			frac += thread->skipped_by_thread(dest_y) * fracstep;
+			dest = thread->dest_for_thread(dest_y, pitch, dest);
+			fracstep *= thread->num_cores;
+			pitch *= thread->num_cores;
+
+			if (FilterModeT::Mode == (int)FilterModes::Linear)
+			{
+				frac -= one / 2;
+			}
+
+			uint32_t srcalpha = args.SrcAlpha() >> (FRACBITS - 8);
+			uint32_t destalpha = args.DestAlpha() >> (FRACBITS - 8);
+
+			for (int index = 0; index < count; index += 4)
+			{
+				int n = MIN(count - index, 4);
+				uint32_t *d = dest + index * pitch;
+
+				alignas(16) uint32_t desttmp[4] = { 0, 0, 0, 0 };
+				alignas(16) uint32_t ifgcolor[4] = { 0, 0, 0, 0 };
+				for (int i = 0; i < n; i++)
+				{
+					if (BlendT::Mode != (int)WallBlendModes::Opaque)
+						desttmp[i] = d[i * pitch];
+					ifgcolor[i] = this->template Sample<FilterModeT>(frac, source, source2, textureheight, one, texturefracx);
+					frac += fracstep;
+				}
+
+				__m256i bgcolor = _mm256_cvtepu8_epi16(_mm_load_si128((const __m128i*)desttmp));
+				__m256i fgcolor = _mm256_cvtepu8_epi16(_mm_load_si128((const __m128i*)ifgcolor));
+
+				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor, desaturate, inv_desaturate, shade_fade, shade_light, lights, num_lights, viewpos_z);
+				__m256i outcolor = Blend(fgcolor, bgcolor, ifgcolor, srcalpha, destalpha);
+
+				// Each lane holds two finished pixels in its low 64 bits
+				_mm_store_si128((__m128i*)desttmp, _mm256_castsi256_si128(_mm256_permute4x64_epi64(outcolor, _MM_SHUFFLE(3, 1, 2, 0))));
+				for (int i = 0; i < n; i++)
+					d[i * pitch] = desttmp[i];
+
+				viewpos_z = _mm256_add_ps(viewpos_z, step_viewpos_z);
+			}
+		}
+
+		template<typename ShadeModeT>
+		AVX2_TARGET FORCEINLINE __m256i Shade(__m256i fgcolor, __m256i mlight, const uint32_t *ifgcolor, int desaturate, __m256i inv_desaturate, __m256i shade_fade, __m256i shade_light, const DrawerLight *lights, int num_lights, __m256 viewpos_z)
+		{
+			using namespace DrawWall32TModes;
+
+			__m256i material = fgcolor;
+			if (ShadeModeT::Mode == (int)ShadeMode::Simple)
+			{
+				fgcolor = _mm256_srli_epi16(_mm256_mullo_epi16(fgcolor, mlight), 8);
+			}
+			else
+			{
+				int intensity[4];
+				for (int i = 0; i < 4; i++)
+					intensity[i] = ((RPART(ifgcolor[i]) * 77 + GPART(ifgcolor[i]) * 143 + BPART(ifgcolor[i]) * 37) >> 8) * desaturate;
+
+				__m256i mintensity = _mm256_set_epi16(
+					0, intensity[3], intensity[3], intensity[3], 0, intensity[2], intensity[2], intensity[2],
+					0, intensity[1], intensity[1], intensity[1], 0, intensity[0], intensity[0], intensity[0]);
+
+				fgcolor = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(fgcolor, inv_desaturate), mintensity), 8);
+				fgcolor = _mm256_mullo_epi16(fgcolor, mlight);
+				fgcolor = _mm256_srli_epi16(_mm256_add_epi16(shade_fade, fgcolor), 8);
+				fgcolor = _mm256_srli_epi16(_mm256_mullo_epi16(fgcolor, shade_light), 8);
+			}
+
+			return AddLights(material, fgcolor, lights, num_lights, viewpos_z);
+		}
+
+		AVX2_TARGET FORCEINLINE __m256i AddLights(__m256i material, __m256i fgcolor, const DrawerLight *lights, int num_lights, __m256 viewpos_z)
+		{
+			__m256i lit = _mm256_setzero_si256();
+
+			for (int i = 0; i != num_lights; i++)
+			{
+				__m256 light_x = _mm256_set1_ps(lights[i].x);
+				__m256 light_y = _mm256_set1_ps(lights[i].y);
+				__m256 light_z = _mm256_set1_ps(lights[i].z);
+				__m256 light_radius = _mm256_set1_ps(lights[i].radius);
+				__m256 m256 = _mm256_set1_ps(256.0f);
+
+				// See DrawWall32T::AddLights for the math
+				__m256 Lxy2 = light_x;
+				__m256 Lz = _mm256_sub_ps(light_z, viewpos_z);
+				__m256 dist2 = _mm256_add_ps(Lxy2, _mm256_mul_ps(Lz, Lz));
+				__m256 rcp_dist = _mm256_rsqrt_ps(dist2);
+				__m256 dist = _mm256_mul_ps(dist2, rcp_dist);
+				__m256 distance_attenuation = _mm256_sub_ps(m256, _mm256_min_ps(_mm256_mul_ps(dist, light_radius), m256));
+
+				__m256 simple_attenuation = distance_attenuation;
+				__m256 point_attenuation = _mm256_mul_ps(_mm256_mul_ps(light_y, rcp_dist), distance_attenuation);
+
+				__m256 is_attenuated = _mm256_cmp_ps(light_y, _mm256_setzero_ps(), _CMP_EQ_OQ);
+				__m256i attenuation = _mm256_cvtps_epi32(_mm256_or_ps(_mm256_and_ps(is_attenuated, simple_attenuation), _mm256_andnot_ps(is_attenuated, point_attenuation)));
+				attenuation = _mm256_packs_epi32(_mm256_shuffle_epi32(attenuation, _MM_SHUFFLE(0, 0, 0, 0)), _mm256_shuffle_epi32(attenuation, _MM_SHUFFLE(1, 1, 1, 1)));
+
+				__m128i light_color = _mm_unpacklo_epi8(_mm_cvtsi32_si128(lights[i].color), _mm_setzero_si128());
+				__m256i mlight_color = _mm256_broadcastsi128_si256(_mm_shuffle_epi32(light_color, _MM_SHUFFLE(1, 0, 1, 0)));
+
+				lit = _mm256_add_epi16(lit, _mm256_srli_epi16(_mm256_mullo_epi16(mlight_color, attenuation), 8));
+			}
+
+			lit = _mm256_min_epi16(lit, _mm256_set1_epi16(256));
+
+			fgcolor = _mm256_add_epi16(fgcolor, _mm256_srli_epi16(_mm256_mullo_epi16(material, lit), 8));
+			fgcolor = _mm256_min_epi16(fgcolor, _mm256_set1_epi16(255));
+			return fgcolor;
+		}
+
+		AVX2_TARGET FORCEINLINE __m256i Blend(__m256i fgcolor, __m256i bgcolor, const uint32_t *ifgcolor, uint32_t srcalpha, uint32_t destalpha)
+		{
+			using namespace DrawWall32TModes;
+
+			__m256i zero = _mm256_setzero_si256();
+			__m256i alphamask = _mm256_set1_epi32(0xff000000);
+
+			if (BlendT::Mode == (int)WallBlendModes::Opaque)
+			{
+				return _mm256_or_si256(_mm256_packus_epi16(fgcolor, zero), alphamask);
+			}
+			else if (BlendT::Mode == (int)WallBlendModes::Masked)
+			{
+				__m256i mask = _mm256_cmpeq_epi32(_mm256_packus_epi16(fgcolor, zero), zero);
+				mask = _mm256_unpacklo_epi8(mask, zero);
+				__m256i outcolor = _mm256_or_si256(_mm256_and_si256(mask, bgcolor), _mm256_andnot_si256(mask, fgcolor));
+				return _mm256_or_si256(_mm256_packus_epi16(outcolor, zero), alphamask);
+			}
+			else
+			{
+				uint16_t fgalpha[4], bgalpha[4];
+				for (int i = 0; i < 4; i++)
+				{
+					uint32_t alpha = APART(ifgcolor[i]);
+					alpha += alpha >> 7; // 255->256
+					uint32_t inv_alpha = 256 - alpha;
+					bgalpha[i] = (destalpha * alpha + (inv_alpha << 8) + 128) >> 8;
+					fgalpha[i] = (srcalpha * alpha + 128) >> 8;
+				}
+
+				__m256i mbgalpha = _mm256_set_epi16(
+					bgalpha[3], bgalpha[3], bgalpha[3], bgalpha[3], bgalpha[2], bgalpha[2], bgalpha[2], bgalpha[2],
+					bgalpha[1], bgalpha[1], bgalpha[1], bgalpha[1], bgalpha[0], bgalpha[0], bgalpha[0], bgalpha[0]);
+				__m256i mfgalpha = _mm256_set_epi16(
+					fgalpha[3], fgalpha[3], fgalpha[3], fgalpha[3], fgalpha[2], fgalpha[2], fgalpha[2], fgalpha[2],
+					fgalpha[1], fgalpha[1], fgalpha[1], fgalpha[1], fgalpha[0], fgalpha[0], fgalpha[0], fgalpha[0]);
+
+				fgcolor = _mm256_mullo_epi16(fgcolor, mfgalpha);
+				bgcolor = _mm256_mullo_epi16(bgcolor, mbgalpha);
+
+				__m256i fg_lo = _mm256_unpacklo_epi16(fgcolor, zero);
+				__m256i bg_lo = _mm256_unpacklo_epi16(bgcolor, zero);
+				__m256i fg_hi = _mm256_unpackhi_epi16(fgcolor, zero);
+				__m256i bg_hi = _mm256_unpackhi_epi16(bgcolor, zero);
+
+				__m256i out_lo, out_hi;
+				if (BlendT::Mode == (int)WallBlendModes::AddClamp)
+				{
+					out_lo = _mm256_add_epi32(fg_lo, bg_lo);
+					out_hi = _mm256_add_epi32(fg_hi, bg_hi);
+				}
+				else if (BlendT::Mode == (int)WallBlendModes::SubClamp)
+				{
+					out_lo = _mm256_sub_epi32(fg_lo, bg_lo);
+					out_hi = _mm256_sub_epi32(fg_hi, bg_hi);
+				}
+				else
+				{
+					out_lo = _mm256_sub_epi32(bg_lo, fg_lo);
+					out_hi = _mm256_sub_epi32(bg_hi, fg_hi);
+				}
+
+				out_lo = _mm256_srai_epi32(out_lo, 8);
+				out_hi = _mm256_srai_epi32(out_hi, 8);
+				__m256i outcolor = _mm256_packs_epi32(out_lo, out_hi);
+				return _mm256_or_si256(_mm256_packus_epi16(outcolor, zero), alphamask);
+			}
+		}
+	};
+
+	typedef DrawWall32AVX2T<DrawWall32TModes::OpaqueWall> DrawWall32AVX2Command;
+	typedef DrawWall32AVX2T<DrawWall32TModes::MaskedWall> DrawWallMasked32AVX2Command;
+	typedef DrawWall32AVX2T<DrawWall32TModes::AddClampWall> DrawWallAddClamp32AVX2Command;
+	typedef DrawWall32AVX2T<DrawWall32TModes::SubClampWall> DrawWallSubClamp32AVX2Command;
+	typedef DrawWall32AVX2T<DrawWall32TModes::RevSubClampWall> DrawWallRevSubClamp32AVX2Command;
+}
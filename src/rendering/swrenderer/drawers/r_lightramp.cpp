@@ -0,0 +1,251 @@
+/*
+**  Precalculated truecolor light ramps
+**  Copyright (c) 2016 Magnus Norddahl (the shade formula)
+**  Copyright (c) 2026 agent
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+*/
+
+#include <stdlib.h>
+#include "templates.h"
+#include "c_dispatch.h"
+#include "stats.h"
+#include "r_lightramp.h"
+#include "swrenderer/viewport/r_drawerargs.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <chrono>
+
+namespace swrenderer
+{
+	static std::unique_ptr<LightRamp> Ramps[LightRamp::MaxRamps];
+	static std::atomic<int> NumRamps;
+	static std::mutex RampMutex;
+	static std::atomic<int> RampGeneration;
+
+	// Drawers of one thread tend to ask for the same colormap many times in a row
+	static thread_local const LightRamp *LastRamp;
+	static thread_local int LastGeneration;
+
+	LightRamp::LightRamp(const RampKey &key) : Key(key)
+	{
+		const uint32_t fade[3] = { key.fade_red, key.fade_green, key.fade_blue };
+		const uint32_t color[3] = { key.light_red, key.light_green, key.light_blue };
+		for (uint32_t light = 0; light < LightLevels; light++)
+		{
+			uint32_t inv_light = 256 - light;
+			for (int channel = 0; channel < 3; channel++)
+			{
+				uint8_t *row = Table[light][channel];
+				for (uint32_t value = 0; value < 256; value++)
+				{
+					// The poly renderer scales its fade colors to 0-256, which can overflow a channel at full fade
+					uint32_t shaded = (((fade[channel] * inv_light + value * light) >> 8) * color[channel]) >> 8;
+					row[value] = (uint8_t)MIN(shaded, (uint32_t)255);
+				}
+			}
+		}
+	}
+
+	const LightRamp *LightRamp::Get(uint32_t light_red, uint32_t light_green, uint32_t light_blue, uint32_t fade_red, uint32_t fade_green, uint32_t fade_blue, uint32_t desaturate)
+	{
+		RampKey key = { (uint16_t)light_red, (uint16_t)light_green, (uint16_t)light_blue, (uint16_t)fade_red, (uint16_t)fade_green, (uint16_t)fade_blue, (uint16_t)desaturate };
+
+		// Reset only happens while no drawers run, so the generation cannot change during this call
+		int generation = RampGeneration.load(std::memory_order_relaxed);
+		const LightRamp *last = LastRamp;
+		if (last && LastGeneration == generation && last->Key == key)
+			return last;
+
+		// Published ramps are never modified or removed until Reset, so they can be searched without the lock
+		int count = NumRamps.load(std::memory_order_acquire);
+		for (int i = 0; i < count; i++)
+		{
+			if (Ramps[i]->Key == key)
+			{
+				LastRamp = Ramps[i].get();
+				LastGeneration = generation;
+				return LastRamp;
+			}
+		}
+
+		// Nothing can be added to a full table, so there is no point in waiting for the lock
+		if (count == MaxRamps)
+			return nullptr;
+
+		std::unique_lock<std::mutex> lock(RampMutex);
+		count = NumRamps.load(std::memory_order_relaxed);
+		for (int i = 0; i < count; i++)
+		{
+			if (Ramps[i]->Key == key)
+			{
+				LastRamp = Ramps[i].get();
+				LastGeneration = generation;
+				return LastRamp;
+			}
+		}
+
+		if (count == MaxRamps)
+			return nullptr;
+
+		Ramps[count].reset(new LightRamp(key));
+		NumRamps.store(count + 1, std::memory_order_release);
+		LastRamp = Ramps[count].get();
+		LastGeneration = generation;
+		return LastRamp;
+	}
+
+	const LightRamp *LightRamp::Get(const ShadeConstants &constants)
+	{
+		return Get(constants.light_red, constants.light_green, constants.light_blue, constants.fade_red, constants.fade_green, constants.fade_blue, constants.desaturate);
+	}
+
+	int LightRamp::Count()
+	{
+		return NumRamps.load(std::memory_order_acquire);
+	}
+
+	void LightRamp::Reset()
+	{
+		std::unique_lock<std::mutex> lock(RampMutex);
+		int count = NumRamps.load(std::memory_order_relaxed);
+		NumRamps.store(0, std::memory_order_release);
+		for (int i = 0; i < count; i++)
+			Ramps[i].reset();
+
+		// Invalidates the LastRamp of every thread
+		RampGeneration.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////
+
+	static uint32_t ShadeWithoutRamp(uint32_t color, uint32_t light, const ShadeConstants &constants)
+	{
+		uint32_t red = RPART(color);
+		uint32_t green = GPART(color);
+		uint32_t blue = BPART(color);
+		uint32_t inv_light = 256 - light;
+		uint32_t inv_desaturate = 256 - constants.desaturate;
+
+		uint32_t intensity = ((red * 77 + green * 143 + blue * 37) >> 8) * constants.desaturate;
+
+		red = (red * inv_desaturate + intensity) >> 8;
+		green = (green * inv_desaturate + intensity) >> 8;
+		blue = (blue * inv_desaturate + intensity) >> 8;
+
+		red = (constants.fade_red * inv_light + red * light) >> 8;
+		green = (constants.fade_green * inv_light + green * light) >> 8;
+		blue = (constants.fade_blue * inv_light + blue * light) >> 8;
+
+		red = (red * constants.light_red) >> 8;
+		green = (green * constants.light_green) >> 8;
+		blue = (blue * constants.light_blue) >> 8;
+
+		return (color & 0xff000000) | (red << 16) | (green << 8) | blue;
+	}
+}
+
+ADD_STAT(lightramps)
+{
+	using namespace swrenderer;
+	int count = LightRamp::Count();
+	FString out;
+	out.Format("%d of %d light ramps, %d KB", count, (int)LightRamp::MaxRamps, (int)(count * sizeof(LightRamp) / 1024));
+	return out;
+}
+
+//==========================================================================
+//
+// Shades the same pixels with the arithmetic formula and with a light
+// ramp, times both and checks that they give the same colors.
+//
+//==========================================================================
+
+CCMD(benchlightramp)
+{
+	using namespace swrenderer;
+
+	int passes = argv.argc() > 1 ? MAX(atoi(argv[1]), 1) : 20;
+	const int count = 1 << 20;
+
+	// A greenish fog with some desaturation, in the form DrawerArgs::ColormapConstants produces
+	ShadeConstants constants = {};
+	constants.light_red = 200 * 256 / 255;
+	constants.light_green = 255 * 256 / 255;
+	constants.light_blue = 160 * 256 / 255;
+	constants.fade_red = 32;
+	constants.fade_green = 64;
+	constants.fade_blue = 48;
+	constants.desaturate = 64 * 255 / 256;
+	constants.simple_shade = false;
+
+	const LightRamp *ramp = LightRamp::Get(constants);
+	if (!ramp)
+	{
+		Printf("The light ramp cache is full.\n");
+		return;
+	}
+
+	TArray<uint32_t> colors(count, true);
+	TArray<uint32_t> lights(count, true);
+	uint32_t seed = 0x12345678;
+	for (int i = 0; i < count; i++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		colors[i] = 0xff000000 | (seed >> 8);
+		seed = seed * 1664525 + 1013904223;
+		lights[i] = (seed >> 8) % 257;
+	}
+
+	TArray<uint32_t> reference(count, true);
+	TArray<uint32_t> output(count, true);
+
+	auto time = [&](uint32_t *dest, bool useramp)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < passes; pass++)
+		{
+			if (useramp)
+			{
+				for (int i = 0; i < count; i++)
+					dest[i] = ramp->Shade(colors[i], lights[i]);
+			}
+			else
+			{
+				for (int i = 0; i < count; i++)
+					dest[i] = ShadeWithoutRamp(colors[i], lights[i], constants);
+			}
+		}
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count() / ((double)passes * count);
+	};
+
+	double formula = time(reference.Data(), false);
+	double lookup = time(output.Data(), true);
+
+	int mismatches = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (reference[i] != output[i]) mismatches++;
+	}
+
+	Printf("%d passes over %d pixels\n", passes, count);
+	Printf("formula %6.3f ns/pixel  ramp %6.3f ns/pixel  %5.2fx%s\n", formula, lookup, formula / lookup,
+		mismatches ? FStringf("  (%d pixels differ)", mismatches).GetChars() : "");
+}
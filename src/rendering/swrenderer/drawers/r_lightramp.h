@@ -0,0 +1,95 @@
+/*
+**  Precalculated truecolor light ramps
+**  Copyright (c) 2026 agent
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "v_palette.h"
+
+namespace swrenderer
+{
+	struct ShadeConstants;
+
+	// The advanced truecolor shade formula (colored light, fade and desaturation) precalculated for one colormap.
+	// Each row holds the shaded value of every channel value for one light multiplier, so the
+	// fade and colorize multiplies become a single lookup per channel.
+	//
+	// Ramps are shared by the software and poly renderers and by all drawer threads. They are only
+	// freed by Reset, so a pointer returned by Get stays valid for as long as the drawer holding it runs.
+	class LightRamp
+	{
+	public:
+		// Returns the ramp for the given constants, building it on first use. Returns nullptr when the cache is full.
+		// light_* are 0-256 multipliers, fade_* are 0-256 colors and desaturate is 0-256.
+		static const LightRamp *Get(uint32_t light_red, uint32_t light_green, uint32_t light_blue, uint32_t fade_red, uint32_t fade_green, uint32_t fade_blue, uint32_t desaturate);
+		static const LightRamp *Get(const ShadeConstants &constants);
+
+		static int Count();
+
+		// Frees all ramps so that a new level gets the cache to itself. No drawers may be running when this is called.
+		static void Reset();
+
+		enum { MaxRamps = 32, LightLevels = 257 };
+
+		// Shaded values for a 0-256 light multiplier. Red is at [0, 255], green at [256, 511] and blue at [512, 767].
+		const uint8_t *Row(uint32_t light) const { return Table[light < LightLevels ? light : LightLevels - 1][0]; }
+
+		uint32_t Desaturate() const { return Key.desaturate; }
+
+		uint32_t Shade(uint32_t color, uint32_t light) const
+		{
+			uint32_t red = RPART(color);
+			uint32_t green = GPART(color);
+			uint32_t blue = BPART(color);
+			if (Key.desaturate != 0)
+			{
+				uint32_t inv_desaturate = 256 - Key.desaturate;
+				uint32_t intensity = ((red * 77 + green * 143 + blue * 37) >> 8) * Key.desaturate;
+				red = (red * inv_desaturate + intensity) >> 8;
+				green = (green * inv_desaturate + intensity) >> 8;
+				blue = (blue * inv_desaturate + intensity) >> 8;
+			}
+			const uint8_t *row = Row(light);
+			return (color & 0xff000000) | (row[red] << 16) | (row[256 + green] << 8) | row[512 + blue];
+		}
+
+	private:
+		struct RampKey
+		{
+			uint16_t light_red, light_green, light_blue;
+			uint16_t fade_red, fade_green, fade_blue;
+			uint16_t desaturate;
+
+			bool operator==(const RampKey &other) const
+			{
+				return light_red == other.light_red && light_green == other.light_green && light_blue == other.light_blue &&
+					fade_red == other.fade_red && fade_green == other.fade_green && fade_blue == other.fade_blue &&
+					desaturate == other.desaturate;
+			}
+		};
+
+		LightRamp(const RampKey &key);
+
+		RampKey Key;
+		uint8_t Table[LightLevels][3][256];
+	};
+}
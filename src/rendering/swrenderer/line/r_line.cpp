@@ -47,6 +47,7 @@
 #include "swrenderer/scene/r_3dfloors.h"
 #include "swrenderer/scene/r_portal.h"
 #include "swrenderer/scene/r_light.h"
+#include "swrenderer/scene/r_occlusion.h"
 #include "swrenderer/scene/r_scene.h"
 #include "swrenderer/viewport/r_viewport.h"
 #include "swrenderer/line/r_line.h"
@@ -521,6 +522,10 @@ namespace swrenderer
 			draw_segment->silhouette |= SIL_TOP | SIL_BOTTOM;
 		}
 
+		Thread->Occlusion->MarkOccluder(start, stop, MAX(WallC.sz1, WallC.sz2),
+			(draw_segment->silhouette & SIL_TOP) ? draw_segment->sprtopclip : nullptr,
+			(draw_segment->silhouette & SIL_BOTTOM) ? draw_segment->sprbottomclip : nullptr);
+
 		RenderMiddleTexture(start, stop);
 		RenderTopTexture(start, stop);
 		RenderBottomTexture(start, stop);
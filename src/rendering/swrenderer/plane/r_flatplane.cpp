@@ -49,6 +49,7 @@
 #include "swrenderer/scene/r_scene.h"
 #include "swrenderer/scene/r_light.h"
 #include "swrenderer/plane/r_visibleplane.h"
+#include "swrenderer/plane/r_visibleplanelist.h"
 #include "swrenderer/viewport/r_viewport.h"
 #include "swrenderer/r_memory.h"
 #include "swrenderer/r_renderthread.h"
@@ -67,14 +68,37 @@ namespace swrenderer
 			return;
 		}
 
+		// VisiblePlaneList::Render sorts planes so that those only differing in light level and
+		// screen coverage are drawn back to back. They can keep the span setup of the previous one.
+		if (setupplane && texture == tex && alpha == setupalpha && additive == setupadditive && masked == setupmasked &&
+			colormap == setupplane->colormap && pl->height == setupplane->height && pl->xform == setupplane->xform)
+		{
+			ReusedSetups++;
+		}
+		else
+		{
+			SetupPlane(pl, _xscale, _yscale, alpha, additive, masked, colormap, texture);
+		}
+
+		lightlevel = pl->lightlevel;
+		light_list = pl->lights;
+
+		RenderLines(pl);
+	}
+
+	void RenderFlatPlane::SetupPlane(VisiblePlane *pl, double _xscale, double _yscale, fixed_t alpha, bool additive, bool masked, FDynamicColormap *colormap, FSoftwareTexture *texture)
+	{
+		setupplane = pl;
+		setupalpha = alpha;
+		setupadditive = additive;
+		setupmasked = masked;
 		tex = texture;
 
 		drawerargs.SetSolidColor(3);
 		drawerargs.SetTexture(Thread, texture);
 
 		double planeang = (pl->xform.Angle + pl->xform.baseAngle).Radians();
-		double xstep, ystep, leftxfrac, leftyfrac, rightxfrac, rightyfrac;
-		double x;
+		double xstep, ystep;
 
 		if (planeang != 0)
 		{
@@ -108,45 +132,27 @@ namespace swrenderer
 			ystep = -ystep;
 		}
 
+		// The mapping is linear in x, so it is set up relative to the first screen column
+		// rather than the plane's left edge. That keeps it valid for every plane sharing it.
 		planeang += M_PI / 2;
 		double cosine = cos(planeang), sine = -sin(planeang);
-		x = pl->right - viewport->CenterX + 0.5;
-		rightxfrac = _xscale * (cosine + x * xstep);
-		rightyfrac = _yscale * (sine + x * ystep);
-		x = pl->left - viewport->CenterX + 0.5;
-		leftxfrac = _xscale * (cosine + x * xstep);
-		leftyfrac = _yscale * (sine + x * ystep);
-
-		basexfrac = leftxfrac;
-		baseyfrac = leftyfrac;
-		if (pl->left != pl->right)
-		{
-			xstepscale = (rightxfrac - leftxfrac) / (pl->right - pl->left);
-			ystepscale = (rightyfrac - leftyfrac) / (pl->right - pl->left);
-		}
-		else
-		{
-			xstepscale = 0;
-			ystepscale = 0;
-		}
-
-		minx = pl->left;
+		double x = -viewport->CenterX + 0.5;
+		basexfrac = _xscale * (cosine + x * xstep);
+		baseyfrac = _yscale * (sine + x * ystep);
+		xstepscale = _xscale * xstep;
+		ystepscale = _yscale * ystep;
 
 		planeheight = fabs(pl->height.Zat0() - Thread->Viewport->viewpoint.Pos.Z);
+		rowscale = Thread->PlaneList->GetRowScale();
 
 		// [RH] set foggy flag
 		auto Level = Thread->Viewport->Level();
 		foggy = (Level->fadeto || colormap->Fade || (Level->flags & LEVEL_HASFADETABLE));
-		lightlevel = pl->lightlevel;
 
 		CameraLight *cameraLight = CameraLight::Instance();
 		plane_shade = cameraLight->FixedLightLevel() < 0 && !cameraLight->FixedColormap();
 
 		drawerargs.SetStyle(masked, additive, alpha, colormap);
-
-		light_list = pl->lights;
-
-		RenderLines(pl);
 	}
 
 	void RenderFlatPlane::RenderLine(int y, int x1, int x2)
@@ -160,12 +166,12 @@ namespace swrenderer
 
 		auto viewport = Thread->Viewport.get();
 
-		double curxfrac = basexfrac + xstepscale * (x1 - minx);
-		double curyfrac = baseyfrac + ystepscale * (x1 - minx);
+		double curxfrac = basexfrac + xstepscale * x1;
+		double curyfrac = baseyfrac + ystepscale * x1;
 
-		double distance = viewport->PlaneDepth(y, planeheight);
+		double distance = rowscale[y] * planeheight;
 
-		float zbufferdepth = (float)(1.0 / fabs(planeheight / Thread->Viewport->ScreenToViewY(y, 1.0)));
+		float zbufferdepth = (float)(1.0 / distance);
 
 		drawerargs.SetTextureUStep(distance * xstepscale / tex->GetWidth());
 		drawerargs.SetTextureUPos((distance * curxfrac + pviewx) / tex->GetWidth());
@@ -175,7 +181,7 @@ namespace swrenderer
 		
 		if (viewport->RenderTarget->IsBgra())
 		{
-			double distance2 = viewport->PlaneDepth(y + 1, planeheight);
+			double distance2 = rowscale[y + 1] * planeheight;
 			double xmagnitude = fabs(ystepscale * (distance2 - distance) * viewport->FocalLengthX);
 			double ymagnitude = fabs(xstepscale * (distance2 - distance) * viewport->FocalLengthX);
 			double magnitude = MAX(ymagnitude, xmagnitude);
@@ -38,10 +38,18 @@ namespace swrenderer
 
 		RenderThread *Thread = nullptr;
 
+		// Number of planes drawn with the span setup of the previous one
+		int ReusedSetups = 0;
+
 	private:
+		void SetupPlane(VisiblePlane *pl, double _xscale, double _yscale, fixed_t alpha, bool additive, bool masked, FDynamicColormap *basecolormap, FSoftwareTexture *texture);
 		void RenderLine(int y, int x1, int x2) override;
 
-		int minx;
+		VisiblePlane *setupplane = nullptr;
+		fixed_t setupalpha;
+		bool setupadditive, setupmasked;
+
+		const double *rowscale;
 		double planeheight;
 		bool plane_shade;
 		int lightlevel;
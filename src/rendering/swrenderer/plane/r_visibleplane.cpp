@@ -101,7 +101,7 @@ namespace swrenderer
 		}
 	}
 
-	void VisiblePlane::Render(RenderThread *thread, fixed_t alpha, bool additive, bool masked)
+	void VisiblePlane::Render(RenderThread *thread, fixed_t alpha, bool additive, bool masked, RenderFlatPlane *flatrenderer)
 	{
 		if (left >= right)
 			return;
@@ -132,7 +132,11 @@ namespace swrenderer
 			double xscale = xform.xScale * tex->GetScale().X;
 			double yscale = xform.yScale * tex->GetScale().Y;
 
-			if (!height.isSlope() && !tilt)
+			if (!height.isSlope() && !tilt && flatrenderer)
+			{
+				flatrenderer->Render(this, xscale, yscale, alpha, additive, masked, colormap, tex);
+			}
+			else if (!height.isSlope() && !tilt)
 			{
 				RenderFlatPlane renderer(thread);
 				renderer.Render(this, xscale, yscale, alpha, additive, masked, colormap, tex);
@@ -35,6 +35,7 @@ struct FSectorPortal;
 namespace swrenderer
 {
 	class RenderThread;
+	class RenderFlatPlane;
 
 	struct VisiblePlaneLight
 	{
@@ -47,7 +48,7 @@ namespace swrenderer
 		VisiblePlane(RenderThread *thread);
 
 		void AddLights(RenderThread *thread, FLightNode *node);
-		void Render(RenderThread *thread, fixed_t alpha, bool additive, bool masked);
+		void Render(RenderThread *thread, fixed_t alpha, bool additive, bool masked, RenderFlatPlane *flatrenderer = nullptr);
 
 		VisiblePlane *next = nullptr;		// Next visplane in hash chain -- killough
 
@@ -22,6 +22,7 @@
 
 #include <stdlib.h>
 #include <float.h>
+#include <algorithm>
 
 #include "templates.h"
 
@@ -68,6 +69,7 @@ namespace swrenderer
 	VisiblePlane *VisiblePlaneList::Add(unsigned hash)
 	{
 		VisiblePlane *newplane = Thread->FrameMemory->NewObject<VisiblePlane>(Thread);
+		CreatedPlanes++;
 		newplane->next = visplanes[hash];
 		visplanes[hash] = newplane;
 		return newplane;
@@ -77,6 +79,10 @@ namespace swrenderer
 	{
 		for (int i = 0; i <= MAXVISPLANES; i++)
 			visplanes[i] = nullptr;
+
+		CreatedPlanes = 0;
+		MergedPlanes = 0;
+		BatchedPlanes = 0;
 	}
 
 	void VisiblePlaneList::ClearKeepFakePlanes()
@@ -182,11 +188,13 @@ namespace swrenderer
 								)
 							)
 						{
+							MergedPlanes++;
 							return check;
 						}
 					}
 					else
 					{
+						MergedPlanes++;
 						return check;
 					}
 				}
@@ -204,6 +212,7 @@ namespace swrenderer
 					Thread->Viewport->viewpoint.Pos == check->viewpos
 					)
 				{
+					MergedPlanes++;
 					return check;
 				}
 		}
@@ -341,6 +350,7 @@ namespace swrenderer
 
 		RenderPortal *renderportal = Thread->Portal.get();
 
+		DrawPlanes.Clear();
 		for (i = 0; i < MAXVISPLANES; i++)
 		{
 			for (pl = visplanes[i]; pl; pl = pl->next)
@@ -351,17 +361,50 @@ namespace swrenderer
 				// kg3D - draw only real planes now
 				if (pl->sky >= 0) {
 					vpcount++;
-					pl->Render(Thread, OPAQUE, false, false);
+					DrawPlanes.Push(pl);
 				}
 			}
 		}
 
+		// Opaque planes never overlap, so they can be drawn in any order. Keeping the ones with
+		// the same flat, height and light together lets them share the span setup and keeps the
+		// drawers working on one texture at a time.
+		std::sort(DrawPlanes.begin(), DrawPlanes.end(), [](VisiblePlane *a, VisiblePlane *b)
+		{
+			if (a->picnum != b->picnum) return a->picnum.GetIndex() < b->picnum.GetIndex();
+			if (a->height.fD() != b->height.fD()) return a->height.fD() < b->height.fD();
+			if (a->colormap != b->colormap) return a->colormap < b->colormap;
+			if (a->lightlevel != b->lightlevel) return a->lightlevel < b->lightlevel;
+			return a->left < b->left;
+		});
+
+		RenderFlatPlane flatrenderer(Thread);
+		for (VisiblePlane *plane : DrawPlanes)
+		{
+			plane->Render(Thread, OPAQUE, false, false, &flatrenderer);
+		}
+		BatchedPlanes += flatrenderer.ReusedSetups;
+
 		if (Thread->MainThread)
 			PlaneCycles.Unclock();
 
 		return vpcount;
 	}
 
+	const double *VisiblePlaneList::GetRowScale()
+	{
+		auto viewport = Thread->Viewport.get();
+		if (RowScaleCenterY != viewport->CenterY || RowScaleFocalLengthY != viewport->FocalLengthY || RowScaleHeight != viewheight)
+		{
+			RowScaleCenterY = viewport->CenterY;
+			RowScaleFocalLengthY = viewport->FocalLengthY;
+			RowScaleHeight = viewheight;
+			for (int y = 0; y <= viewheight; y++)
+				RowScale[y] = viewport->PlaneDepth(y, 1.0);
+		}
+		return RowScale;
+	}
+
 	void VisiblePlaneList::RenderHeight(double height)
 	{
 		VisiblePlane *pl;
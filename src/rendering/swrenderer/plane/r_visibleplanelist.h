@@ -50,12 +50,26 @@ namespace swrenderer
 		int Render();
 		void RenderHeight(double height);
 
+		// Distance to a plane one unit away from the eye, for each screen row
+		const double *GetRowScale();
+
 		RenderThread *Thread = nullptr;
 
+		int CreatedPlanes = 0;
+		int MergedPlanes = 0;
+		int BatchedPlanes = 0;
+
 	private:
 		VisiblePlaneList();
 		VisiblePlane *Add(unsigned hash);
 
+		TArray<VisiblePlane *> DrawPlanes;
+
+		double RowScale[MAXHEIGHT + 1];
+		double RowScaleCenterY = 0.0;
+		double RowScaleFocalLengthY = 0.0;
+		int RowScaleHeight = -1;
+
 		enum { MAXVISPLANES = 128 }; // must be a power of 2
 		VisiblePlane *visplanes[MAXVISPLANES + 1];
 
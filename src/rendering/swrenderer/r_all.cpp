@@ -2,11 +2,14 @@
 #include "r_memory.cpp"
 #include "r_renderthread.cpp"
 #include "r_swrenderer.cpp"
+#include "r_memoryframebuffer.cpp"
+#include "r_benchmark.cpp"
 #include "r_swcolormaps.cpp"
 #include "drawers/r_draw.cpp"
 #include "drawers/r_draw_pal.cpp"
 #include "drawers/r_draw_rgba.cpp"
 #include "drawers/r_thread.cpp"
+#include "drawers/r_lightramp.cpp"
 #include "line/r_fogboundary.cpp"
 #include "line/r_line.cpp"
 #include "line/r_farclip_line.cpp"
@@ -21,6 +24,7 @@
 #include "plane/r_visibleplanelist.cpp"
 #include "scene/r_3dfloors.cpp"
 #include "scene/r_light.cpp"
+#include "scene/r_occlusion.cpp"
 #include "scene/r_opaque_pass.cpp"
 #include "scene/r_portal.cpp"
 #include "scene/r_scene.cpp"
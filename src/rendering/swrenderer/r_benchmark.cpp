@@ -0,0 +1,313 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// swbenchmark [map ...]
+//
+// Renders a fixed set of views of each listed map (or of the current level)
+// with the active software renderer and prints the per-stage frame times
+// plus a hash of every image. The views are the first player start and the
+// centers of evenly spaced sectors, looking in the four axis directions, so
+// they are the same from run to run and the hashes can be compared between
+// builds. When started with -headless the game quits once all maps are done.
+//
+//-----------------------------------------------------------------------------
+
+#include "templates.h"
+#include "doomstat.h"
+#include "d_event.h"
+#include "c_dispatch.h"
+#include "c_cvars.h"
+#include "g_game.h"
+#include "g_level.h"
+#include "g_levellocals.h"
+#include "p_setup.h"
+#include "actor.h"
+#include "i_video.h"
+#include "m_crc32.h"
+#include "r_utility.h"
+#include "doomerrors.h"
+#include "swrenderer/r_benchmark.h"
+#include "swrenderer/r_swrenderer.h"
+#include "swrenderer/scene/r_scene.h"
+#include "polyrenderer/poly_renderer.h"
+
+CVAR(Int, r_benchmark_sectors, 16, 0)	// number of sectors sampled per map
+CVAR(Int, r_benchmark_repeat, 8, 0)		// timed renders per view, after one untimed warm-up render
+
+struct BenchmarkViewpoint
+{
+	DVector3 Pos;
+	DAngle Yaw;
+};
+
+struct BenchmarkTimes
+{
+	enum { NumStages = 4 };
+
+	int Count = 0;
+	double Frame = 0.0;
+	double Stages[NumStages] = { 0.0, 0.0, 0.0, 0.0 };
+
+	void AddFrame(double frame)
+	{
+		Count++;
+		Frame += frame;
+		if (V_IsPolyRenderer())
+		{
+			Stages[0] += PolyCullCycles.TimeMS();
+			Stages[1] += PolyOpaqueCycles.TimeMS();
+			Stages[2] += PolyMaskedCycles.TimeMS();
+			Stages[3] += PolyDrawerWaitCycles.TimeMS();
+		}
+		else
+		{
+			Stages[0] += swrenderer::WallCycles.TimeMS();
+			Stages[1] += swrenderer::PlaneCycles.TimeMS();
+			Stages[2] += swrenderer::MaskedCycles.TimeMS();
+			Stages[3] += swrenderer::DrawerWaitCycles.TimeMS();
+		}
+	}
+
+	void Add(const BenchmarkTimes &other)
+	{
+		Count += other.Count;
+		Frame += other.Frame;
+		for (int i = 0; i < NumStages; i++)
+			Stages[i] += other.Stages[i];
+	}
+
+	FString Format() const
+	{
+		static const char *const swstages[NumStages] = { "walls", "planes", "masked", "drawers" };
+		static const char *const polystages[NumStages] = { "cull", "opaque", "masked", "drawers" };
+		const char *const *names = V_IsPolyRenderer() ? polystages : swstages;
+
+		double scale = Count > 0 ? 1.0 / Count : 0.0;
+		FString out;
+		out.Format("frame=%.3f ms", Frame * scale);
+		for (int i = 0; i < NumStages; i++)
+			out.AppendFormat("  %s=%.3f ms", names[i], Stages[i] * scale);
+		return out;
+	}
+};
+
+static TArray<FString> BenchmarkMaps;
+static bool BenchmarkRunning;
+static BenchmarkTimes BenchmarkTotal;
+static uint32_t BenchmarkHash;
+static int BenchmarkLevels;
+
+static const double BenchmarkViewHeight = 41.0;
+
+//==========================================================================
+//
+// Picks the views for a level. Sectors that are closed (doors, lifts)
+// are skipped since the camera would see nothing but their own planes.
+//
+//==========================================================================
+
+static void CollectViewpoints(FLevelLocals *Level, TArray<BenchmarkViewpoint> &views)
+{
+	auto addview = [&](const DVector2 &spot, DAngle yaw)
+	{
+		sector_t *sec = Level->PointInSector(spot);
+		double floorz = sec->floorplane.ZatPoint(spot);
+		double ceilingz = sec->ceilingplane.ZatPoint(spot);
+		if (ceilingz - floorz >= 8)
+		{
+			views.Push({ DVector3(spot, MIN(floorz + BenchmarkViewHeight, ceilingz - 4)), yaw });
+		}
+	};
+
+	const FPlayerStart &start = Level->playerstarts[0];
+	if (start.type != 0)
+	{
+		addview(start.pos.XY(), DAngle(double(start.angle)));
+	}
+
+	int numsectors = Level->sectors.Size();
+	int count = MIN<int>(r_benchmark_sectors, numsectors);
+	for (int i = 0; i < count; i++)
+	{
+		const sector_t &sec = Level->sectors[(int)((int64_t)i * numsectors / count)];
+		for (int angle = 0; angle < 360; angle += 90)
+		{
+			addview(sec.centerspot, DAngle(double(angle)));
+		}
+	}
+}
+
+static uint32_t HashCanvas(const DCanvas &canvas)
+{
+	int pixelsize = canvas.IsBgra() ? 4 : 1;
+	const uint8_t *line = canvas.GetPixels();
+	uint32_t hash = 0;
+	for (int y = 0; y < canvas.GetHeight(); y++)
+	{
+		hash = AddCRC32(hash, line, canvas.GetWidth() * pixelsize);
+		line += canvas.GetPitch() * pixelsize;
+	}
+	return hash;
+}
+
+//==========================================================================
+//
+// Renders every view of the level through a temporary camera actor.
+// Interpolation is disabled so that moving sectors and actors are drawn
+// at their current position and the images do not depend on frame timing.
+//
+//==========================================================================
+
+static void RunLevelBenchmark(FLevelLocals *Level)
+{
+	TArray<BenchmarkViewpoint> views;
+	CollectViewpoints(Level, views);
+	if (views.Size() == 0)
+	{
+		Printf("%s: no usable views\n", Level->MapName.GetChars());
+		return;
+	}
+
+	auto renderer = static_cast<FSoftwareRenderer *>(SWRenderer);
+	DCanvas canvas(SCREENWIDTH, SCREENHEIGHT, V_IsTrueColor());
+	int repeat = MAX<int>(r_benchmark_repeat, 1);
+	bool savedNoInterpolate = r_NoInterpolate;
+
+	BenchmarkTimes leveltimes;
+	uint32_t levelhash = 0;
+	AActor *camera = Spawn(Level, NAME_MapSpot, views[0].Pos, NO_REPLACE);
+
+	// The camera must not stay in the level, even if rendering a view fails.
+	try
+	{
+		for (unsigned i = 0; i < views.Size(); i++)
+		{
+			const BenchmarkViewpoint &view = views[i];
+			camera->SetOrigin(view.Pos.X, view.Pos.Y, view.Pos.Z - camera->GetCameraHeight(), false);
+			camera->Angles.Yaw = view.Yaw;
+			camera->Angles.Pitch = 0.;
+			camera->ClearInterpolation();
+
+			BenchmarkTimes viewtimes;
+			for (int pass = 0; pass <= repeat; pass++)
+			{
+				r_NoInterpolate = true;
+
+				cycle_t frame;
+				frame.Reset();
+				frame.Clock();
+				renderer->RenderViewToCanvas(camera, &canvas, true);
+				frame.Unclock();
+
+				// The first render only warms up the texture and sprite caches
+				if (pass > 0)
+					viewtimes.AddFrame(frame.TimeMS());
+			}
+
+			uint32_t hash = HashCanvas(canvas);
+			levelhash = AddCRC32(levelhash, (const uint8_t *)&hash, sizeof(hash));
+			leveltimes.Add(viewtimes);
+
+			Printf("%s view %u (%.0f, %.0f, %.0f, %.0f): %s  hash=%08x\n", Level->MapName.GetChars(), i,
+				view.Pos.X, view.Pos.Y, view.Pos.Z, view.Yaw.Degrees, viewtimes.Format().GetChars(), hash);
+		}
+	}
+	catch (...)
+	{
+		camera->Destroy();
+		r_NoInterpolate = savedNoInterpolate;
+		throw;
+	}
+
+	camera->Destroy();
+	r_NoInterpolate = savedNoInterpolate;
+
+	Printf("%s: %u views, %s  hash=%08x\n", Level->MapName.GetChars(), views.Size(), leveltimes.Format().GetChars(), levelhash);
+
+	BenchmarkTotal.Add(leveltimes);
+	BenchmarkHash = AddCRC32(BenchmarkHash, (const uint8_t *)&levelhash, sizeof(levelhash));
+	BenchmarkLevels++;
+}
+
+void CheckSWBenchmark()
+{
+	if (!BenchmarkRunning || gamestate != GS_LEVEL || gameaction != ga_nothing)
+		return;
+
+	RunLevelBenchmark(primaryLevel);
+
+	if (BenchmarkMaps.Size() > 0)
+		BenchmarkMaps.Delete(0);
+	if (BenchmarkMaps.Size() > 0)
+	{
+		G_DeferedInitNew(BenchmarkMaps[0]);
+		return;
+	}
+
+	BenchmarkRunning = false;
+	Printf("Benchmark finished: %d %s, %s  hash=%08x\n", BenchmarkLevels, BenchmarkLevels == 1 ? "map" : "maps",
+		BenchmarkTotal.Format().GetChars(), BenchmarkHash);
+
+	if (I_IsHeadless())
+		AddCommandString("quit");
+}
+
+CCMD(swbenchmark)
+{
+	if (V_IsHardwareRenderer())
+	{
+		Printf("swbenchmark measures the software renderers. Set vid_rendermode to 0-3 first.\n");
+		return;
+	}
+	if (netgame)
+	{
+		Printf("swbenchmark is for single-player only.\n");
+		return;
+	}
+
+	BenchmarkMaps.Clear();
+	for (int i = 1; i < argv.argc(); i++)
+	{
+		try
+		{
+			if (!P_CheckMapData(argv[i]))
+				Printf("No map %s\n", argv[i]);
+			else
+				BenchmarkMaps.Push(argv[i]);
+		}
+		catch (CRecoverableError &error)
+		{
+			if (error.GetMessage())
+				Printf("%s", error.GetMessage());
+		}
+	}
+
+	if (BenchmarkMaps.Size() == 0 && (argv.argc() > 1 || gamestate != GS_LEVEL))
+	{
+		Printf("Usage: swbenchmark [map ...]\nWithout maps the current level is measured.\n");
+		return;
+	}
+
+	BenchmarkTotal = {};
+	BenchmarkHash = 0;
+	BenchmarkLevels = 0;
+	BenchmarkRunning = true;
+	if (BenchmarkMaps.Size() > 0)
+		G_DeferedInitNew(BenchmarkMaps[0]);
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Runs the views queued by the swbenchmark command once a level is ready. Called for every presented frame.
+void CheckSWBenchmark();
@@ -37,33 +37,107 @@
 #include "po_man.h"
 #include "r_data/colormaps.h"
 #include "r_memory.h"
+#include "stats.h"
+#include <mutex>
 
-void *RenderMemory::AllocBytes(int size)
+// All arenas in use, so their statistics can be displayed.
+// Deliberately never freed: arenas owned by static objects may unregister during shutdown.
+struct RenderMemoryRegistry
 {
-	size = (size + 15) / 16 * 16; // 16-byte align
-		
-	if (UsedBlocks.empty() || UsedBlocks.back()->Position + size > BlockSize)
+	std::mutex Mutex;
+	std::vector<RenderMemory *> Arenas;
+};
+
+static RenderMemoryRegistry &GetRenderMemoryRegistry()
+{
+	static RenderMemoryRegistry *registry = new RenderMemoryRegistry();
+	return *registry;
+}
+
+RenderMemory::RenderMemory(const char *name) : ArenaName(name)
+{
+	auto &registry = GetRenderMemoryRegistry();
+	std::unique_lock<std::mutex> lock(registry.Mutex);
+	registry.Arenas.push_back(this);
+}
+
+RenderMemory::~RenderMemory()
+{
+	auto &registry = GetRenderMemoryRegistry();
+	std::unique_lock<std::mutex> lock(registry.Mutex);
+	auto &arenas = registry.Arenas;
+	for (size_t i = 0; i < arenas.size(); i++)
 	{
-		if (!FreeBlocks.empty())
-		{
-			auto block = std::move(FreeBlocks.back());
-			block->Position = 0;
-			FreeBlocks.pop_back();
-			UsedBlocks.push_back(std::move(block));
-		}
-		else
+		if (arenas[i] == this)
 		{
-			UsedBlocks.push_back(std::unique_ptr<MemoryBlock>(new MemoryBlock()));
+			arenas.erase(arenas.begin() + i);
+			break;
 		}
 	}
-		
+}
+
+RenderMemory *RenderMemory::ThreadArena()
+{
+	static thread_local std::unique_ptr<RenderMemory> arena;
+	if (!arena)
+	{
+		arena.reset(new RenderMemory("thread"));
+		arena->IsThreadArena = true;
+	}
+	return arena.get();
+}
+
+void RenderMemory::ClearThreadArenas()
+{
+	// Only safe to call while no other thread is allocating from its arena
+	auto &registry = GetRenderMemoryRegistry();
+	std::unique_lock<std::mutex> lock(registry.Mutex);
+	for (RenderMemory *arena : registry.Arenas)
+	{
+		if (arena->IsThreadArena)
+			arena->Clear();
+	}
+}
+
+void *RenderMemory::AllocBytes(int size)
+{
+	size = (size + 15) / 16 * 16; // 16-byte align
+
+	if (UsedBlocks.empty() || UsedBlocks.back()->Position + size > UsedBlocks.back()->Size)
+	{
+		NextBlock(size);
+	}
+
 	auto &block = UsedBlocks.back();
 	void *data = block->Data + block->Position;
 	block->Position += size;
+	FrameBytes += size;
 
 	return data;
 }
-	
+
+void RenderMemory::NextBlock(uint32_t size)
+{
+	// Oversized requests get a block of their own. Those are kept like any other block so
+	// that a request of the same size in the next frame doesn't go to the heap again.
+	for (size_t i = FreeBlocks.size(); i > 0; i--)
+	{
+		if (FreeBlocks[i - 1]->Size >= size)
+		{
+			auto block = std::move(FreeBlocks[i - 1]);
+			FreeBlocks.erase(FreeBlocks.begin() + (i - 1));
+			block->Position = 0;
+			UsedBlocks.push_back(std::move(block));
+			return;
+		}
+	}
+
+	uint32_t blocksize = size > (uint32_t)BlockSize ? size : (uint32_t)BlockSize;
+	UsedBlocks.push_back(std::unique_ptr<MemoryBlock>(new MemoryBlock(blocksize)));
+	ReservedBytes += blocksize;
+	FrameBlockAllocs++;
+}
+
 void RenderMemory::Clear()
 {
 	while (!UsedBlocks.empty())
@@ -72,4 +146,61 @@ void RenderMemory::Clear()
 		UsedBlocks.pop_back();
 		FreeBlocks.push_back(std::move(block));
 	}
+
+	LastBytes = FrameBytes;
+	if (FrameBytes > PeakBytes)
+		PeakBytes = FrameBytes;
+	LastFrameBlockAllocs = FrameBlockAllocs;
+	FrameBytes = 0;
+	FrameBlockAllocs = 0;
+}
+
+//==========================================================================
+//
+// Frame arena usage, summed up per arena name
+//
+//==========================================================================
+
+ADD_STAT(framememory)
+{
+	struct ArenaStats
+	{
+		const char *Name;
+		int Count;
+		size_t LastFrame, Peak, Reserved;
+		int Blocks, HeapAllocs;
+	};
+	TArray<ArenaStats> stats;
+
+	auto &registry = GetRenderMemoryRegistry();
+	{
+		std::unique_lock<std::mutex> lock(registry.Mutex);
+		for (RenderMemory *arena : registry.Arenas)
+		{
+			unsigned i;
+			for (i = 0; i < stats.Size(); i++)
+			{
+				if (strcmp(stats[i].Name, arena->Name()) == 0)
+					break;
+			}
+			if (i == stats.Size())
+				stats.Push({ arena->Name(), 0, 0, 0, 0, 0, 0 });
+
+			ArenaStats &s = stats[i];
+			s.Count++;
+			s.LastFrame += arena->LastFrameBytes();
+			s.Peak += arena->HighWaterMark();
+			s.Reserved += arena->BytesReserved();
+			s.Blocks += arena->BlockCount();
+			s.HeapAllocs += arena->LastFrameHeapAllocations();
+		}
+	}
+
+	FString out;
+	for (auto &s : stats)
+	{
+		out.AppendFormat("%s (%d): last frame %dK, peak %dK, reserved %dK in %d blocks, %d heap allocations last frame\n",
+			s.Name, s.Count, (int)(s.LastFrame >> 10), (int)(s.Peak >> 10), (int)(s.Reserved >> 10), s.Blocks, s.HeapAllocs);
+	}
+	return out;
 }
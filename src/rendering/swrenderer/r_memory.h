@@ -7,37 +7,66 @@
 class RenderMemory
 {
 public:
+	RenderMemory(const char *name = "frame");
+	~RenderMemory();
+
+	RenderMemory(const RenderMemory &) = delete;
+	RenderMemory &operator=(const RenderMemory &) = delete;
+
 	void Clear();
-		
+
 	template<typename T>
 	T *AllocMemory(int size = 1)
 	{
 		return (T*)AllocBytes(sizeof(T) * size);
 	}
-		
+
 	template<typename T, typename... Types>
 	T *NewObject(Types &&... args)
 	{
 		void *ptr = AllocBytes(sizeof(T));
 		return new (ptr)T(std::forward<Types>(args)...);
 	}
-		
+
+	// Arena owned by the calling thread, for renderers that have no per-thread state of their own.
+	// All of them are cleared together by ClearThreadArenas once the frame no longer needs them.
+	static RenderMemory *ThreadArena();
+	static void ClearThreadArenas();
+
+	const char *Name() const { return ArenaName; }
+	size_t LastFrameBytes() const { return LastBytes; }
+	size_t HighWaterMark() const { return PeakBytes; }
+	size_t BytesReserved() const { return ReservedBytes; }
+	int BlockCount() const { return (int)(UsedBlocks.size() + FreeBlocks.size()); }
+	int LastFrameHeapAllocations() const { return LastFrameBlockAllocs; }
+
 private:
 	void *AllocBytes(int size);
-		
+	void NextBlock(uint32_t size);
+
 	enum { BlockSize = 1024 * 1024 };
-		
+
 	struct MemoryBlock
 	{
-		MemoryBlock() : Data(new uint8_t[BlockSize]), Position(0) { }
+		MemoryBlock(uint32_t size) : Data(new uint8_t[size]), Size(size), Position(0) { }
 		~MemoryBlock() { delete[] Data; }
-			
+
 		MemoryBlock(const MemoryBlock &) = delete;
 		MemoryBlock &operator=(const MemoryBlock &) = delete;
-			
+
 		uint8_t *Data;
+		uint32_t Size;
 		uint32_t Position;
 	};
 	std::vector<std::unique_ptr<MemoryBlock>> UsedBlocks;
 	std::vector<std::unique_ptr<MemoryBlock>> FreeBlocks;
+
+	const char *ArenaName;
+	bool IsThreadArena = false;
+	size_t FrameBytes = 0;
+	size_t LastBytes = 0;
+	size_t PeakBytes = 0;
+	size_t ReservedBytes = 0;
+	int FrameBlockAllocs = 0;
+	int LastFrameBlockAllocs = 0;
 };
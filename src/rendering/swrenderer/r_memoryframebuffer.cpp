@@ -0,0 +1,248 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+
+#include "r_memoryframebuffer.h"
+#include "r_renderer.h"
+#include "r_utility.h"
+#include "m_argv.h"
+#include "c_console.h"
+#include "v_palette.h"
+#include "hwrenderer/data/buffers.h"
+#include "hwrenderer/data/flatvertices.h"
+#include "hwrenderer/dynlights/hw_lightbuffer.h"
+#include "hwrenderer/scene/hw_skydome.h"
+
+EXTERN_CVAR(Int, vid_defwidth)
+EXTERN_CVAR(Int, vid_defheight)
+
+bool I_IsHeadless()
+{
+	static bool headless = !!Args->CheckParm("-headless");
+	return headless;
+}
+
+//==========================================================================
+//
+// MemoryVideo
+//
+//==========================================================================
+
+DFrameBuffer *MemoryVideo::CreateFrameBuffer()
+{
+	return new MemoryFrameBuffer(vid_defwidth, vid_defheight);
+}
+
+//==========================================================================
+//
+// Hardware renderer buffers that are nothing but system memory
+//
+//==========================================================================
+
+class MemoryBuffer : virtual public IBuffer
+{
+public:
+	void SetData(size_t size, const void *data, bool staticdata) override
+	{
+		Resize(size);
+		if (data != nullptr) memcpy(map, data, size);
+	}
+
+	void SetSubData(size_t offset, size_t size, const void *data) override
+	{
+		memcpy((uint8_t*)map + offset, data, size);
+	}
+
+	void *Lock(unsigned int size) override
+	{
+		SetData(size, nullptr, true);
+		return map;
+	}
+
+	void Unlock() override
+	{
+	}
+
+	void Resize(size_t newsize) override
+	{
+		Data.Resize((unsigned)newsize);
+		map = Data.Data();
+		buffersize = newsize;
+	}
+
+private:
+	TArray<uint8_t> Data;
+};
+
+class MemoryVertexBuffer : public IVertexBuffer, public MemoryBuffer
+{
+public:
+	void SetFormat(int numBindingPoints, int numAttributes, size_t stride, const FVertexBufferAttribute *attrs) override
+	{
+	}
+};
+
+class MemoryIndexBuffer : public IIndexBuffer, public MemoryBuffer
+{
+};
+
+class MemoryDataBuffer : public IDataBuffer, public MemoryBuffer
+{
+public:
+	void BindRange(size_t start, size_t length) override
+	{
+	}
+
+	void BindBase() override
+	{
+	}
+};
+
+//==========================================================================
+//
+// MemoryFrameBuffer
+//
+//==========================================================================
+
+MemoryFrameBuffer::MemoryFrameBuffer(int width, int height) : DFrameBuffer(width, height)
+{
+	ClientWidth = MAX(width, VID_MIN_WIDTH);
+	ClientHeight = MAX(height, VID_MIN_HEIGHT);
+}
+
+MemoryFrameBuffer::~MemoryFrameBuffer()
+{
+	delete mVertexData;
+	delete mSkyData;
+	delete mLights;
+	mVertexData = nullptr;
+	mSkyData = nullptr;
+	mLights = nullptr;
+}
+
+void MemoryFrameBuffer::InitializeState()
+{
+	// There is no hardware renderer without a GPU context, so fall back to its closest software equivalent.
+	if (V_IsHardwareRenderer())
+	{
+		Printf("Hardware rendering is not available in headless mode. Using the true color software renderer.\n");
+		vid_rendermode = 1;
+	}
+
+	// Its scene setup does not need one though. With persistent buffers it writes its vertices and lights straight into memory.
+	hwcaps = RFL_SHADER_STORAGE_BUFFER | RFL_BUFFER_STORAGE;
+	gl_vendorstring = "headless";
+	mVertexData = new FFlatVertexBuffer(GetWidth(), GetHeight());
+	mSkyData = new FSkyVertexBuffer;
+	mLights = new FLightBuffer();
+}
+
+void MemoryFrameBuffer::BeginFrame()
+{
+	SetViewportRects(nullptr);
+	SceneValid = false;
+}
+
+void MemoryFrameBuffer::Update()
+{
+	// Nothing consumes the 2D draw lists, so they only need to be emptied for the next frame.
+	Clear2D();
+	Super::Update();
+}
+
+//==========================================================================
+//
+// Renders the scene straight into a canvas owned by the frame buffer.
+// The player sprites that are normally composited by the 2D drawer are
+// dropped along with the rest of the 2D output.
+//
+//==========================================================================
+
+sector_t *MemoryFrameBuffer::RenderView(player_t *player)
+{
+	int width = GetWidth();
+	int height = GetHeight();
+	bool bgra = V_IsTrueColor();
+
+	if (Canvas == nullptr || Canvas->GetWidth() != width || Canvas->GetHeight() != height || Canvas->IsBgra() != bgra)
+	{
+		Canvas.reset(new DCanvas(width, height, bgra));
+		SceneBuffer.Resize(width * height * (bgra ? 4 : 1));
+	}
+
+	SWRenderer->RenderView(player, Canvas.get(), SceneBuffer.Data());
+	SceneValid = true;
+
+	return r_viewpoint.sector;
+}
+
+//==========================================================================
+//
+// Screenshots are taken from the last rendered scene.
+//
+//==========================================================================
+
+TArray<uint8_t> MemoryFrameBuffer::GetScreenshotBuffer(int &pitch, ESSType &color_type, float &gamma)
+{
+	if (!SceneValid || Canvas->GetWidth() != GetWidth() || Canvas->GetHeight() != GetHeight())
+		return TArray<uint8_t>();
+
+	int count = Canvas->GetWidth() * Canvas->GetHeight();
+	TArray<uint8_t> pixels(count * 3, true);
+	if (!Canvas->IsBgra())
+	{
+		for (int i = 0; i < count; i++)
+		{
+			PalEntry pe = GPalette.BaseColors[SceneBuffer[i]];
+			pixels[i * 3] = pe.r;
+			pixels[i * 3 + 1] = pe.g;
+			pixels[i * 3 + 2] = pe.b;
+		}
+	}
+	else
+	{
+		const uint32_t *src = (const uint32_t *)SceneBuffer.Data();
+		for (int i = 0; i < count; i++)
+		{
+			PalEntry pe = src[i];
+			pixels[i * 3] = pe.r;
+			pixels[i * 3 + 1] = pe.g;
+			pixels[i * 3 + 2] = pe.b;
+		}
+	}
+
+	pitch = Canvas->GetWidth() * 3;
+	color_type = SS_RGB;
+	gamma = 1.0f;
+	return pixels;
+}
+
+IVertexBuffer *MemoryFrameBuffer::CreateVertexBuffer()
+{
+	return new MemoryVertexBuffer;
+}
+
+IIndexBuffer *MemoryFrameBuffer::CreateIndexBuffer()
+{
+	return new MemoryIndexBuffer;
+}
+
+IDataBuffer *MemoryFrameBuffer::CreateDataBuffer(int bindingpoint, bool ssbo)
+{
+	return new MemoryDataBuffer;
+}
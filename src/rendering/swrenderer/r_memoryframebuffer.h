@@ -0,0 +1,43 @@
+#pragma once
+
+#include "v_video.h"
+#include "i_video.h"
+#include <memory>
+
+// Frame buffer that keeps the software rendered scene in system memory instead of presenting it.
+// This is what -headless runs with: no window, no GPU context, and all 2D output is discarded.
+// The hardware renderer's buffers live in system memory too, so that its scene setup can still be run.
+class MemoryFrameBuffer : public DFrameBuffer
+{
+	typedef DFrameBuffer Super;
+
+public:
+	MemoryFrameBuffer(int width, int height);
+	~MemoryFrameBuffer();
+
+	void InitializeState() override;
+	bool IsFullscreen() override { return false; }
+	int GetClientWidth() override { return ClientWidth; }
+	int GetClientHeight() override { return ClientHeight; }
+	void BeginFrame() override;
+	void Update() override;
+	sector_t *RenderView(player_t *player) override;
+	TArray<uint8_t> GetScreenshotBuffer(int &pitch, ESSType &color_type, float &gamma) override;
+
+	IVertexBuffer *CreateVertexBuffer() override;
+	IIndexBuffer *CreateIndexBuffer() override;
+	IDataBuffer *CreateDataBuffer(int bindingpoint, bool ssbo) override;
+
+private:
+	int ClientWidth;
+	int ClientHeight;
+	std::unique_ptr<DCanvas> Canvas;
+	TArray<uint8_t> SceneBuffer;
+	bool SceneValid = false;
+};
+
+class MemoryVideo : public IVideo
+{
+public:
+	DFrameBuffer *CreateFrameBuffer() override;
+};
@@ -47,11 +47,13 @@
 #include "swrenderer/plane/r_visibleplanelist.h"
 #include "swrenderer/segments/r_drawsegment.h"
 #include "swrenderer/segments/r_clipsegment.h"
+#include "swrenderer/scene/r_occlusion.h"
 #include "swrenderer/drawers/r_thread.h"
 #include "swrenderer/drawers/r_draw.h"
 #include "swrenderer/drawers/r_draw_rgba.h"
 #include "swrenderer/drawers/r_draw_pal.h"
 #include "swrenderer/viewport/r_viewport.h"
+#include "polyrenderer/drawers/poly_triangle.h"
 #include "r_memory.h"
 
 namespace swrenderer
@@ -60,7 +62,8 @@ namespace swrenderer
 	{
 		Scene = scene;
 		MainThread = mainThread;
-		FrameMemory.reset(new RenderMemory());
+		FrameMemory.reset(new RenderMemory("swrenderer"));
+		ModelFrames.reset(new PolyModelFrameCache(FrameMemory.get()));
 		Viewport.reset(new RenderViewport());
 		Light.reset(new LightVisibility());
 		DrawQueue.reset(new DrawerCommandQueue(FrameMemory.get()));
@@ -73,6 +76,7 @@ namespace swrenderer
 		PlaneList.reset(new VisiblePlaneList(this));
 		DrawSegments.reset(new DrawSegmentList(this));
 		ClipSegments.reset(new RenderClipSegment());
+		Occlusion.reset(new SpriteOcclusionBuffer());
 		tc_drawers.reset(new SWTruecolorDrawers(DrawQueue));
 		pal_drawers.reset(new SWPalDrawers(DrawQueue));
 	}
@@ -28,6 +28,7 @@
 class DrawerCommandQueue;
 typedef std::shared_ptr<DrawerCommandQueue> DrawerCommandQueuePtr;
 class RenderMemory;
+class PolyModelFrameCache;
 struct FDynamicLight;
 
 EXTERN_CVAR(Bool, r_models);
@@ -46,6 +47,7 @@ namespace swrenderer
 	class VisiblePlaneList;
 	class DrawSegmentList;
 	class RenderClipSegment;
+	class SpriteOcclusionBuffer;
 	class RenderViewport;
 	class LightVisibility;
 	class SWPixelFormatDrawers;
@@ -63,7 +65,11 @@ namespace swrenderer
 		int X2 = MAXWIDTH;
 		bool MainThread = false;
 
+		// Time spent setting up this thread's slice of the main view in the last frame, in milliseconds
+		double SliceTime = 0.0;
+
 		std::unique_ptr<RenderMemory> FrameMemory;
+		std::unique_ptr<PolyModelFrameCache> ModelFrames;
 		std::unique_ptr<RenderOpaquePass> OpaquePass;
 		std::unique_ptr<RenderTranslucentPass> TranslucentPass;
 		std::unique_ptr<VisibleSpriteList> SpriteList;
@@ -73,6 +79,7 @@ namespace swrenderer
 		std::unique_ptr<VisiblePlaneList> PlaneList;
 		std::unique_ptr<DrawSegmentList> DrawSegments;
 		std::unique_ptr<RenderClipSegment> ClipSegments;
+		std::unique_ptr<SpriteOcclusionBuffer> Occlusion;
 		std::unique_ptr<RenderViewport> Viewport;
 		std::unique_ptr<LightVisibility> Light;
 		DrawerCommandQueuePtr DrawQueue;
@@ -48,6 +48,7 @@
 #include "textures/textures.h"
 #include "r_data/voxels.h"
 #include "drawers/r_draw_rgba.h"
+#include "drawers/r_lightramp.h"
 #include "polyrenderer/poly_renderer.h"
 #include "p_setup.h"
 #include "g_levellocals.h"
@@ -168,6 +169,10 @@ void FSoftwareRenderer::Precache(uint8_t *texhitlist, TMap<PClassActor*, bool> &
 	}
 	delete[] spritelist;
 
+	// The new level's colormaps get the light ramp cache to themselves
+	DrawerThreads::WaitForWorkers();
+	LightRamp::Reset();
+
 	int cnt = TexMan.NumTextures();
 
 	FImageSource::BeginPrecaching();
@@ -175,6 +180,7 @@ void FSoftwareRenderer::Precache(uint8_t *texhitlist, TMap<PClassActor*, bool> &
 	{
 		PreparePrecache(TexMan.ByIndex(i), texhitlist[i]);
 	}
+	FImageSource::StartAsyncDecoding();
 
 	for (int i = cnt - 1; i >= 0; i--)
 	{
@@ -234,6 +240,26 @@ void FSoftwareRenderer::WriteSavePic (player_t *player, FileWriter *file, int wi
 	DoWriteSavePic(file, SS_PAL, pic.GetPixels(), width, height, r_viewpoint.sector, false);
 }
 
+void FSoftwareRenderer::RenderViewToCanvas(AActor *actor, DCanvas *canvas, bool dontmaplines)
+{
+	if (V_IsPolyRenderer())
+	{
+		PolyRenderer::Instance()->Viewpoint = r_viewpoint;
+		PolyRenderer::Instance()->Viewwindow = r_viewwindow;
+		PolyRenderer::Instance()->RenderViewToCanvas(actor, canvas, 0, 0, canvas->GetWidth(), canvas->GetHeight(), dontmaplines);
+		r_viewpoint = PolyRenderer::Instance()->Viewpoint;
+		r_viewwindow = PolyRenderer::Instance()->Viewwindow;
+	}
+	else
+	{
+		mScene.MainThread()->Viewport->viewpoint = r_viewpoint;
+		mScene.MainThread()->Viewport->viewwindow = r_viewwindow;
+		mScene.RenderViewToCanvas(actor, canvas, 0, 0, canvas->GetWidth(), canvas->GetHeight(), dontmaplines);
+		r_viewpoint = mScene.MainThread()->Viewport->viewpoint;
+		r_viewwindow = mScene.MainThread()->Viewport->viewwindow;
+	}
+}
+
 void FSoftwareRenderer::DrawRemainingPlayerSprites()
 {
 	if (!V_IsPolyRenderer())
@@ -17,6 +17,9 @@ struct FSoftwareRenderer : public FRenderer
 	// renders view to a savegame picture
 	void WriteSavePic (player_t *player, FileWriter *file, int width, int height) override;
 
+	// renders an arbitrary actor's view into a canvas of its own size with whichever software renderer is active
+	void RenderViewToCanvas(AActor *actor, DCanvas *canvas, bool dontmaplines);
+
 	// draws player sprites with hardware acceleration (only useful for software rendering)
 	void DrawRemainingPlayerSprites() override;
 
@@ -0,0 +1,133 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include "templates.h"
+#include "doomdef.h"
+#include "c_cvars.h"
+#include "swrenderer/scene/r_occlusion.h"
+
+CVAR(Bool, r_spriteocclusion, true, 0);
+
+namespace swrenderer
+{
+	void SpriteOcclusionBuffer::Clear(int width, int height)
+	{
+		Active = r_spriteocclusion;
+		Width = width;
+		Height = height;
+		CulledSprites = 0;
+
+		for (int x = 0; x < width; x++)
+		{
+			Top[x] = 0;
+			Bottom[x] = height;
+			Depth[x] = 0.0f;
+		}
+
+		int numblocks = (width + BlockSize - 1) >> BlockShift;
+		for (int i = 0; i < numblocks; i++)
+		{
+			BlockTop[i] = 0;
+			BlockBottom[i] = height;
+			BlockDepth[i] = 0.0f;
+		}
+	}
+
+	void SpriteOcclusionBuffer::MarkOccluder(int x1, int x2, float fardepth, const short *topclip, const short *bottomclip)
+	{
+		x1 = MAX(x1, 0);
+		x2 = MIN(x2, Width);
+		if (!Active || x1 >= x2 || (!topclip && !bottomclip))
+			return;
+
+		// The clip lists start at the draw segment's first column
+		for (int x = x1; x < x2; x++)
+		{
+			bool changed = false;
+			if (topclip && topclip[x - x1] > Top[x])
+			{
+				Top[x] = topclip[x - x1];
+				changed = true;
+			}
+			if (bottomclip && bottomclip[x - x1] < Bottom[x])
+			{
+				Bottom[x] = bottomclip[x - x1];
+				changed = true;
+			}
+			if (changed)
+				Depth[x] = MAX(Depth[x], fardepth);
+		}
+
+		UpdateBlocks(x1, x2);
+	}
+
+	void SpriteOcclusionBuffer::UpdateBlocks(int x1, int x2)
+	{
+		int firstblock = x1 >> BlockShift;
+		int lastblock = (x2 - 1) >> BlockShift;
+		for (int block = firstblock; block <= lastblock; block++)
+		{
+			int start = block << BlockShift;
+			int end = MIN(start + BlockSize, Width);
+
+			short top = Top[start];
+			short bottom = Bottom[start];
+			float depth = Depth[start];
+			for (int x = start + 1; x < end; x++)
+			{
+				top = MIN(top, Top[x]);
+				bottom = MAX(bottom, Bottom[x]);
+				depth = MAX(depth, Depth[x]);
+			}
+			BlockTop[block] = top;
+			BlockBottom[block] = bottom;
+			BlockDepth[block] = depth;
+		}
+	}
+
+	bool SpriteOcclusionBuffer::IsOccluded(int x1, int x2, int y1, int y2, float depth)
+	{
+		x1 = MAX(x1, 0);
+		x2 = MIN(x2, Width);
+		if (!Active || x1 >= x2)
+			return false;
+
+		int x = x1;
+		while (x < x2)
+		{
+			int block = x >> BlockShift;
+			int blockend = MIN((block + 1) << BlockShift, x2);
+			if (x == (block << BlockShift) && blockend - x == BlockSize && IsBlockOccluded(block, y1, y2, depth))
+			{
+				x = blockend;
+				continue;
+			}
+
+			for (; x < blockend; x++)
+			{
+				if (!IsColumnOccluded(x, y1, y2, depth))
+					return false;
+			}
+		}
+
+		CulledSprites++;
+		return true;
+	}
+}
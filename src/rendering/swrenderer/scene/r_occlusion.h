@@ -0,0 +1,73 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "r_defs.h"
+
+EXTERN_CVAR(Bool, r_spriteocclusion);
+
+namespace swrenderer
+{
+	// Conservative record of the screen area hidden by the sprite clipping silhouettes of the
+	// draw segments produced so far. Each column keeps the rows covered from the top and from
+	// the bottom, plus the farthest depth of any wall that contributed to them. A sprite whose
+	// depth is behind that in every column it covers is clipped away completely by the draw
+	// segments later, so it can be dropped before it is ever added to the sprite list.
+	//
+	// A second, coarser level summarizes blocks of columns so most tests touch only a few entries.
+	class SpriteOcclusionBuffer
+	{
+	public:
+		void Clear(int width, int height);
+		void Disable() { Active = false; }
+
+		void MarkOccluder(int x1, int x2, float fardepth, const short *topclip, const short *bottomclip);
+		bool IsOccluded(int x1, int x2, int y1, int y2, float depth);
+
+		int CulledSprites = 0;
+
+	private:
+		bool IsColumnOccluded(int x, int y1, int y2, float depth) const
+		{
+			return Depth[x] < depth && (y2 <= Top[x] || y1 >= Bottom[x] || Top[x] >= Bottom[x]);
+		}
+
+		bool IsBlockOccluded(int block, int y1, int y2, float depth) const
+		{
+			return BlockDepth[block] < depth && (y2 <= BlockTop[block] || y1 >= BlockBottom[block] || BlockTop[block] >= BlockBottom[block]);
+		}
+
+		void UpdateBlocks(int x1, int x2);
+
+		enum { BlockShift = 3, BlockSize = 1 << BlockShift, NumBlocks = (MAXWIDTH + BlockSize - 1) / BlockSize };
+
+		bool Active = false;
+		int Width = 0;
+		int Height = 0;
+
+		short Top[MAXWIDTH];
+		short Bottom[MAXWIDTH];
+		float Depth[MAXWIDTH];
+
+		short BlockTop[NumBlocks];
+		short BlockBottom[NumBlocks];
+		float BlockDepth[NumBlocks];
+	};
+}
@@ -334,6 +334,20 @@ namespace swrenderer
 	// Checks BSP node/subtree bounding box.
 	// Returns true if some part of the bbox might be visible.
 	bool RenderOpaquePass::CheckBBox(float *bspcoord)
+	{
+		int sx1, sx2;
+		bool alwaysVisible;
+
+		if (!ProjectBBox(bspcoord, sx1, sx2, alwaysVisible))
+			return false;
+
+		// Find the first clippost that touches the source post
+		//	(adjacent pixels are touching).
+
+		return alwaysVisible || Thread->ClipSegments->IsVisible(sx1, sx2);
+	}
+
+	bool RenderOpaquePass::ProjectBBox(float *bspcoord, int &sx1, int &sx2, bool &alwaysVisible)
 	{
 		static const int checkcoord[12][4] =
 		{
@@ -356,7 +370,9 @@ namespace swrenderer
 
 		double	 			x1, y1, x2, y2;
 		double				rx1, ry1, rx2, ry2;
-		int					sx1, sx2;
+
+		alwaysVisible = false;
+		sx1 = sx2 = 0;
 
 		// Find the corners of the box
 		// that define the edges from current viewpoint.
@@ -376,7 +392,10 @@ namespace swrenderer
 
 		boxpos = (boxy << 2) + boxx;
 		if (boxpos == 5)
+		{
+			alwaysVisible = true;
 			return true;
+		}
 
 		x1 = bspcoord[checkcoord[boxpos][0]] - Thread->Viewport->viewpoint.Pos.X;
 		y1 = bspcoord[checkcoord[boxpos][1]] - Thread->Viewport->viewpoint.Pos.Y;
@@ -387,7 +406,10 @@ namespace swrenderer
 
 		// Sitting on a line?
 		if (y1 * (x1 - x2) + x1 * (y2 - y1) >= -EQUAL_EPSILON)
+		{
+			alwaysVisible = true;
 			return true;
+		}
 
 		rx1 = x1 * Thread->Viewport->viewpoint.Sin - y1 * Thread->Viewport->viewpoint.Cos;
 		rx2 = x2 * Thread->Viewport->viewpoint.Sin - y2 * Thread->Viewport->viewpoint.Cos;
@@ -430,10 +452,8 @@ namespace swrenderer
 			sx2 = viewwidth;
 		}
 
-		// Find the first clippost that touches the source post
-		//	(adjacent pixels are touching).
-
-		return Thread->ClipSegments->IsVisible(sx1, sx2);
+		// Does not cross a pixel.
+		return sx1 < sx2;
 	}
 
 	void RenderOpaquePass::AddPolyobjs(subsector_t *sub)
@@ -616,7 +636,7 @@ namespace swrenderer
 		if ((unsigned int)(sub->Index()) < Level->subsectors.Size())
 		{ // Only do it for the main BSP.
 			int lightlevel = (floorlightlevel + ceilinglightlevel) / 2;
-			for (int i = frontsector->Level->ParticlesInSubsec[sub->Index()]; i != NO_PARTICLE; i = frontsector->Level->Particles[i].snext)
+			for (uint32_t i = frontsector->Level->ParticlesInSubsec[sub->Index()]; i != NO_PARTICLE; i = frontsector->Level->Particles[i].snext)
 			{
 				RenderParticle::Project(Thread, &frontsector->Level->Particles[i], sub->sector, lightlevel, FakeSide, foggy);
 			}
@@ -819,7 +839,7 @@ namespace swrenderer
 		}
 	}
 
-	void RenderOpaquePass::RenderScene(FLevelLocals *Level)
+	void RenderOpaquePass::RenderScene(FLevelLocals *Level, const std::vector<BSPListEntry> *bsplist)
 	{
 		if (Thread->MainThread)
 			WallCycles.Clock();
@@ -833,7 +853,10 @@ namespace swrenderer
 		SeenActors.clear();
 
 		InSubsector = nullptr;
-		RenderBSPNode(Level->HeadNode());	// The head node is the last node output.
+		if (bsplist)
+			RenderBSPList(*bsplist);
+		else
+			RenderBSPNode(Level->HeadNode());	// The head node is the last node output.
 
 		if (Thread->MainThread)
 			WallCycles.Unclock();
@@ -872,6 +895,60 @@ namespace swrenderer
 		RenderSubsector((subsector_t *)((uint8_t *)node - 1));
 	}
 
+	//
+	// CollectBSPList
+	// Walks the BSP once for all slice threads. Everything that only depends on
+	// the viewpoint (node sides and the screen extents of the back children) is
+	// done here, while the tests against each thread's clip list are left to
+	// RenderBSPList. A subtree that is outside the view is dropped completely
+	// since no thread could see it either.
+	//
+
+	void RenderOpaquePass::CollectBSPList(FLevelLocals *Level, std::vector<BSPListEntry> &bsplist)
+	{
+		bsplist.clear();
+		if (Level->nodes.Size() == 0)
+			bsplist.push_back({ &Level->subsectors[0], 0, 0, 0, false });
+		else
+			CollectBSPNode(Level->HeadNode(), bsplist);
+	}
+
+	void RenderOpaquePass::CollectBSPNode(void *node, std::vector<BSPListEntry> &bsplist)
+	{
+		while (!((size_t)node & 1))
+		{
+			node_t *bsp = (node_t *)node;
+
+			int side = R_PointOnSide(Thread->Viewport->viewpoint.Pos, bsp);
+			CollectBSPNode(bsp->children[side], bsplist);
+
+			side ^= 1;
+			BSPListEntry check = { nullptr, 0, 0, 0, false };
+			if (!ProjectBBox(bsp->bbox[side], check.X1, check.X2, check.AlwaysVisible))
+				return;
+
+			size_t index = bsplist.size();
+			bsplist.push_back(check);
+			CollectBSPNode(bsp->children[side], bsplist);
+			bsplist[index].Skip = (uint32_t)(bsplist.size() - index - 1);
+			return;
+		}
+		bsplist.push_back({ (subsector_t *)((uint8_t *)node - 1), 0, 0, 0, false });
+	}
+
+	void RenderOpaquePass::RenderBSPList(const std::vector<BSPListEntry> &bsplist)
+	{
+		size_t count = bsplist.size();
+		for (size_t i = 0; i < count; i++)
+		{
+			const BSPListEntry &entry = bsplist[i];
+			if (entry.Sub)
+				RenderSubsector(entry.Sub);
+			else if (!entry.AlwaysVisible && !Thread->ClipSegments->IsVisible(entry.X1, entry.X2))
+				i += entry.Skip;
+		}
+	}
+
 	void RenderOpaquePass::ClearClip()
 	{
 		fillshort(floorclip, viewwidth, viewheight);
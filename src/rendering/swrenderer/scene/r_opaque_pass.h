@@ -27,6 +27,7 @@
 #include "swrenderer/line/r_line.h"
 #include "swrenderer/scene/r_3dfloors.h"
 #include <set>
+#include <vector>
 
 struct FVoxelDef;
 
@@ -58,13 +59,27 @@ namespace swrenderer
 		int renderflags;
 	};
 
+	// One step of a BSP traversal recorded by RenderOpaquePass::CollectBSPList.
+	// Subsector entries are rendered in order. Other entries are the visibility
+	// check of a back child: when X1..X2 is hidden, the following Skip entries
+	// belonging to that child are skipped. AlwaysVisible marks boxes the
+	// viewpoint is inside of, which never get tested against the clip list.
+	struct BSPListEntry
+	{
+		subsector_t *Sub;
+		int X1, X2;
+		uint32_t Skip;
+		bool AlwaysVisible;
+	};
+
 	class RenderOpaquePass
 	{
 	public:
 		RenderOpaquePass(RenderThread *thread);
 
 		void ClearClip();
-		void RenderScene(FLevelLocals *Level);
+		void RenderScene(FLevelLocals *Level, const std::vector<BSPListEntry> *bsplist = nullptr);
+		void CollectBSPList(FLevelLocals *Level, std::vector<BSPListEntry> &bsplist);
 
 		void ResetFakingUnderwater() { r_fakingunderwater = false; }
 		sector_t *FakeFlat(sector_t *sec, sector_t *tempsec, int *floorlightlevel, int *ceilinglightlevel, seg_t *backline, int backx1, int backx2, double frontcz1, double frontcz2);
@@ -82,6 +97,9 @@ namespace swrenderer
 		void RenderBSPNode(void *node);
 		void RenderSubsector(subsector_t *sub);
 		bool CheckBBox(float *bspcoord);
+		bool ProjectBBox(float *bspcoord, int &sx1, int &sx2, bool &alwaysVisible);
+		void CollectBSPNode(void *node, std::vector<BSPListEntry> &bsplist);
+		void RenderBSPList(const std::vector<BSPListEntry> &bsplist);
 
 		void AddPolyobjs(subsector_t *sub);
 
@@ -64,6 +64,7 @@
 #include "swrenderer/scene/r_translucent_pass.h"
 #include "swrenderer/scene/r_scene.h"
 #include "swrenderer/scene/r_light.h"
+#include "swrenderer/scene/r_occlusion.h"
 #include "swrenderer/viewport/r_viewport.h"
 #include "swrenderer/r_memory.h"
 #include "swrenderer/r_renderthread.h"
@@ -109,6 +110,9 @@ namespace swrenderer
 		if (!planes->HasPortalPlanes())
 			return;
 
+		// Portal views have their own depths and draw segments
+		Thread->Occlusion->Disable();
+
 		Thread->Clip3D->EnterSkybox();
 		CurrentPortalInSkybox = true;
 
@@ -273,6 +277,7 @@ namespace swrenderer
 	{
 		// [RH] Walk through mirrors
 		// [ZZ] Merged with portals
+		Thread->Occlusion->Disable();
 		size_t lastportal = WallPortals.Size();
 		for (unsigned int i = 0; i < lastportal; i++)
 		{
@@ -46,6 +46,7 @@
 #include "swrenderer/scene/r_opaque_pass.h"
 #include "swrenderer/scene/r_translucent_pass.h"
 #include "swrenderer/scene/r_portal.h"
+#include "swrenderer/scene/r_occlusion.h"
 #include "swrenderer/segments/r_clipsegment.h"
 #include "swrenderer/segments/r_drawsegment.h"
 #include "swrenderer/segments/r_portalsegment.h"
@@ -67,6 +68,8 @@ EXTERN_CVAR(Int, r_clearbuffer)
 EXTERN_CVAR(Int, r_debug_draw)
 
 CVAR(Int, r_scene_multithreaded, 0, 0);
+CVAR(Bool, r_scene_balance, true, 0);
+CVAR(Bool, r_scene_sharedbsp, true, 0);
 CVAR(Bool, r_models, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 
 bool r_modelscene = false;
@@ -74,6 +77,15 @@ bool r_modelscene = false;
 namespace swrenderer
 {
 	cycle_t WallCycles, PlaneCycles, MaskedCycles, DrawerWaitCycles;
+
+	struct SliceStat
+	{
+		int X1, X2;
+		double Time;
+	};
+	static TArray<SliceStat> SliceStats;
+	static int OccludedSprites;
+	static int CreatedPlanes, MergedPlanes, BatchedPlanes;
 	
 	RenderScene::RenderScene()
 	{
@@ -96,6 +108,8 @@ namespace swrenderer
 		viewport->RenderTarget = target;
 		viewport->RenderingToCanvas = false;
 
+		PolyModelFrameCache::NewFrame();
+
 		R_ExecuteSetViewSize(MainThread()->Viewport->viewpoint, MainThread()->Viewport->viewwindow);
 
 		int width = SCREENWIDTH;
@@ -108,6 +122,7 @@ namespace swrenderer
 		if (r_modelscene)
 		{
 			PolyTriangleDrawer::ResizeBuffers(viewport->RenderTarget);
+			PolyTriangleDrawer::SetTileBinning(MainThread()->DrawQueue, false); // Models share the render target with the column drawers
 			PolyTriangleDrawer::ClearStencil(MainThread()->DrawQueue, 0);
 		}
 
@@ -213,14 +228,35 @@ namespace swrenderer
 			StartThreads(numThreads);
 		}
 
+		// Camera textures get equal slices so that they don't disturb the balance of the main view.
+		bool balance = !MainThread()->Viewport->RenderingToCanvas;
+		if (balance)
+			UpdateSliceEdges(numThreads);
+
+		// With several threads, walk the BSP once up front instead of once per slice.
+		UseSharedBSPList = numThreads > 1 && r_scene_sharedbsp;
+		if (UseSharedBSPList)
+		{
+			MainThread()->Portal->SetMainPortal();
+			MainThread()->OpaquePass->CollectBSPList(MainThread()->Viewport->Level(), SharedBSPList);
+		}
+
 		// Setup threads:
 		std::unique_lock<std::mutex> start_lock(start_mutex);
 		for (int i = 0; i < numThreads; i++)
 		{
 			*Threads[i]->Viewport = *MainThread()->Viewport;
 			*Threads[i]->Light = *MainThread()->Light;
-			Threads[i]->X1 = viewwidth * i / numThreads;
-			Threads[i]->X2 = viewwidth * (i + 1) / numThreads;
+			if (balance)
+			{
+				Threads[i]->X1 = SliceEdges[i];
+				Threads[i]->X2 = SliceEdges[i + 1];
+			}
+			else
+			{
+				Threads[i]->X1 = viewwidth * i / numThreads;
+				Threads[i]->X2 = viewwidth * (i + 1) / numThreads;
+			}
 		}
 		run_id++;
 		start_lock.unlock();
@@ -252,15 +288,78 @@ namespace swrenderer
 			finished_threads = 0;
 		}
 
+		if (balance)
+		{
+			SliceStats.Resize(numThreads);
+			OccludedSprites = 0;
+			CreatedPlanes = MergedPlanes = BatchedPlanes = 0;
+			for (int i = 0; i < numThreads; i++)
+			{
+				SliceStats[i] = { Threads[i]->X1, Threads[i]->X2, Threads[i]->SliceTime };
+				OccludedSprites += Threads[i]->Occlusion->CulledSprites;
+				CreatedPlanes += Threads[i]->PlaneList->CreatedPlanes;
+				MergedPlanes += Threads[i]->PlaneList->MergedPlanes;
+				BatchedPlanes += Threads[i]->PlaneList->BatchedPlanes;
+			}
+		}
+
 		// Change main thread back to covering the whole screen for player sprites
 		MainThread()->X1 = 0;
 		MainThread()->X2 = viewwidth;
 	}
 
+	void RenderScene::UpdateSliceEdges(int numThreads)
+	{
+		if ((int)SliceEdges.size() != numThreads + 1 || SliceEdges.back() != viewwidth || !r_scene_balance)
+		{
+			SliceEdges.resize(numThreads + 1);
+			for (int i = 0; i <= numThreads; i++)
+				SliceEdges[i] = viewwidth * i / numThreads;
+			return;
+		}
+
+		double total = 0.0;
+		for (int i = 0; i < numThreads; i++)
+			total += Threads[i]->SliceTime;
+		if (total <= 0.0)
+			return;
+
+		// Treat the last frame's cost as evenly spread over the columns of each slice
+		// and place the new edges where the accumulated cost crosses each thread's share.
+		double share = total / numThreads;
+		int minwidth = MAX(viewwidth / (numThreads * 4), 1);
+		int slice = 0;
+		double acc = 0.0;
+		std::vector<int> edges(SliceEdges);
+		for (int i = 1; i < numThreads; i++)
+		{
+			double want = share * i;
+			while (slice < numThreads - 1 && acc + Threads[slice]->SliceTime < want)
+			{
+				acc += Threads[slice]->SliceTime;
+				slice++;
+			}
+
+			double time = Threads[slice]->SliceTime;
+			double frac = time > 0.0 ? clamp((want - acc) / time, 0.0, 1.0) : 0.5;
+			int x = SliceEdges[slice] + xs_RoundToInt(frac * (SliceEdges[slice + 1] - SliceEdges[slice]));
+
+			// Only move half way there since single frame timings are noisy.
+			x = (SliceEdges[i] + x) / 2;
+			x = MIN(x, viewwidth - (numThreads - i) * minwidth);
+			x = MAX(x, edges[i - 1] + minwidth);
+			edges[i] = MIN(x, viewwidth);
+		}
+		SliceEdges = std::move(edges);
+	}
+
 	void RenderScene::RenderThreadSlice(RenderThread *thread)
 	{
+		auto starttime = std::chrono::steady_clock::now();
+
 		thread->DrawQueue->Clear();
 		thread->FrameMemory->Clear();
+		thread->ModelFrames->Clear();
 		thread->Clip3D->Cleanup();
 		thread->Clip3D->ResetClip(); // reset clips (floor/ceiling)
 		thread->Portal->CopyStackedViewParameters();
@@ -269,11 +368,15 @@ namespace swrenderer
 		thread->PlaneList->Clear();
 		thread->TranslucentPass->Clear();
 		thread->OpaquePass->ClearClip();
+		thread->Occlusion->Clear(viewwidth, viewheight);
 		thread->OpaquePass->ResetFakingUnderwater(); // [RH] Hack to make windows into underwater areas possible
 		thread->Portal->SetMainPortal();
 
 		if (r_modelscene && thread->MainThread)
+		{
+			PolyTriangleDrawer::SetTileBinning(MainThread()->DrawQueue, false);
 			PolyTriangleDrawer::ClearStencil(MainThread()->DrawQueue, 0);
+		}
 
 		PolyTriangleDrawer::SetViewport(thread->DrawQueue, viewwindowx, viewwindowy, viewwidth, viewheight, thread->Viewport->RenderTarget);
 
@@ -284,7 +387,7 @@ namespace swrenderer
 		if (thread->X2 < viewwidth)
 			thread->ClipSegments->Clip(thread->X2, viewwidth, true, &visitor);
 
-		thread->OpaquePass->RenderScene(thread->Viewport->Level());
+		thread->OpaquePass->RenderScene(thread->Viewport->Level(), UseSharedBSPList ? &SharedBSPList : nullptr);
 		thread->Clip3D->ResetClip(); // reset clips (floor/ceiling)
 
 		if (viewactive)
@@ -298,6 +401,10 @@ namespace swrenderer
 		}
 
 		DrawerThreads::Execute(thread->DrawQueue);
+
+		// Camera textures are rendered after the main view and must not replace its timings for the next frame's balancing.
+		if (!thread->Viewport->RenderingToCanvas)
+			thread->SliceTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - starttime).count();
 	}
 
 	void RenderScene::StartThreads(size_t numThreads)
@@ -426,6 +533,35 @@ namespace swrenderer
 		return out;
 	}
 
+	ADD_STAT(swslices)
+	{
+		FString out;
+		double worst = 0.0, total = 0.0;
+		for (unsigned i = 0; i < SliceStats.Size(); i++)
+		{
+			out.AppendFormat("thread %2u: columns %4d-%4d  %04.1f ms\n", i, SliceStats[i].X1, SliceStats[i].X2, SliceStats[i].Time);
+			worst = MAX(worst, SliceStats[i].Time);
+			total += SliceStats[i].Time;
+		}
+		if (SliceStats.Size() > 0)
+			out.AppendFormat("average=%04.1f ms  worst=%04.1f ms", total / SliceStats.Size(), worst);
+		return out;
+	}
+
+	ADD_STAT(spriteocclusion)
+	{
+		FString out;
+		out.Format("%d sprites culled by occlusion", OccludedSprites);
+		return out;
+	}
+
+	ADD_STAT(visplanes)
+	{
+		FString out;
+		out.Format("%d visplanes created, %d lookups merged into existing ones, %d drawn with a shared span setup", CreatedPlanes, MergedPlanes, BatchedPlanes);
+		return out;
+	}
+
 	static double bestwallcycles = HUGE_VAL;
 
 	ADD_STAT(wallcycles)
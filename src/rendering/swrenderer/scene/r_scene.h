@@ -37,6 +37,7 @@ namespace swrenderer
 	extern cycle_t WallCycles, PlaneCycles, MaskedCycles, DrawerWaitCycles;
 
 	class RenderThread;
+	struct BSPListEntry;
 	
 	class RenderScene
 	{
@@ -59,6 +60,7 @@ namespace swrenderer
 		void RenderActorView(AActor *actor,bool renderplayersprite, bool dontmaplines);
 		void RenderThreadSlices();
 		void RenderThreadSlice(RenderThread *thread);
+		void UpdateSliceEdges(int numThreads);
 		void RenderPSprites();
 
 		void StartThreads(size_t numThreads);
@@ -75,5 +77,12 @@ namespace swrenderer
 		std::mutex end_mutex;
 		std::condition_variable end_condition;
 		size_t finished_threads = 0;
+
+		// Column boundaries of the thread slices, rebalanced every frame
+		std::vector<int> SliceEdges;
+
+		// BSP traversal shared by all slice threads
+		std::vector<BSPListEntry> SharedBSPList;
+		bool UseSharedBSPList = false;
 	};
 }
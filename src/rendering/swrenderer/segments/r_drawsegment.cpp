@@ -96,6 +96,7 @@ namespace swrenderer
 	void DrawSegmentList::BuildSegmentGroups()
 	{
 		SegmentGroups.Clear();
+		BuildColumnBins();
 
 		unsigned int groupSize = 100;
 		for (unsigned int index = 0; index < SegmentsCount(); index += groupSize)
@@ -168,4 +169,49 @@ namespace swrenderer
 			SegmentGroups.Push(group);
 		}
 	}
+
+	void DrawSegmentList::BuildColumnBins()
+	{
+		unsigned int count = SegmentsCount();
+		int numbins = (viewwidth + (1 << BinShift) - 1) >> BinShift;
+
+		BinStart.Resize(numbins + 1);
+		for (int bin = 0; bin <= numbins; bin++)
+			BinStart[bin] = 0;
+
+		// Count the segments in each bin, then turn the counts into start offsets
+		for (unsigned int index = 0; index < count; index++)
+		{
+			DrawSegment *ds = Segment(index);
+			if (ds->x1 >= ds->x2 || (!(ds->silhouette & SIL_BOTH) && ds->maskedtexturecol == nullptr && !ds->bFogBoundary))
+				continue;
+
+			int lastbin = MIN((ds->x2 - 1) >> BinShift, numbins - 1);
+			for (int bin = MAX((int)ds->x1, 0) >> BinShift; bin <= lastbin; bin++)
+				BinStart[bin + 1]++;
+		}
+		for (int bin = 0; bin < numbins; bin++)
+			BinStart[bin + 1] += BinStart[bin];
+
+		// Fill in increasing index order so every bin stays sorted
+		BinSegments.Resize(BinStart[numbins]);
+		BinFill.Resize(numbins);
+		for (int bin = 0; bin < numbins; bin++)
+			BinFill[bin] = BinStart[bin];
+		for (unsigned int index = 0; index < count; index++)
+		{
+			DrawSegment *ds = Segment(index);
+			if (ds->x1 >= ds->x2 || (!(ds->silhouette & SIL_BOTH) && ds->maskedtexturecol == nullptr && !ds->bFogBoundary))
+				continue;
+
+			int lastbin = MIN((ds->x2 - 1) >> BinShift, numbins - 1);
+			for (int bin = MAX((int)ds->x1, 0) >> BinShift; bin <= lastbin; bin++)
+				BinSegments[BinFill[bin]++] = index;
+		}
+
+		SegmentStamps.Resize(count);
+		for (unsigned int index = 0; index < count; index++)
+			SegmentStamps[index] = 0;
+		QueryStamp = 0;
+	}
 }
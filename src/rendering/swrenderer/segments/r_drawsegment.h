@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include "swrenderer/line/r_line.h"
 
 namespace swrenderer
@@ -94,9 +95,34 @@ namespace swrenderer
 
 		void BuildSegmentGroups();
 
+		// Calls callback once for every segment in [begin, end) that can clip sprites and overlaps columns x1 to x2
+		template<typename Callback>
+		void ForEachClipSegment(unsigned int begin, unsigned int end, int x1, int x2, Callback callback)
+		{
+			int firstbin = MAX(x1, 0) >> BinShift;
+			int lastbin = MIN((x2 - 1) >> BinShift, (int)BinStart.Size() - 2);
+			unsigned int stamp = ++QueryStamp;
+			for (int bin = firstbin; bin <= lastbin; bin++)
+			{
+				const unsigned int *first = BinSegments.Data() + BinStart[bin];
+				const unsigned int *last = BinSegments.Data() + BinStart[bin + 1];
+				for (const unsigned int *it = std::lower_bound(first, last, begin); it != last && *it < end; ++it)
+				{
+					unsigned int index = *it;
+					if (SegmentStamps[index] != stamp) // Segments spanning several bins are listed in each of them
+					{
+						SegmentStamps[index] = stamp;
+						callback(Segment(index));
+					}
+				}
+			}
+		}
+
 		RenderThread *Thread = nullptr;
 
 	private:
+		void BuildColumnBins();
+
 		TArray<DrawSegment *> Segments;
 		TArray<unsigned int> StartIndices;
 
@@ -106,5 +132,13 @@ namespace swrenderer
 		// For building segment groups
 		short cliptop[MAXWIDTH];
 		short clipbottom[MAXWIDTH];
+
+		// Indices of the segments that can clip sprites, binned by the screen columns they cover
+		enum { BinShift = 5 };
+		TArray<unsigned int> BinStart;
+		TArray<unsigned int> BinSegments;
+		TArray<unsigned int> BinFill;
+		TArray<unsigned int> SegmentStamps;
+		unsigned int QueryStamp = 0;
 	};
 }
@@ -418,6 +418,11 @@ namespace swrenderer
 		SWModelRenderer *swrenderer = (SWModelRenderer *)renderer;
 		swrenderer->VertexBuffer = mVertexBuffer.Size() ? &mVertexBuffer[0] : nullptr;
 		swrenderer->IndexBuffer = mIndexBuffer.Size() ? &mIndexBuffer[0] : nullptr;
+		if (frame1 != frame2 && swrenderer->InterpolationFactor != 0.f && swrenderer->VertexBuffer && size > 0)
+		{
+			swrenderer->VertexBuffer = swrenderer->Thread->ModelFrames->GetFrame(swrenderer->VertexBuffer, frame1, frame2, size, swrenderer->InterpolationFactor);
+			frame1 = frame2 = 0;
+		}
 		PolyTriangleDrawer::SetModelVertexShader(swrenderer->Thread->DrawQueue, frame1, frame2, swrenderer->InterpolationFactor);
 	}
 }
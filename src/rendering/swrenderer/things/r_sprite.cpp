@@ -60,6 +60,7 @@
 #include "swrenderer/scene/r_portal.h"
 #include "swrenderer/scene/r_scene.h"
 #include "swrenderer/scene/r_light.h"
+#include "swrenderer/scene/r_occlusion.h"
 #include "swrenderer/things/r_sprite.h"
 #include "swrenderer/viewport/r_viewport.h"
 #include "swrenderer/r_memory.h"
@@ -173,6 +174,14 @@ namespace swrenderer
 		fixed_t iscale = (fixed_t)(FRACUNIT / xscale); // Round towards zero to avoid wrapping in edge cases
 
 		double yscale = spriteScale.Y / tex->GetScale().Y;
+		double texturemid = tex->GetTopOffsetSW() - (viewport->viewpoint.Pos.Z - pos.Z + thing->Floorclip) / yscale;
+
+		// Don't bother with sprites the draw segments in front of them will clip away completely
+		double spryscale = viewport->InvZtoScale * yscale / tz;
+		double sprtopscreen = viewport->CenterY - texturemid * spryscale;
+		double sprbottomscreen = sprtopscreen + tex->GetHeight() * spryscale;
+		if (thread->Occlusion->IsOccluded(MAX<int>(x1, renderportal->WindowLeft), MIN<int>(x2, renderportal->WindowRight), xs_FloorToInt(MIN(sprtopscreen, sprbottomscreen)) - 1, xs_CeilToInt(MAX(sprtopscreen, sprbottomscreen)) + 1, (float)tz))
+			return;
 
 		// store information in a vissprite
 		RenderSprite *vis = thread->FrameMemory->NewObject<RenderSprite>();
@@ -182,7 +191,7 @@ namespace swrenderer
 		vis->yscale = float(viewport->InvZtoScale * yscale / tz);
 		vis->idepth = float(1 / tz);
 		vis->floorclip = thing->Floorclip / yscale;
-		vis->texturemid = tex->GetTopOffsetSW() - (viewport->viewpoint.Pos.Z - pos.Z + thing->Floorclip) / yscale;
+		vis->texturemid = texturemid;
 		vis->x1 = x1 < renderportal->WindowLeft ? renderportal->WindowLeft : x1;
 		vis->x2 = x2 > renderportal->WindowRight ? renderportal->WindowRight : x2;
 		//vis->Angle = thing->Angles.Yaw;
@@ -400,17 +400,17 @@ namespace swrenderer
 			}
 			else
 			{
-				for (unsigned int index = group.BeginIndex; index != group.EndIndex; index++)
+				// Only the segments overlapping the sprite's columns are visited. The order doesn't
+				// matter as each one can only narrow the clip range further.
+				segmentlist->ForEachClipSegment(group.BeginIndex, group.EndIndex, x1, x2, [&](DrawSegment *ds)
 				{
-					DrawSegment *ds = segmentlist->Segment(index);
-
 					// determine if the drawseg obscures the sprite
 					if (ds->x1 >= x2 || ds->x2 <= x1 ||
 						(!(ds->silhouette & SIL_BOTH) && ds->maskedtexturecol == nullptr &&
 							!ds->bFogBoundary))
 					{
 						// does not cover sprite
-						continue;
+						return;
 					}
 
 					int r1 = MAX<int>(ds->x1, x1);
@@ -425,7 +425,7 @@ namespace swrenderer
 						(spr->gpos.X - ds->curline->v1->fX()) * (ds->curline->v2->fY() - ds->curline->v1->fY()) <= 0))
 					{
 						// seg is behind sprite
-						continue;
+						return;
 					}
 
 					// clip this piece of the sprite
@@ -460,7 +460,7 @@ namespace swrenderer
 							clip2++;
 						} while (--i);
 					}
-				}
+				});
 			}
 		}
 
@@ -59,6 +59,14 @@ namespace swrenderer
 		Sprites.Push(sprite);
 	}
 
+	// Maps a float to an unsigned integer with the same ordering
+	static uint32_t SortDistKey(float dist)
+	{
+		uint32_t bits;
+		memcpy(&bits, &dist, sizeof(uint32_t));
+		return (bits & 0x80000000) ? ~bits : bits | 0x80000000;
+	}
+
 	void VisibleSpriteList::Sort(RenderThread *thread)
 	{
 		unsigned int first = StartIndices.Size() == 0 ? 0 : StartIndices.Last();
@@ -90,7 +98,25 @@ namespace swrenderer
 				FVector2 worldPos = SortedSprites[i]->WorldPos().XY();
 				SortedSprites[i]->SubsectorDepth = FindSubsectorDepth(thread, { worldPos.X, worldPos.Y });
 			}
+		}
 
+		if (count >= RadixSortThreshold)
+		{
+			// Decreasing SortDist, then stably by subsector depth. Same order as the comparison sorts below.
+			SortKeys.Resize(count);
+			for (unsigned int i = 0; i < count; i++)
+				SortKeys[i] = ~SortDistKey(SortedSprites[i]->SortDist());
+			RadixSort(count);
+
+			if (r_modelscene)
+			{
+				for (unsigned int i = 0; i < count; i++)
+					SortKeys[i] = (uint32_t)SortedSprites[i]->SubsectorDepth ^ 0x80000000;
+				RadixSort(count);
+			}
+		}
+		else if (r_modelscene)
+		{
 			std::stable_sort(&SortedSprites[0], &SortedSprites[count], [](VisibleSprite *a, VisibleSprite *b) -> bool
 			{
 				if (a->SubsectorDepth != b->SubsectorDepth)
@@ -108,6 +134,54 @@ namespace swrenderer
 		}
 	}
 
+	// Stable LSD radix sort of SortedSprites by SortKeys, eight bits per pass.
+	// Linear in the number of sprites, which matters once thousands of them are visible.
+	void VisibleSpriteList::RadixSort(unsigned int count)
+	{
+		TempKeys.Resize(count);
+		TempSprites.Resize(count);
+
+		uint32_t *srckeys = &SortKeys[0];
+		uint32_t *dstkeys = &TempKeys[0];
+		VisibleSprite **src = &SortedSprites[0];
+		VisibleSprite **dst = &TempSprites[0];
+
+		for (int shift = 0; shift < 32; shift += 8)
+		{
+			unsigned int offsets[256] = { 0 };
+			for (unsigned int i = 0; i < count; i++)
+				offsets[(srckeys[i] >> shift) & 0xff]++;
+
+			// Skip the pass if every key has the same digit
+			if (offsets[(srckeys[0] >> shift) & 0xff] == count)
+				continue;
+
+			unsigned int pos = 0;
+			for (int digit = 0; digit < 256; digit++)
+			{
+				unsigned int digitcount = offsets[digit];
+				offsets[digit] = pos;
+				pos += digitcount;
+			}
+
+			for (unsigned int i = 0; i < count; i++)
+			{
+				unsigned int dstindex = offsets[(srckeys[i] >> shift) & 0xff]++;
+				dstkeys[dstindex] = srckeys[i];
+				dst[dstindex] = src[i];
+			}
+
+			std::swap(srckeys, dstkeys);
+			std::swap(src, dst);
+		}
+
+		if (src != &SortedSprites[0])
+		{
+			memcpy(&SortedSprites[0], src, count * sizeof(VisibleSprite *));
+			memcpy(&SortKeys[0], srckeys, count * sizeof(uint32_t));
+		}
+	}
+
 	uint32_t VisibleSpriteList::FindSubsectorDepth(RenderThread *thread, const DVector2 &worldPos)
 	{
 		auto Level = thread->Viewport->Level();
@@ -19,8 +19,14 @@ namespace swrenderer
 	private:
 		uint32_t FindSubsectorDepth(RenderThread *thread, const DVector2 &worldPos);
 		uint32_t FindSubsectorDepth(RenderThread *thread, const DVector2 &worldPos, void *node);
+		void RadixSort(unsigned int count);
+
+		enum { RadixSortThreshold = 64 }; // Below this a comparison sort is faster
 
 		TArray<VisibleSprite *> Sprites;
+		TArray<uint32_t> SortKeys;
+		TArray<uint32_t> TempKeys;
+		TArray<VisibleSprite *> TempSprites;
 		TArray<unsigned int> StartIndices;
 	};
 }
@@ -83,6 +83,7 @@ namespace swrenderer
 			shadeConstants.fade_alpha = mBaseColormap->Fade.a;
 			shadeConstants.desaturate = MIN(abs(mBaseColormap->Desaturate), 255) * 255 / 256;
 			shadeConstants.simple_shade = (mBaseColormap->Color.d == 0x00ffffff && mBaseColormap->Fade.d == 0x00000000 && mBaseColormap->Desaturate == 0);
+			shadeConstants.ramp = nullptr;
 		}
 		else
 		{
@@ -96,6 +97,7 @@ namespace swrenderer
 			shadeConstants.fade_alpha = 256;
 			shadeConstants.desaturate = 0;
 			shadeConstants.simple_shade = true;
+			shadeConstants.ramp = nullptr;
 		}
 		return shadeConstants;
 	}
@@ -20,6 +20,7 @@ namespace swrenderer
 	class SWPixelFormatDrawers;
 	class DrawerArgs;
 	struct ShadeConstants;
+	class LightRamp;
 
 	struct DrawerLight
 	{
@@ -64,5 +65,6 @@ namespace swrenderer
 		uint16_t fade_blue;
 		uint16_t desaturate;
 		bool simple_shade;
+		const LightRamp *ramp; // Set by the drawers that shade with a light ramp instead of the formula above
 	};
 }
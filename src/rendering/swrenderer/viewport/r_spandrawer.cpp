@@ -51,6 +51,16 @@ namespace swrenderer
 		ds_source_mipmapped = tex->Mipmapped() && tex->GetPhysicalWidth() > 1 && tex->GetPhysicalHeight() > 1;
 	}
 
+	void SpanDrawerArgs::SetTexture(const uint8_t *pixels, int width, int height, bool mipmapped)
+	{
+		ds_texwidth = width;
+		ds_texheight = height;
+		for (ds_xbits = 0; (2 << ds_xbits) <= width; ds_xbits++);
+		for (ds_ybits = 0; (2 << ds_ybits) <= height; ds_ybits++);
+		ds_source = pixels;
+		ds_source_mipmapped = mipmapped;
+	}
+
 	void SpanDrawerArgs::SetStyle(bool masked, bool additive, fixed_t alpha, FDynamicColormap *basecolormap)
 	{
 		if (masked)
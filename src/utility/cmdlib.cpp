@@ -203,6 +203,34 @@ bool DirEntryExists(const char *pathname, bool *isdir)
 	return res;
 }
 
+//==========================================================================
+//
+// GetFileInfo
+//
+// Returns the size and modification time of a file.
+//
+//==========================================================================
+
+bool GetFileInfo(const char *pathname, size_t *size, time_t *time)
+{
+	if (pathname == NULL || *pathname == 0)
+		return false;
+
+#ifndef _WIN32
+	struct stat info;
+	bool res = stat(pathname, &info) == 0;
+#else
+	// Windows must use the wide version of stat to preserve non-standard paths.
+	auto wstr = WideString(pathname);
+	struct _stat64 info;
+	bool res = _wstat64(wstr.c_str(), &info) == 0;
+#endif
+	if (!res || (info.st_mode & S_IFDIR)) return false;
+	if (size) *size = (size_t)info.st_size;
+	if (time) *time = info.st_mtime;
+	return true;
+}
+
 //==========================================================================
 //
 // DefaultExtension		-- FString version
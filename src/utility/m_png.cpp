@@ -45,6 +45,7 @@
 #include "c_cvars.h"
 #include "r_defs.h"
 #include "m_png.h"
+#include "x86.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -109,6 +110,10 @@ CUSTOM_CVAR(Int, png_level, 5, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 }
 CVAR(Float, png_gamma, 0.f, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 
+// Use the SSE2 paths for unfiltering and palette expansion. This is only
+// meant for comparing against the scalar code.
+CVAR(Bool, png_simd, true, 0)
+
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
 // CODE --------------------------------------------------------------------
@@ -1063,6 +1068,13 @@ void UnfilterRow (int width, uint8_t *dest, uint8_t *row, uint8_t *prev, int bpp
 {
 	int x;
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__i386__) || defined(__amd64__)
+	if (png_simd && CPU.bSSE2 && UnfilterRow_SSE2 (width, dest, row + 1, prev, bpp, *row))
+	{
+		return;
+	}
+#endif
+
 	switch (*row++)
 	{
 	case 1:		// Sub
@@ -69,8 +69,31 @@ void DumpCPUInfo(const CPUInfo *cpu)
 #define __cpuid(output, func) __asm__ __volatile__("cpuid" : "=a" ((output)[0]),\
 	"=b" ((output)[1]), "=c" ((output)[2]), "=d" ((output)[3]) : "a" (func));
 #endif
+#if defined(__i386__) && defined(__PIC__)
+#define __cpuidex(output, func, subfunc) \
+	__asm__ __volatile__("xchgl\t%%ebx, %1\n\t" \
+						 "cpuid\n\t" \
+						 "xchgl\t%%ebx, %1\n\t" \
+		: "=a" ((output)[0]), "=r" ((output)[1]), "=c" ((output)[2]), "=d" ((output)[3]) \
+		: "a" (func), "c" (subfunc));
+#else
+#define __cpuidex(output, func, subfunc) __asm__ __volatile__("cpuid" : "=a" ((output)[0]),\
+	"=b" ((output)[1]), "=c" ((output)[2]), "=d" ((output)[3]) : "a" (func), "c" (subfunc));
+#endif
 #endif
 
+// Checks that the OS saves the SSE and AVX register state on context switches.
+static bool OSSavesYMMState()
+{
+#ifdef _MSC_VER
+	return (_xgetbv(0) & 6) == 6;
+#else
+	uint32_t eax, edx;
+	__asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (0));
+	return (eax & 6) == 6;
+#endif
+}
+
 void CheckCPUID(CPUInfo *cpu)
 {
 	int foo[4];
@@ -144,6 +167,20 @@ haveid:
 
 	cpu->HyperThreading = (foo[3] & (1 << 28)) > 0;
 
+	// AVX needs both the CPU (bit 28) and the OS via OSXSAVE (bit 27).
+	if ((foo[2] & (1 << 27)) && (foo[2] & (1 << 28)) && OSSavesYMMState())
+	{
+		int maxstd[4];
+		cpu->bAVX = true;
+		__cpuid(maxstd, 0);
+		if (maxstd[0] >= 7)
+		{
+			int ext[4];
+			__cpuidex(ext, 7, 0);
+			cpu->bAVX2 = (ext[1] & (1 << 5)) != 0;
+		}
+	}
+
 	// If CLFLUSH instruction is supported, get the real cache line size.
 	if (foo[3] & (1 << 19))
 	{
@@ -250,6 +287,8 @@ void DumpCPUInfo(const CPUInfo *cpu)
 		if (cpu->bSSSE3)		Printf(" SSSE3");
 		if (cpu->bSSE41)		Printf(" SSE4.1");
 		if (cpu->bSSE42)		Printf(" SSE4.2");
+		if (cpu->bAVX)			Printf(" AVX");
+		if (cpu->bAVX2)			Printf(" AVX2");
 		if (cpu->b3DNow)		Printf(" 3DNow!");
 		if (cpu->b3DNowPlus)	Printf(" 3DNow!+");
 		if (cpu->HyperThreading)	Printf(" HyperThreading");
@@ -334,4 +373,136 @@ void DoBlending_SSE2(const PalEntry *from, PalEntry *to, int count, int r, int g
 		}
 	}
 }
+
+//==========================================================================
+//
+// PNG unfiltering
+//
+// Sub, Average and Paeth depend on the pixel to the left, so the row is
+// processed one pixel at a time with all of its channels in one register.
+// This only pays off for 3 and 4 byte pixels; the caller handles the rest.
+// Up has no such dependency and is done 16 bytes at a time.
+//
+//==========================================================================
+
+static inline __m128i LoadPNGPixel(const uint8_t *p, int bpp)
+{
+	uint32_t v = 0;
+	memcpy(&v, p, bpp);
+	return _mm_cvtsi32_si128((int)v);
+}
+
+static inline void StorePNGPixel(uint8_t *p, __m128i v, int bpp)
+{
+	uint32_t d = (uint32_t)_mm_cvtsi128_si32(v);
+	memcpy(p, &d, bpp);
+}
+
+bool UnfilterRow_SSE2(int width, uint8_t *dest, const uint8_t *row, const uint8_t *prev, int bpp, int filter)
+{
+	const __m128i zero = _mm_setzero_si128();
+	int x;
+
+	if (filter == 2)
+	{
+		for (x = 0; x + 16 <= width; x += 16)
+		{
+			__m128i r = _mm_loadu_si128((const __m128i *)(row + x));
+			__m128i b = _mm_loadu_si128((const __m128i *)(prev + x));
+			_mm_storeu_si128((__m128i *)(dest + x), _mm_add_epi8(r, b));
+		}
+		for (; x < width; ++x)
+		{
+			dest[x] = row[x] + prev[x];
+		}
+		return true;
+	}
+
+	if (bpp < 3 || filter < 1 || filter > 4)
+	{
+		return false;
+	}
+
+	// For the first pixel the left neighbours are all zero, which reduces
+	// every filter to its documented first-pixel behaviour.
+	__m128i a = zero;
+	__m128i c = zero;
+
+	switch (filter)
+	{
+	case 1:		// Sub
+		for (x = 0; x < width; x += bpp)
+		{
+			a = _mm_add_epi8(LoadPNGPixel(row + x, bpp), a);
+			StorePNGPixel(dest + x, a, bpp);
+		}
+		break;
+
+	case 3:		// Average
+		for (x = 0; x < width; x += bpp)
+		{
+			__m128i b = LoadPNGPixel(prev + x, bpp);
+			// pavgb rounds up, so take off the carry bit to get (a+b)>>1.
+			__m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+			a = _mm_add_epi8(LoadPNGPixel(row + x, bpp), avg);
+			StorePNGPixel(dest + x, a, bpp);
+		}
+		break;
+
+	case 4:		// Paeth
+		for (x = 0; x < width; x += bpp)
+		{
+			__m128i b = _mm_unpacklo_epi8(LoadPNGPixel(prev + x, bpp), zero);
+			__m128i a16 = _mm_unpacklo_epi8(a, zero);
+			__m128i pa = _mm_sub_epi16(b, c);
+			__m128i pb = _mm_sub_epi16(a16, c);
+			__m128i pc = _mm_add_epi16(pa, pb);
+			pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+			pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+			pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+			// Same tie-breaking as the scalar version: a, then b, then c.
+			__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+			__m128i usea = _mm_cmpeq_epi16(smallest, pa);
+			__m128i useb = _mm_andnot_si128(usea, _mm_cmpeq_epi16(smallest, pb));
+			__m128i pred = _mm_or_si128(_mm_and_si128(usea, a16),
+				_mm_or_si128(_mm_and_si128(useb, b), _mm_andnot_si128(_mm_or_si128(usea, useb), c)));
+
+			a = _mm_add_epi8(LoadPNGPixel(row + x, bpp), _mm_packus_epi16(pred, zero));
+			StorePNGPixel(dest + x, a, bpp);
+			c = b;
+		}
+		break;
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// Expands a row of palette indices to BGRA. Entries with an alpha of 0
+// leave the destination untouched, just like the generic copy.
+// There is no gather in SSE2, so the lookups stay scalar but the masking
+// and stores are done four pixels at a time.
+//
+//==========================================================================
+
+void CopyPalettedRow_SSE2(uint32_t *dest, const uint8_t *src, int count, const uint32_t *palette)
+{
+	const __m128i alphamask = _mm_set1_epi32((int)0xff000000);
+	const __m128i zero = _mm_setzero_si128();
+	int x;
+
+	for (x = 0; x + 4 <= count; x += 4)
+	{
+		__m128i color = _mm_set_epi32(palette[src[x + 3]], palette[src[x + 2]], palette[src[x + 1]], palette[src[x]]);
+		__m128i keep = _mm_cmpeq_epi32(_mm_and_si128(color, alphamask), zero);
+		__m128i old = _mm_loadu_si128((const __m128i *)(dest + x));
+		_mm_storeu_si128((__m128i *)(dest + x), _mm_or_si128(_mm_and_si128(keep, old), _mm_andnot_si128(keep, color)));
+	}
+	for (; x < count; ++x)
+	{
+		uint32_t color = palette[src[x]];
+		if (color & 0xff000000) dest[x] = color;
+	}
+}
 #endif
@@ -3,7 +3,7 @@
 
 #include "basictypes.h"
 
-struct CPUInfo	// 92 bytes
+struct CPUInfo	// 96 bytes
 {
 	union
 	{
@@ -98,6 +98,11 @@ struct CPUInfo	// 92 bytes
 		};
 		uint32_t AMD_DataL1Info;
 	};
+
+	// Only set when the OS also saves the YMM registers
+	uint8_t bAVX;
+	uint8_t bAVX2;
+	uint8_t Padding[2];
 };
 
 
@@ -107,6 +112,8 @@ struct PalEntry;
 void CheckCPUID (CPUInfo *cpu);
 void DumpCPUInfo (const CPUInfo *cpu);
 void DoBlending_SSE2(const PalEntry *from, PalEntry *to, int count, int r, int g, int b, int a);
+bool UnfilterRow_SSE2(int width, uint8_t *dest, const uint8_t *row, const uint8_t *prev, int bpp, int filter);
+void CopyPalettedRow_SSE2(uint32_t *dest, const uint8_t *src, int count, const uint32_t *palette);
 
 #endif
 
@@ -51,6 +51,7 @@
 #include "hwrenderer/scene/hw_portal.h"
 #include "hwrenderer/utility/hw_clock.h"
 #include "hwrenderer/data/flatvertices.h"
+#include "swrenderer/r_benchmark.h"
 
 
 CVAR(Bool, gl_scale_viewport, true, CVAR_ARCHIVE);
@@ -205,6 +206,7 @@ void DFrameBuffer::DrawRateStuff ()
 void DFrameBuffer::Update()
 {
 	CheckBench();
+	CheckSWBenchmark();
 
 	int initialWidth = GetClientWidth();
 	int initialHeight = GetClientHeight();
@@ -216,7 +218,7 @@ void DFrameBuffer::Update()
 	{
 		SetVirtualSize(clientWidth, clientHeight);
 		V_OutputResized(clientWidth, clientHeight);
-		mVertexData->OutputResized(clientWidth, clientHeight);
+		if (mVertexData != nullptr) mVertexData->OutputResized(clientWidth, clientHeight);
 	}
 }
 
@@ -47,6 +47,7 @@
 #include "doomerrors.h"
 #include "i_system.h"
 #include "swrenderer/r_swrenderer.h"
+#include "swrenderer/r_memoryframebuffer.h"
 
 EXTERN_CVAR(Int, vid_maxfps)
 
@@ -126,7 +127,15 @@ void I_InitGraphics ()
 		// are the active app. Huh?
 	}
 
-	Video = new Win32GLVideo();
+	if (I_IsHeadless())
+	{
+		Printf("Rendering to memory (headless)\n");
+		Video = new MemoryVideo;
+	}
+	else
+	{
+		Video = new Win32GLVideo();
+	}
 
 	if (Video == NULL)
 		I_FatalError ("Failed to initialize display");